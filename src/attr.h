@@ -61,6 +61,7 @@ enum e_attribute {
 };
 
 class Attributes {
+	friend class Snapshot;
 public:
 	typedef vector<bool>::size_type size_type;
 private:
@@ -105,6 +106,7 @@ public:
 };
 
 class Project {
+	friend class Snapshot;
 	// Current and next project-id
 	static int current_projid;
 	static int next_projid;
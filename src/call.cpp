@@ -249,32 +249,36 @@ Call::check_macro_nesting(const Ctoken &t)
 void
 Call::dumpSql(Sql *db, ostream &of)
 {
+	SqlTable &functions = db->table(of, "FUNCTIONS");
+	SqlTable &funmetrics = db->table(of, "FUNCTIONMETRICS");
+	SqlTable &functionid = db->table(of, "FUNCTIONID");
+	SqlTable &fcalls = db->table(of, "FCALLS");
+
 	// First define all functions
 	for (const_fmap_iterator_type i = fbegin(); i != fend(); i++) {
 		Call *fun = i->second;
 		Tokid t = fun->get_site();
-		of << "INSERT INTO FUNCTIONS VALUES(" <<
-		ptr_offset(fun) << ", '" <<
-		fun->name << "', " <<
-		db->boolval(fun->is_macro()) << ',' <<
-		db->boolval(fun->is_defined()) << ',' <<
-		db->boolval(fun->is_declared()) << ',' <<
-		db->boolval(fun->is_file_scoped()) << ',' <<
-		t.get_fileid().get_id() << ',' <<
-		(unsigned)(t.get_streampos()) << ',' <<
+		functions << ptr_offset(fun) <<
+		fun->name <<
+		fun->is_macro() <<
+		fun->is_defined() <<
+		fun->is_declared() <<
+		fun->is_file_scoped() <<
+		t.get_fileid().get_id() <<
+		(unsigned)(t.get_streampos()) <<
 		fun->get_num_caller();
-		of << ");\n";
+		functions.end_row();
 
 		if (fun->is_defined()) {
-			of << "INSERT INTO FUNCTIONMETRICS VALUES(" << ptr_offset(fun);
+			funmetrics << ptr_offset(fun);
 			for (int j = 0; j < FunMetrics::metric_max; j++)
 				if (!Metrics::is_internal<FunMetrics>(j))
-					cout << ',' << fun->metrics().get_metric(j);
-			of << ',' << fun->get_begin().get_tokid().get_fileid().get_id() <<
-			',' << (unsigned)(fun->get_begin().get_tokid().get_streampos()) <<
-			',' << fun->get_end().get_tokid().get_fileid().get_id() <<
-			',' << (unsigned)(fun->get_end().get_tokid().get_streampos());
-			of << ");\n";
+					funmetrics << fun->metrics().get_metric(j);
+			funmetrics << fun->get_begin().get_tokid().get_fileid().get_id() <<
+			(unsigned)(fun->get_begin().get_tokid().get_streampos()) <<
+			fun->get_end().get_tokid().get_fileid().get_id() <<
+			(unsigned)(fun->get_end().get_tokid().get_streampos());
+			funmetrics.end_row();
 		}
 
 		int start = 0, ord = 0;
@@ -284,10 +288,8 @@ Call::dumpSql(Sql *db, ostream &of)
 			int pos = 0;
 			while (pos < len) {
 				Eclass *ec = t2.get_ec();
-				of << "INSERT INTO FUNCTIONID VALUES(" <<
-				ptr_offset(fun) << ',' <<
-				ord << ',' <<
-				ptr_offset(ec) << ");\n";
+				functionid << ptr_offset(fun) << ord << ptr_offset(ec);
+				functionid.end_row();
 				pos += ec->get_len();
 				t2 += ec->get_len();
 				ord++;
@@ -299,9 +301,9 @@ Call::dumpSql(Sql *db, ostream &of)
 	// Then their calls to satisfy integrity constraints
 	for (const_fmap_iterator_type i = fbegin(); i != fend(); i++) {
 		Call *fun = i->second;
-		for (Call::const_fiterator_type dest = fun->call_begin(); dest != fun->call_end(); dest++)
-			of << "INSERT INTO FCALLS VALUES(" <<
-			    ptr_offset(fun) << ',' <<
-			    ptr_offset(*dest) << ");\n";
+		for (Call::const_fiterator_type dest = fun->call_begin(); dest != fun->call_end(); dest++) {
+			fcalls << ptr_offset(fun) << ptr_offset(*dest);
+			fcalls.end_row();
+		}
 	}
 }
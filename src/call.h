@@ -56,6 +56,8 @@ class Ctoken;
  *	macro names consisting of multiple parts
  */
 class Call {
+	friend class Snapshot;
+	friend class MemStat;
 private:
 
 	// Container for storing all declared functions
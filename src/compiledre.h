@@ -19,6 +19,9 @@
  *
  * Reference-counted compiled regular expressions
  * See the Handle class in Stroutrup's section 25.7
+ * Extended REs consisting of a literal string, optionally anchored at
+ * its beginning or end, are matched with string comparisons rather
+ * than through regexec.
  *
  *
  */
@@ -29,6 +32,7 @@
 
 #include <regex.h>
 #include <string>
+#include <cstring>
 
 using namespace std;
 
@@ -36,19 +40,144 @@ class CompiledRE {
 	regex_t *re;
 	int *refcount;
 	int ret;
+	// Literal RE matching
+	enum e_literal {
+		lm_none,		// Not a literal; use regexec
+		lm_exact,		// ^literal$
+		lm_prefix,		// ^literal
+		lm_suffix,		// literal$
+		lm_substring		// literal
+	} literal_match;
+	string literal;			// The RE's literal string
+	bool icase;			// Match literal ignoring case
+
+	// Set literal_match and literal if s is a literal extended RE
+	void analyze(const char *s, int flags) {
+		literal_match = lm_none;
+		// REG_NEWLINE changes the meaning of the anchors
+		if (!(flags & REG_EXTENDED) || (flags & REG_NEWLINE))
+			return;
+		icase = (flags & REG_ICASE) != 0;
+		bool bol = false, eol = false;
+		if (*s == '^') {
+			bol = true;
+			s++;
+		}
+		string lit;
+		for (; *s; s++)
+			if (*s == '\\') {
+				if (!is_special(s[1]))
+					return;
+				lit += *++s;
+			} else if (*s == '$' && !s[1])
+				eol = true;
+			else if (is_special(*s))
+				return;
+			else
+				lit += *s;
+		if (icase && !is_ascii(lit))
+			return;
+		literal = icase ? lower(lit) : lit;
+		if (bol && eol)
+			literal_match = lm_exact;
+		else if (bol)
+			literal_match = lm_prefix;
+		else if (eol)
+			literal_match = lm_suffix;
+		else
+			literal_match = lm_substring;
+	}
+
+	// Return s in ASCII lower case
+	static string lower(const string &s) {
+		string r(s);
+		for (string::iterator i = r.begin(); i != r.end(); i++)
+			if (*i >= 'A' && *i <= 'Z')
+				*i += 'a' - 'A';
+		return r;
+	}
+
+	// Return true if the literal appears in str at position pos
+	bool literal_at(const string &str, string::size_type pos) const {
+		if (!icase)
+			return str.compare(pos, literal.length(), literal) == 0;
+		for (string::size_type i = 0; i < literal.length(); i++) {
+			char c = str[pos + i];
+			if (c >= 'A' && c <= 'Z')
+				c += 'a' - 'A';
+			if (c != literal[i])
+				return false;
+		}
+		return true;
+	}
+
+	// Match str against the literal; return the regexec result
+	int literal_exec(const string &str) const {
+		string::size_type len = literal.length();
+		bool m = false;
+
+		if (str.length() < len)
+			return REG_NOMATCH;
+		switch (literal_match) {
+		case lm_exact:
+			m = (str.length() == len && literal_at(str, 0));
+			break;
+		case lm_prefix:
+			m = literal_at(str, 0);
+			break;
+		case lm_suffix:
+			m = literal_at(str, str.length() - len);
+			break;
+		case lm_substring:
+			if (!icase)
+				m = (str.find(literal) != string::npos);
+			else
+				for (string::size_type i = 0; !m && i + len <= str.length(); i++)
+					m = literal_at(str, i);
+			break;
+		case lm_none:
+			break;
+		}
+		return m ? 0 : REG_NOMATCH;
+	}
 public:
+	/*
+	 * Return true if c is special in a POSIX extended RE.
+	 * These are also the only characters that a backslash can
+	 * escape into literals; other escapes, such as \< and \w,
+	 * are GNU extensions.
+	 */
+	static bool is_special(char c) {
+		return c && strchr("^.[]$()|*+?{}\\", c) != NULL;
+	}
+
+	/*
+	 * Return true if s only contains ASCII characters.
+	 * Only these can be matched ignoring case without regexec,
+	 * because the case folding of the others is locale-dependent.
+	 */
+	static bool is_ascii(const string &s) {
+		for (string::const_iterator i = s.begin(); i != s.end(); i++)
+			if ((unsigned char)*i >= 0x80)
+				return false;
+		return true;
+	}
+
 	// ctor
-	CompiledRE(const char *s, int flags = 0) : refcount(new int(1)) {
+	CompiledRE(const char *s, int flags = 0) : refcount(new int(1)), literal_match(lm_none), icase(false) {
 		regex_t lre;
 		if ((ret = regcomp(&lre, s, flags)) != 0)
 			re = NULL;		// Error
-		else
+		else {
 			re = new regex_t(lre);
+			analyze(s, flags);
+		}
 	}
 	// Default ctor
-	CompiledRE() :  re(NULL), refcount(new int(1)), ret(0) {}
+	CompiledRE() :  re(NULL), refcount(new int(1)), ret(0), literal_match(lm_none), icase(false) {}
 	// Copy ctor
-	CompiledRE(const CompiledRE &from) : re(from.re), refcount(from.refcount), ret(from.ret) {
+	CompiledRE(const CompiledRE &from) : re(from.re), refcount(from.refcount), ret(from.ret),
+	    literal_match(from.literal_match), literal(from.literal), icase(from.icase) {
 		(*refcount)++;
 	}
 	// Assignment operator
@@ -64,6 +193,9 @@ public:
 		re = rhs.re;
 		refcount = rhs.refcount;
 		ret = rhs.ret;
+		literal_match = rhs.literal_match;
+		literal = rhs.literal;
+		icase = rhs.icase;
 		(*refcount)++;
 		return *this;
 	}
@@ -85,6 +217,9 @@ public:
 		return string(buff);
 	}
 	int exec(const string &str, size_t nmatch = 0, regmatch_t *pmatch = NULL, int eflags = 0) const {
+		if (literal_match != lm_none && nmatch == 0 && eflags == 0 &&
+		    (!icase || is_ascii(str)))
+			return literal_exec(str);
 		return regexec(re, str.c_str(), nmatch, pmatch, eflags);
 	}
 };
@@ -40,6 +40,8 @@
 #include <cstdlib>		// atoi
 #include <cstring>		// strdup
 #include <cerrno>		// errno
+#include <thread>
+#include <mutex>
 
 #include <getopt.h>
 #include <regex.h>
@@ -94,13 +96,22 @@ using namespace picoQL;
 #include "sql.h"
 #include "workdb.h"
 #include "obfuscate.h"
+#include "snapshot.h"
+#include "filescan.h"
+#include "parallel.h"
+#include "unitcache.h"
+#include "profile.h"
+#include "memstat.h"
+#include "readserver.h"
+#include "querycache.h"
+#include "nameindex.h"
 
 #define ids Identifier::ids
 
 #define prohibit_remote_access(file)
 #define prohibit_browsers(file) \
 	do { \
-		if (browse_only) { \
+		if (read_only()) { \
 			nonbrowse_operation_prohibited(file); \
 			return; \
 		} \
@@ -117,7 +128,14 @@ static enum e_process {
 	pm_obfuscation
 } process_mode;
 static int portno = 8081;		// Port number (-p n)
+static unsigned nthreads;		// Number of worker threads (-j n)
 static char *db_engine;			// Create SQL output for a specific db_iface
+static char *save_image;		// Save the workspace image here (-S file)
+static char *load_image;		// Load the workspace image from here (-L file)
+static char *reprocess_image;		// Update the workspace image from here (-R file)
+static bool unit_cache;			// Replay the results of repeated units (-u)
+static bool profile_report;		// Report the profiling data on exit (-t)
+static bool memory_report;		// Report the memory estimates on exit (-M)
 
 // Workspace modification state
 static enum e_modification_state {
@@ -136,6 +154,11 @@ static bool must_exit = false;
 
 // Set to true if we operate in browsing mode
 static bool browse_only = false;
+// Return true if the pages served may not modify the workspace
+static inline bool read_only() { return browse_only || ReadServer::is_reader(); }
+static FILE *logfile;			// Web request log (-l file)
+static int read_port;			// Port serving the read-only pages (-w port)
+static int read_workers;		// Processes serving them (-w port:n)
 // Maximum number of nodes and edges allowed to browsing-only clients
 #define MAX_BROWSING_GRAPH_ELEMENTS 1000
 
@@ -270,39 +293,39 @@ html_string(FILE *of, const Call *f)
 	}
 }
 
-// Add identifiers of the file fi into ids
-// Collect metrics for the file and its functions
-// Populate the file's accociated files set
-// Return true if the file contains unused identifiers
-static bool
-file_analyze(Fileid fi)
+// Identifiers and unneeded ECs found while scanning a file
+struct FileAnalysis {
+	// The first occurrence of each identifier EC
+	vector <pair <Eclass *, string> > idents;
+	// Locations of ECs that are not identifiers
+	vector <Tokid> unneeded;
+};
+
+/*
+ * Scan the file fi, collecting metrics for the file and its functions,
+ * and gathering its identifiers into fa and their counts into idm.
+ * Shared data (the tokid map and ids) are only read, so that
+ * different files can be scanned concurrently.
+ * The exception is identifier monitoring, which removes ECs
+ * as they are found, and can therefore only be done serially.
+ */
+static void
+file_scan(Fileid fi, FileAnalysis &fa, IdMetricsSummary &idm)
 {
 	using namespace std::rel_ops;
 
-	fifstream in;
-	bool has_unused = false;
-	const string &fname = fi.get_path();
 	int line_number = 0;
+	set <Eclass *> seen;			// Identifier ECs added to fa
 
 	FCallSet &fc = fi.get_functions();	// File's functions
 	FCallSet::iterator fci = fc.begin();	// Iterator through them
 	Call *cfun = NULL;			// Current function
 	stack <Call *> fun_nesting;
 
-	cerr << "Post-processing " << fname << endl;
-	in.open(fname.c_str(), ios::binary);
-	if (in.fail()) {
-		perror(fname.c_str());
-		exit(1);
-	}
+	FileScan scan(fi);
 	// Go through the file character by character
-	for (;;) {
-		Tokid ti;
-		int val;
-
-		ti = Tokid(fi, in.tellg());
-		if ((val = in.get()) == EOF)
-			break;
+	while (scan.next()) {
+		Tokid ti(scan.get_tokid());
 
 		// Update current_function
 		if (cfun && ti > cfun->get_end().get_tokid()) {
@@ -321,15 +344,14 @@ file_analyze(Fileid fi)
 			fci++;
 		}
 
-		char c = (char)val;
-		mapTokidEclass::iterator ei;
+		char c = scan.get_char();
+		Eclass *ec;
 		enum e_cfile_state cstate = fi.metrics().get_state();
 		if (cstate != s_block_comment &&
 		    cstate != s_string &&
 		    cstate != s_cpp_comment &&
 		    (isalnum(c) || c == '_') &&
-		    (ei = ti.find_ec()) != ti.end_ec()) {
-			Eclass *ec = (*ei).second;
+		    (ec = scan.get_ec()) != NULL) {
 			// Remove identifiers we are not supposed to monitor
 			if (monitor.is_valid()) {
 				IdPropElem ec_id(ec, Identifier());
@@ -342,42 +364,27 @@ file_analyze(Fileid fi)
 			// Identifiers we can mark
 			if (ec->is_identifier()) {
 				// Update metrics
-				id_msum.add_id(ec);
-				// Add to the map
-				string s(1, c);
-				int len = ec->get_len();
-				for (int j = 1; j < len; j++)
-					s += (char)in.get();
+				idm.add_id(ec);
+				string s(scan.get_token(ec->get_len()));
 				fi.metrics().process_id(s, ec);
 				if (cfun)
 					cfun->metrics().process_id(s, ec);
-				/*
-				 * ids[ec] = Identifier(ec, s);
-				 * Efficiently add s to ids, if needed.
-				 * See Meyers, effective STL, Item 24.
-				 */
-				IdProp::iterator idi = ids.lower_bound(ec);
-				if (idi == ids.end() || idi->first != ec)
-					ids.insert(idi, IdProp::value_type(ec, Identifier(ec, s)));
-				if (ec->is_unused())
-					has_unused = true;
-				else
-					; // TODO fi.set_associated_files(ec);
+				// Keep the identifier for adding it to ids
+				if (seen.insert(ec).second)
+					fa.idents.push_back(pair <Eclass *, string>(ec, s));
 				continue;
-			} else {
+			} else
 				/*
 				 * This equivalence class is not needed.
 				 * (All potential identifier tokens,
 				 * even reserved words get an EC. These are
-				 * cleared here.)
+				 * cleared when the results are merged.)
 				 */
-				ec->remove_from_tokid_map();
-				delete ec;
-			}
+				fa.unneeded.push_back(ti);
 		}
-		fi.metrics().process_char((char)val);
+		fi.metrics().process_char(c);
 		if (cfun)
-			cfun->metrics().process_char((char)val);
+			cfun->metrics().process_char(c);
 		if (c == '\n') {
 			fi.add_line_end(ti.get_streampos());
 			if (!fi.is_processed(++line_number))
@@ -386,13 +393,125 @@ file_analyze(Fileid fi)
 	}
 	if (cfun)
 		cfun->metrics().summarize_identifiers();
-	fi.metrics().set_ncopies(fi.get_identical_files().size());
 	if (DP())
 		cout << "nchar = " << fi.metrics().get_metric(Metrics::em_nchar) << endl;
-	in.close();
+}
+
+/*
+ * Merge the results of scanning the file fi into ids,
+ * and remove its unneeded ECs.
+ * Return true if the file contains unused identifiers
+ */
+static bool
+file_merge(Fileid fi, const FileAnalysis &fa)
+{
+	bool has_unused = false;
+
+	cerr << "Post-processing " << fi.get_path() << endl;
+	/*
+	 * ECs spanning many files are listed by each one of them.
+	 * Once removed, their tokids no longer map to them.
+	 */
+	for (vector <Tokid>::const_iterator i = fa.unneeded.begin(); i != fa.unneeded.end(); i++) {
+		Eclass *ec = i->check_ec();
+		if (ec) {
+			ec->remove_from_tokid_map();
+			delete ec;
+		}
+	}
+	for (vector <pair <Eclass *, string> >::const_iterator i = fa.idents.begin(); i != fa.idents.end(); i++) {
+		Eclass *ec = i->first;
+		/*
+		 * ids[ec] = Identifier(ec, s);
+		 * Efficiently add s to ids, if needed.
+		 * See Meyers, effective STL, Item 24.
+		 */
+		IdProp::iterator idi = ids.lower_bound(ec);
+		if (idi == ids.end() || idi->first != ec)
+			ids.insert(idi, IdProp::value_type(ec, Identifier(ec, i->second)));
+		if (ec->is_unused())
+			has_unused = true;
+		else
+			; // TODO fi.set_associated_files(ec);
+	}
+	fi.metrics().set_ncopies(fi.get_identical_files().size());
 	return has_unused;
 }
 
+// Add identifiers of the file fi into ids
+// Collect metrics for the file and its functions
+// Populate the file's accociated files set
+// Return true if the file contains unused identifiers
+static bool
+file_analyze(Fileid fi)
+{
+	FileAnalysis fa;
+
+	file_scan(fi, fa, id_msum);
+	return file_merge(fi, fa);
+}
+
+// Work shared among the post-processing threads
+struct AnalysisWork {
+	const vector <Fileid> &files;		// Files to process
+	vector <FileAnalysis> results;		// Corresponding results
+	mutex next_mutex;			// Protects next
+	vector <Fileid>::size_type next;	// Next file to process
+	AnalysisWork(const vector <Fileid> &f) : files(f), results(f.size()), next(0) {}
+};
+
+// Body of a post-processing thread: scan files until none remain
+static void
+analysis_worker(AnalysisWork *w, IdMetricsSummary *idm)
+{
+	for (;;) {
+		vector <Fileid>::size_type i;
+		{
+			lock_guard <mutex> lock(w->next_mutex);
+			if (w->next == w->files.size())
+				return;
+			i = w->next++;
+		}
+		file_scan(w->files[i], w->results[i], *idm);
+	}
+}
+
+/*
+ * Post-process all files using nthreads threads and populate
+ * the directory tree.
+ * The files are scanned in parallel, and the results are then
+ * merged in the order of files, so that the outcome is the same
+ * as that of processing the files serially.
+ */
+static void
+files_analyze(const vector <Fileid> &files, unsigned nthreads)
+{
+	if (nthreads <= 1 || monitor.is_valid()) {
+		for (vector <Fileid>::const_iterator i = files.begin(); i != files.end(); i++) {
+			file_analyze(*i);
+			dir_add_file(*i);
+		}
+		return;
+	}
+
+	AnalysisWork work(files);
+	vector <IdMetricsSummary> idm(nthreads);
+	vector <thread> workers;
+	for (unsigned i = 0; i < nthreads; i++)
+		workers.push_back(thread(analysis_worker, &work, &idm[i]));
+	for (vector <thread>::iterator i = workers.begin(); i != workers.end(); i++)
+		i->join();
+
+	for (vector <Fileid>::size_type i = 0; i < files.size(); i++) {
+		file_merge(files[i], work.results[i]);
+		dir_add_file(files[i]);
+		// Release memory as we go
+		work.results[i] = FileAnalysis();
+	}
+	for (vector <IdMetricsSummary>::const_iterator i = idm.begin(); i != idm.end(); i++)
+		id_msum.add_ids(*i);
+}
+
 // Display the contents of a file in hypertext form
 static void
 file_hypertext(FILE *of, Fileid fi, bool eval_query)
@@ -924,8 +1043,12 @@ static void
 nonbrowse_operation_prohibited(FILE *fo)
 {
 	html_head(fo, "nochange", "Non-browsing Operations Disabled");
-	fputs("This is a multiuser browse-only CScout session."
-		"Non-browsing operations are disabled.", fo);
+	if (ReadServer::is_reader())
+		fprintf(fo, "These pages are served concurrently in read-only mode. "
+			"Non-browsing operations are only available through port %d.", portno);
+	else
+		fputs("This is a multiuser browse-only CScout session."
+			"Non-browsing operations are disabled.", fo);
 	html_tail(fo);
 }
 
@@ -987,6 +1110,66 @@ html_file(FILE *of, Fileid fi)
 		fname.c_str());
 }
 
+// Results of an identifier query, for each type of result shown
+struct IdQueryResult {
+	vector <const IdProp::value_type *> identifiers;
+	vector <Fileid> files;
+	vector <const Call *> funs;
+};
+
+// Results of a function query
+struct FunQueryResult {
+	vector <const Call *> funs;
+	vector <Fileid> files;
+};
+
+// Recently evaluated queries, whose results are reused when paging
+static QueryCache <IdQueryResult> id_query_cache(10);
+static QueryCache <FunQueryResult> fun_query_cache(10);
+static QueryCache <vector <Fileid> > file_query_cache(10);
+
+// Indexes of the identifier and function names, narrowing name queries
+static NameIndex <const IdProp::value_type *> id_name_index;
+static NameIndex <Call *> fun_name_index;
+
+// Index the names of the workspace's identifiers and functions
+static void
+build_name_indexes()
+{
+	id_name_index.clear();
+	for (IdProp::const_iterator i = ids.begin(); i != ids.end(); i++)
+		id_name_index.add(i->second.get_id(), &*i);
+	id_name_index.build();
+	fun_name_index.clear();
+	for (Call::const_fmap_iterator_type i = Call::fbegin(); i != Call::fend(); i++)
+		fun_name_index.add(i->second->get_name(), i->second);
+	fun_name_index.build();
+}
+
+/*
+ * Return the key for caching the results of query.
+ * The results are kept in the order of the options in effect;
+ * setting the options clears the cache.
+ */
+static string
+query_key(const Query &query)
+{
+	ostringstream key;
+	key << query.param_url() << "&project=" << current_project <<
+		"&icase=" << Option::file_icase->get();
+	return key.str();
+}
+
+// Call when the workspace or the options are modified
+static void
+workspace_modified()
+{
+	id_query_cache.clear();
+	fun_query_cache.clear();
+	file_query_cache.clear();
+	ReadServer::invalidate();
+}
+
 // File query page
 static void
 filequery_page(FILE *of,  void *p)
@@ -1029,28 +1212,33 @@ xfilequery_page(FILE *of,  void *p)
 	if (!query.is_valid())
 		return;
 
-	multiset <Fileid, FileQuery::specified_order> sorted_files;
-
 	html_head(of, "xfilequery", (qname && *qname) ? qname : "File Query Results");
 
-	for (vector <Fileid>::iterator i = files.begin(); i != files.end(); i++) {
-		if (query.eval(*i))
-			sorted_files.insert(*i);
+	string key(query_key(query));
+	vector <Fileid> *sorted_files = file_query_cache.find(key);
+	if (!sorted_files) {
+		multiset <Fileid, FileQuery::specified_order> matched;
+		for (vector <Fileid>::iterator i = files.begin(); i != files.end(); i++) {
+			if (query.eval(*i))
+				matched.insert(*i);
+		}
+		sorted_files = &file_query_cache.insert(key);
+		sorted_files->assign(matched.begin(), matched.end());
 	}
 	html_file_begin(of);
-	if (modification_state != ms_subst && !browse_only)
+	if (modification_state != ms_subst && !read_only())
 		fprintf(of, "<th></th>\n");
 	if (query.get_sort_order() != -1)
 		fprintf(of, "<th>%s</th>\n", Metrics::get_name<FileMetrics>(query.get_sort_order()).c_str());
 	Pager pager(of, Option::entries_per_page->get(), query.base_url(), query.bookmarkable());
 	html_file_set_begin(of);
-	for (multiset <Fileid, FileQuery::specified_order>::iterator i = sorted_files.begin(); i != sorted_files.end(); i++) {
+	for (vector <Fileid>::const_iterator i = sorted_files->begin(); i != sorted_files->end(); i++) {
 		Fileid f = *i;
 		if (current_project && !f.get_attribute(current_project))
 			continue;
 		if (pager.show_next()) {
 			html_file(of, *i);
-			if (modification_state != ms_subst && !browse_only)
+			if (modification_state != ms_subst && !read_only())
 				fprintf(of, "<td><a href=\"fedit.html?id=%u\">edit</a></td>",
 				i->get_id());
 			if (query.get_sort_order() != -1)
@@ -1100,7 +1288,7 @@ display_sorted(FILE *of, const Query &query, const container &sorted_ids)
  * for properly aligning the output.
  */
 static void
-display_sorted_function_metrics(FILE *of, const FunQuery &query, const Sfuns &sorted_ids)
+display_sorted_function_metrics(FILE *of, const FunQuery &query, const vector <const Call *> &sorted_ids)
 {
 	fprintf(of, "<table class=\"metrics\"><tr>"
 	    "<th width='50%%' align='left'>Name</th>"
@@ -1108,7 +1296,7 @@ display_sorted_function_metrics(FILE *of, const FunQuery &query, const Sfuns &so
 	    Metrics::get_name<FunMetrics>(query.get_sort_order()).c_str());
 
 	Pager pager(of, Option::entries_per_page->get(), query.base_url() + "&qi=1", query.bookmarkable());
-	for (Sfuns::const_iterator i = sorted_ids.begin(); i != sorted_ids.end(); i++) {
+	for (vector <const Call *>::const_iterator i = sorted_ids.begin(); i != sorted_ids.end(); i++) {
 		if (pager.show_next()) {
 			fputs("<tr><td witdh='50%'>", of);
 			html(of, **i);
@@ -1246,7 +1434,7 @@ funquery_page(FILE *of,  void *p)
 }
 
 void
-display_files(FILE *of, const Query &query, const IFSet &sorted_files)
+display_files(FILE *of, const Query &query, const vector <Fileid> &sorted_files)
 {
 	const string query_url(query.param_url());
 
@@ -1254,7 +1442,7 @@ display_files(FILE *of, const Query &query, const IFSet &sorted_files)
 	html_file_begin(of);
 	html_file_set_begin(of);
 	Pager pager(of, Option::entries_per_page->get(), query.base_url() + "&qf=1", query.bookmarkable());
-	for (IFSet::iterator i = sorted_files.begin(); i != sorted_files.end(); i++) {
+	for (vector <Fileid>::const_iterator i = sorted_files.begin(); i != sorted_files.end(); i++) {
 		Fileid f = *i;
 		if (current_project && !f.get_attribute(current_project))
 			continue;
@@ -1263,7 +1451,7 @@ display_files(FILE *of, const Query &query, const IFSet &sorted_files)
 			fprintf(of, "<td><a href=\"qsrc.html?id=%u&%s\">marked source</a></td>",
 				f.get_id(),
 				query_url.c_str());
-			if (modification_state != ms_subst && !browse_only)
+			if (modification_state != ms_subst && !read_only())
 				fprintf(of, "<td><a href=\"fedit.html?id=%u\">edit</a></td>",
 				f.get_id());
 			html_file_record_end(of);
@@ -1280,9 +1468,6 @@ xiquery_page(FILE *of,  void *p)
 	Timer timer;
 	prohibit_remote_access(of);
 
-	Sids sorted_ids;
-	IFSet sorted_files;
-	set <Call *> funs;
 	bool q_id = !!swill_getvar("qi");	// Show matching identifiers
 	bool q_file = !!swill_getvar("qf");	// Show matching files
 	bool q_fun = !!swill_getvar("qfun");	// Show matching functions
@@ -1295,33 +1480,55 @@ xiquery_page(FILE *of,  void *p)
 	}
 
 	html_head(of, "xiquery", (qname && *qname) ? qname : "Identifier Query Results");
-	cerr << "Evaluating identifier query" << endl;
-	for (IdProp::iterator i = ids.begin(); i != ids.end(); i++) {
-		progress(i, ids);
-		if (!query.eval(*i))
-			continue;
-		if (q_id)
-			sorted_ids.insert(&*i);
-		else if (q_file) {
-			IFSet f = i->first->sorted_files();
-			sorted_files.insert(f.begin(), f.end());
-		} else if (q_fun) {
-			set <Call *> ecfuns(i->first->functions());
-			funs.insert(ecfuns.begin(), ecfuns.end());
+	string key(query_key(query));
+	if (q_id)
+		key += "&qi=1";
+	else if (q_file)
+		key += "&qf=1";
+	else if (q_fun)
+		key += "&qfun=1";
+	IdQueryResult *result = id_query_cache.find(key);
+	if (!result) {
+		Sids sorted_ids;
+		IFSet sorted_files;
+		set <Call *> funs;
+		// Examine only the identifiers whose names can match
+		vector <const IdProp::value_type *> candidates;
+		const string *re = query.name_re();
+		if (!re || !id_name_index.candidates(*re, false, candidates))
+			for (IdProp::const_iterator i = ids.begin(); i != ids.end(); i++)
+				candidates.push_back(&*i);
+		cerr << "Evaluating identifier query" << endl;
+		for (vector <const IdProp::value_type *>::const_iterator i = candidates.begin(); i != candidates.end(); i++) {
+			progress(i, candidates);
+			if (!query.eval(**i))
+				continue;
+			if (q_id)
+				sorted_ids.insert(*i);
+			else if (q_file) {
+				const setFileid &f = (*i)->first->get_files();
+				sorted_files.insert(f.begin(), f.end());
+			} else if (q_fun) {
+				set <Call *> ecfuns((*i)->first->functions());
+				funs.insert(ecfuns.begin(), ecfuns.end());
+			}
 		}
+		cerr << endl;
+		result = &id_query_cache.insert(key);
+		result->identifiers.assign(sorted_ids.begin(), sorted_ids.end());
+		result->files.assign(sorted_files.begin(), sorted_files.end());
+		Sfuns sorted_funs(funs.begin(), funs.end());
+		result->funs.assign(sorted_funs.begin(), sorted_funs.end());
 	}
-	cerr << endl;
 	if (q_id) {
 		fputs("<h2>Matching Identifiers</h2>\n", of);
-		display_sorted(of, query, sorted_ids);
+		display_sorted(of, query, result->identifiers);
 	}
 	if (q_file)
-		display_files(of, query, sorted_files);
+		display_files(of, query, result->files);
 	if (q_fun) {
 		fputs("<h2>Matching Functions</h2>\n", of);
-		Sfuns sorted_funs;
-		sorted_funs.insert(funs.begin(), funs.end());
-		display_sorted(of, query, sorted_funs);
+		display_sorted(of, query, result->funs);
 	}
 
 	timer.print_elapsed(of);
@@ -1335,8 +1542,6 @@ xfunquery_page(FILE *of,  void *p)
 	prohibit_remote_access(of);
 	Timer timer;
 
-	Sfuns sorted_funs;
-	IFSet sorted_files;
 	bool q_id = !!swill_getvar("qi");	// Show matching identifiers
 	bool q_file = !!swill_getvar("qf");	// Show matching files
 	char *qname = swill_getvar("n");
@@ -1346,26 +1551,39 @@ xfunquery_page(FILE *of,  void *p)
 		return;
 
 	html_head(of, "xfunquery", (qname && *qname) ? qname : "Function Query Results");
-	cerr << "Evaluating function query" << endl;
-	for (Call::const_fmap_iterator_type i = Call::fbegin(); i != Call::fend(); i++) {
-		progress(i, Call::functions());
-		if (!query.eval(i->second))
-			continue;
-		if (q_id)
-			sorted_funs.insert(i->second);
-		if (q_file)
-			sorted_files.insert(i->second->get_fileid());
+	string key(query_key(query));
+	FunQueryResult *result = fun_query_cache.find(key);
+	if (!result) {
+		Sfuns sorted_funs;
+		IFSet sorted_files;
+		// Examine only the functions whose names can match
+		vector <Call *> candidates;
+		const string *re = query.name_re();
+		if (!re || !fun_name_index.candidates(*re, false, candidates))
+			for (Call::const_fmap_iterator_type i = Call::fbegin(); i != Call::fend(); i++)
+				candidates.push_back(i->second);
+		cerr << "Evaluating function query" << endl;
+		for (vector <Call *>::const_iterator i = candidates.begin(); i != candidates.end(); i++) {
+			progress(i, candidates);
+			if (!query.eval(*i))
+				continue;
+			sorted_funs.insert(*i);
+			sorted_files.insert((*i)->get_fileid());
+		}
+		cerr << endl;
+		result = &fun_query_cache.insert(key);
+		result->funs.assign(sorted_funs.begin(), sorted_funs.end());
+		result->files.assign(sorted_files.begin(), sorted_files.end());
 	}
-	cerr << endl;
 	if (q_id) {
 		fputs("<h2>Matching Functions</h2>\n", of);
 		if (query.get_sort_order() != -1)
-			display_sorted_function_metrics(of, query, sorted_funs);
+			display_sorted_function_metrics(of, query, result->funs);
 		else
-			display_sorted(of, query, sorted_funs);
+			display_sorted(of, query, result->funs);
 	}
 	if (q_file)
-		display_files(of, query, sorted_files);
+		display_files(of, query, result->files);
 	timer.print_elapsed(of);
 	html_tail(of);
 }
@@ -1396,6 +1614,7 @@ identifier_page(FILE *fo, void *p)
 		}
 		prohibit_browsers(fo);
 		prohibit_remote_access(fo);
+		workspace_modified();
 
 		// Passing subst directly core-dumps under
 		// gcc version 2.95.4 20020320 [FreeBSD 4.7]
@@ -1443,7 +1662,7 @@ identifier_page(FILE *fo, void *p)
 
 	if ((!e->get_attribute(is_readonly) || Option::rename_override_ro->get()) &&
 	    modification_state != ms_hand_edit &&
-	    !browse_only) {
+	    !read_only()) {
 		fprintf(fo, "<li> Substitute with: \n"
 			"<INPUT TYPE=\"text\" NAME=\"sname\" VALUE=\"%s\" SIZE=10 MAXLENGTH=256> "
 			"<INPUT TYPE=\"submit\" NAME=\"repl\" VALUE=\"Save\">\n",
@@ -1485,6 +1704,7 @@ function_page(FILE *fo, void *p)
 		}
 		prohibit_browsers(fo);
 		prohibit_remote_access(fo);
+		workspace_modified();
 		RefFunCall::store.insert(RefFunCall::store_type::value_type(ec, RefFunCall(f, subst)));
 		modification_state = ms_subst;
 	}
@@ -1505,7 +1725,7 @@ function_page(FILE *fo, void *p)
 			fprintf(fo, " &mdash; <a href=\"qsrc.html?qt=fun&id=%u&match=Y&call=%p&n=Declaration+of+%s\">marked source</a>",
 				t.get_fileid().get_id(),
 				f, f->get_name().c_str());
-			if (modification_state != ms_subst && !browse_only)
+			if (modification_state != ms_subst && !read_only())
 				fprintf(fo, " &mdash; <a href=\"fedit.html?id=%u&re=%s\">edit</a>",
 				t.get_fileid().get_id(), f->get_name().c_str());
 	}
@@ -1517,7 +1737,7 @@ function_page(FILE *fo, void *p)
 		int lnum = t.get_fileid().line_number(t.get_streampos());
 		fprintf(fo, " <a href=\"src.html?id=%u#%d\">line %d</a>\n",
 			t.get_fileid().get_id(), lnum, lnum);
-		if (modification_state != ms_subst && !browse_only)
+		if (modification_state != ms_subst && !read_only())
 			fprintf(fo, " &mdash; <a href=\"fedit.html?id=%u&re=%s\">edit</a>",
 			t.get_fileid().get_id(), f->get_name().c_str());
 	} else
@@ -1538,7 +1758,7 @@ function_page(FILE *fo, void *p)
 	Eclass *ec;
 	if (f->get_token().get_parts_size() == 1 &&
 	    modification_state != ms_hand_edit &&
-	    !browse_only &&
+	    !read_only() &&
 	    (ec = f->get_token().get_parts_begin()->get_tokid().check_ec()) &&
 	    (!ec->get_attribute(is_readonly) || Option::refactor_fun_arg_override_ro->get())
 	    ) {
@@ -1902,6 +2122,12 @@ set_options_page(FILE *fo, void *p)
 		index_page(fo, p);
 		return;
 	}
+	// The options of a serving process would only apply to its requests
+	if (ReadServer::is_reader()) {
+		nonbrowse_operation_prohibited(fo);
+		return;
+	}
+	workspace_modified();
 	Option::set_all();
 	if (Option::sfile_re_string->get().length()) {
 		sfile_re = CompiledRE(Option::sfile_re_string->get().c_str(), REG_EXTENDED);
@@ -2380,6 +2606,7 @@ set_project_page(FILE *fo, void *p)
 		fprintf(fo, "Missing value");
 		return;
 	}
+	workspace_modified();
 	index_page(fo, p);
 }
 
@@ -2434,6 +2661,28 @@ about_page(FILE *fo, void *p)
 }
 
 
+// Processing statistics
+static void
+stats_page(FILE *fo, void *p)
+{
+	html_head(fo, "stats", "Processing Statistics");
+	ostringstream pstring;
+	Profile::html(pstring);
+	fputs(pstring.str().c_str(), fo);
+	html_tail(fo);
+}
+
+// Memory use estimates
+static void
+memory_page(FILE *fo, void *p)
+{
+	html_head(fo, "memory", "Memory Use");
+	ostringstream mstring;
+	MemStat::html(mstring);
+	fputs(mstring.str().c_str(), fo);
+	html_tail(fo);
+}
+
 // Index
 void
 index_page(FILE *of, void *data)
@@ -2513,21 +2762,28 @@ index_page(FILE *of, void *data)
 	);
 
 
-	if (!browse_only)
+	fputs(
+		"<div class=\"mainblock\">\n"
+		"<h2>Operations</h2>"
+		"<ul>\n", of);
+	if (!read_only())
 		fputs(
-			"<div class=\"mainblock\">\n"
-			"<h2>Operations</h2>"
-			"<ul>\n"
 			"<li> <a href=\"options.html\">Global options</a>\n"
 			" &mdash; <a href=\"save_options.html\">save global options</a>\n"
 			"<li> <a href=\"replacements.html\">Identifier replacements</a>\n"
 			"<li> <a href=\"funargrefs.html\">Function argument refactorings</a>\n"
-			"<li> <a href=\"sproject.html\">Select active project</a>\n"
+			"<li> <a href=\"sproject.html\">Select active project</a>\n", of);
+	// Also available in the read-only sessions
+	fputs(
+		"<li> <a href=\"stats.html\">Processing statistics</a>\n"
+		"<li> <a href=\"memory.html\">Memory use</a>\n", of);
+	if (!read_only())
+		fputs(
 			"<li> <a href=\"about.html\">About CScout</a>\n"
 			"<li> <a href=\"save.html\">Save changes and continue</a>\n"
 			"<li> <a href=\"sexit.html\">Exit &mdash; saving changes</a>\n"
-			"<li> <a href=\"qexit.html\">Exit &mdash; ignore changes</a>\n"
-			"</ul></div>", of);
+			"<li> <a href=\"qexit.html\">Exit &mdash; ignore changes</a>\n", of);
+	fputs("</ul></div>", of);
 	fputs("</td></tr></table>\n", of);
 	html_tail(of);
 }
@@ -2573,7 +2829,7 @@ file_page(FILE *of, void *p)
 	fprintf(of, "<li> <a href=\"qsrc.html?qt=id&id=%u&match=Y&writable=1&a%d=1&n=Source+Code+With+Identifier+Hyperlinks\">Source code with identifier hyperlinks</a>\n", i.get_id(), is_readonly);
 	fprintf(of, "<li> <a href=\"qsrc.html?qt=id&id=%u&match=L&writable=1&a%d=1&n=Source+Code+With+Hyperlinks+to+Project-global+Writable+Identifiers\">Source code with hyperlinks to project-global writable identifiers</a>\n", i.get_id(), is_lscope);
 	fprintf(of, "<li> <a href=\"qsrc.html?qt=fun&id=%u&match=Y&writable=1&ro=1&n=Source+Code+With+Hyperlinks+to+Function+and+Macro+Declarations\">Source code with hyperlinks to function and macro declarations</a>\n", i.get_id());
-	if (modification_state != ms_subst && !browse_only)
+	if (modification_state != ms_subst && !read_only())
 		fprintf(of, "<li> <a href=\"fedit.html?id=%u\">Edit the file</a>", i.get_id());
 
 	fprintf(of, "</ul>\n<h2>Functions</h2><ul>\n");
@@ -2655,6 +2911,7 @@ fedit_page(FILE *of, void *p)
 		fprintf(of, "Missing value");
 		return;
 	}
+	workspace_modified();
 	Fileid i(id);
 	i.hand_edit();
 	char *re = swill_getvar("re");
@@ -2778,6 +3035,7 @@ xreplacements_page(FILE *of,  void *p)
 {
 	prohibit_browsers(of);
 	prohibit_remote_access(of);
+	workspace_modified();
 
 	cerr << "Creating identifier list" << endl;
 
@@ -2829,6 +3087,7 @@ xfunargrefs_page(FILE *of,  void *p)
 {
 	prohibit_browsers(of);
 	prohibit_remote_access(of);
+	workspace_modified();
 
 	for (RefFunCall::store_type::iterator i = RefFunCall::store.begin(); i != RefFunCall::store.end(); i++) {
 		char varname[128];
@@ -2873,8 +3132,7 @@ write_quit_page(FILE *of, void *exit)
 	for (IdProp::iterator i = ids.begin(); i != ids.end(); i++) {
 		progress(i, ids);
 		if (i->second.get_replaced() && i->second.get_active()) {
-			Eclass *e = (*i).first;
-			IFSet ifiles = e->sorted_files();
+			const setFileid &ifiles = (*i).first->get_files();
 			process.insert(ifiles.begin(), ifiles.end());
 		}
 	}
@@ -2906,8 +3164,7 @@ write_quit_page(FILE *of, void *exit)
 		progress(i, RefFunCall::store);
 		if (!i->second.is_active())
 			continue;
-		Eclass *e = i->first;
-		IFSet ifiles = e->sorted_files();
+		const setFileid &ifiles = i->first->get_files();
 		process.insert(ifiles.begin(), ifiles.end());
 	}
 	cerr << endl;
@@ -3090,6 +3347,98 @@ warning_report()
 	}
 }
 
+// Pass 1: process the workspace file fname
+static void
+process_workspace(const char *fname)
+{
+	Pdtoken t;
+
+	// Set the contents of the master file as immutable
+	Fileid fi = Fileid(fname);
+	fi.set_readonly(true);
+
+	Fchar::set_input(fname);
+	Error::set_parsing(true);
+	do
+		t.getnext();
+	while (t.get_code() != EOF);
+	Error::set_parsing(false);
+	// Output the rows buffered while processing, before any worker exits
+	if (process_mode == pm_database)
+		Sql::getInterface()->flush_tables();
+}
+
+// Report the profiling data on standard error (-t)
+static void
+profile_exit()
+{
+	Profile::stop();
+	Profile::json(cerr);
+}
+
+// Report the memory estimates on standard error (-M)
+static void
+memory_exit()
+{
+	MemStat::json(cerr);
+}
+
+// Register the web pages with swill
+static void
+web_setup()
+{
+	if (logfile)
+		swill_log(logfile);
+	swill_handle("src.html", source_page, NULL);
+	swill_handle("qsrc.html", query_source_page, NULL);
+	swill_handle("fedit.html", fedit_page, NULL);
+	swill_handle("file.html", file_page, NULL);
+	swill_handle("dir.html", dir_page, NULL);
+
+	// Identifier query and execution
+	swill_handle("iquery.html", iquery_page, NULL);
+	swill_handle("xiquery.html", xiquery_page, NULL);
+	// File query and execution
+	swill_handle("filequery.html", filequery_page, NULL);
+	swill_handle("xfilequery.html", xfilequery_page, NULL);
+	swill_handle("qinc.html", query_include_page, NULL);
+
+	// Function query and execution
+	swill_handle("funquery.html", funquery_page, NULL);
+	swill_handle("xfunquery.html", xfunquery_page, NULL);
+
+	swill_handle("id.html", identifier_page, NULL);
+	swill_handle("fun.html", function_page, NULL);
+	swill_handle("funlist.html", funlist_page, NULL);
+	swill_handle("funmetrics.html", function_metrics_page, NULL);
+	swill_handle("filemetrics.html", file_metrics_page, NULL);
+	swill_handle("idmetrics.html", id_metrics_page, NULL);
+
+	graph_handle("cgraph", cgraph_page);
+	graph_handle("fgraph", fgraph_page);
+	graph_handle("cpath", cpath_page);
+
+	swill_handle("about.html", about_page, NULL);
+	swill_handle("stats.html", stats_page, NULL);
+	swill_handle("memory.html", memory_page, NULL);
+	swill_handle("setproj.html", set_project_page, NULL);
+	swill_handle("logo.png", logo_page, NULL);
+	swill_handle("index.html", (void (*)(FILE *, void *))((char *)index_page), 0);
+
+	// Refactoring and options
+	swill_handle("sproject.html", select_project_page, 0);
+	swill_handle("replacements.html", replacements_page, 0);
+	swill_handle("xreplacements.html", xreplacements_page, NULL);
+	swill_handle("funargrefs.html", funargrefs_page, 0);
+	swill_handle("xfunargrefs.html", xfunargrefs_page, NULL);
+	swill_handle("options.html", options_page, 0);
+	swill_handle("soptions.html", set_options_page, 0);
+	swill_handle("save_options.html", save_options_page, 0);
+	swill_handle("sexit.html", write_quit_page, "exit");
+	swill_handle("save.html", write_quit_page, 0);
+	swill_handle("qexit.html", quit_page, 0);
+}
+
 // Report usage information and exit
 static void
 usage(char *fname)
@@ -3099,9 +3448,9 @@ usage(char *fname)
 #ifndef WIN32
 		"-b|"	// browse-only
 #endif
-		"-C|-c|-d D|-d H|-E|-o|"
-		"-r|-s db|-v] "
-		"[-l file] "
+		"-C|-c|-d D|-d H|-E|-G|-M|-o|"
+		"-r|-s db|-t|-u|-v] [-B method] "
+		"[-j n] [-l file] [-P n] [-R file] [-S file] "
 
 #ifdef PICO_QL
 #define PICO_QL_OPTIONS "q"
@@ -3110,27 +3459,45 @@ usage(char *fname)
 #define PICO_QL_OPTIONS ""
 #endif
 
-		"[-p port] [-m spec] file\n"
+		"[-p port] [-w port[:n]] [-m spec] file | -L file\n"
 #ifndef WIN32
 		"\t-b\tRun in multiuser browse-only mode\n"
 #endif
+		"\t-B method\tLoad the SQL tables through insert, values, copy,\n"
+		"\t\tor csv:dir (default insert)\n"
 		"\t-C\tCreate a ctags(1)-compatible tags file\n"
 		"\t-c\tProcess the file and exit\n"
 		"\t-d D\tOutput the #defines being processed on standard output\n"
 		"\t-d H\tOutput the included files being processed on standard output\n"
 		"\t-E\tPrint preprocessed results on standard output and exit\n"
 		"\t\t(the workspace file must have also been processed with -E)\n"
+		"\t-G\tRead again included files guarded against multiple inclusion\n"
+		"\t-j n\tUse n threads for post-processing the files\n"
+		"\t\t(the default is the number of available processors)\n"
+		"\t-L file\tServe the workspace image saved in file with -S\n"
 		"\t-l file\tSpecify access log file\n"
+		"\t-M\tReport estimates of the data structures' memory in JSON on exit\n"
 		"\t-m spec\tSpecify identifiers to monitor (unsound)\n"
 		"\t-o\tCreate obfuscated versions of the processed files\n"
 		"\t-p port\tSpecify TCP port for serving the CScout web pages\n"
 		"\t\t(the port number must be in the range 1024-32767)\n"
+		"\t-P n\tProcess the workspace's projects using n worker processes\n"
 #ifdef PICO_QL
 		"\t-q\tProvide a PiCO_QL query interface\n"
 #endif
 		"\t-r\tGenerate an identifier and include file warning report\n"
+		"\t-R file\tProcess only the units that changed since the image in file\n"
+		"\t-S file\tSave an image of the processed workspace in file\n"
 		"\t-s db\tGenerate SQL output for the specified RDBMS\n"
+#ifdef SQLITE_DB
+		"\t\t(sqlite:file writes an SQLite database into file)\n"
+#endif
+		"\t-t\tReport processing times and event counts in JSON on exit\n"
+		"\t-u\tReplay the results of units processed again in the same context\n"
 		"\t-v\tDisplay version and copyright information and exit\n"
+		"\t-w port[:n]\tAlso serve the read-only pages concurrently on the\n"
+		"\t\tspecified port using n processes (the default is the number\n"
+		"\t\tof available processors)\n"
 		"\t-3\tEnable the handling of trigraph characters\n"
 		;
 	exit(1);
@@ -3139,15 +3506,15 @@ usage(char *fname)
 int
 main(int argc, char *argv[])
 {
-	Pdtoken t;
 	int c;
+	bool cpp_output = false;	// -d option specified
 #ifdef PICO_QL
 	bool pico_ql = false;
 #endif
 
 	Debug::db_read();
 
-	while ((c = getopt(argc, argv, "3bCcd:rvEp:m:l:os:" PICO_QL_OPTIONS)) != EOF)
+	while ((c = getopt(argc, argv, "3B:bCcd:rvEGj:L:MP:p:m:l:oR:S:s:tuw:" PICO_QL_OPTIONS)) != EOF)
 		switch (c) {
 		case '3':
 			Fchar::enable_trigraphs();
@@ -3160,6 +3527,13 @@ main(int argc, char *argv[])
 		case 'C':
 			CTag::enable();
 			break;
+		case 'G':
+			Pdtoken::set_reread_guarded();
+			break;
+		case 'B':
+			if (!optarg || !Sql::setBulkMode(optarg))
+				usage(argv[0]);
+			break;
 		#ifdef PICO_QL
 		case 'q':
 			pico_ql = true;
@@ -3173,6 +3547,7 @@ main(int argc, char *argv[])
 		case 'd':
 			if (!optarg)
 				usage(argv[0]);
+			cpp_output = true;
 			switch (*optarg) {
 			case 'D':	// Similar to gcc -dD
 				Pdtoken::set_output_defines();
@@ -3184,6 +3559,40 @@ main(int argc, char *argv[])
 				usage(argv[0]);
 			}
 			break;
+		case 'j':
+			if (!optarg || atoi(optarg) < 1)
+				usage(argv[0]);
+			nthreads = atoi(optarg);
+			break;
+		case 'L':
+			if (!optarg)
+				usage(argv[0]);
+			load_image = optarg;
+			break;
+		case 'R':
+			if (!optarg)
+				usage(argv[0]);
+			reprocess_image = optarg;
+			break;
+		case 'S':
+			if (!optarg)
+				usage(argv[0]);
+			save_image = optarg;
+			break;
+		case 't':
+			profile_report = true;
+			break;
+		case 'M':
+			memory_report = true;
+			break;
+		case 'u':
+			unit_cache = true;
+			break;
+		case 'P':
+			if (!optarg || atoi(optarg) < 1)
+				usage(argv[0]);
+			Parallel::set_workers(atoi(optarg));
+			break;
 		case 'p':
 			if (!optarg)
 				usage(argv[0]);
@@ -3191,6 +3600,16 @@ main(int argc, char *argv[])
 			if (portno < 1024 || portno > 32767)
 				usage(argv[0]);
 			break;
+		case 'w':
+			if (!optarg)
+				usage(argv[0]);
+			read_port = atoi(optarg);
+			if (read_port < 1024 || read_port > 32767)
+				usage(argv[0]);
+			if (strchr(optarg, ':') &&
+			    (read_workers = atoi(strchr(optarg, ':') + 1)) < 1)
+				usage(argv[0]);
+			break;
 		case 'm':
 			if (!optarg)
 				usage(argv[0]);
@@ -3210,12 +3629,10 @@ main(int argc, char *argv[])
 		case 'l':
 			if (!optarg)
 				usage(argv[0]);
-			FILE *logfile;
 			if ((logfile = fopen(optarg, "a")) == NULL) {
 				perror(optarg);
 				exit(1);
 			}
-			swill_log(logfile);
 			break;
 		case 'o':
 			if (process_mode)
@@ -3235,10 +3652,43 @@ main(int argc, char *argv[])
 		}
 
 
-	// We require exactly one argument
-	if (argv[optind] == NULL || argv[optind + 1] != NULL)
+	/*
+	 * We require exactly one argument, unless we restore
+	 * an already processed workspace, which we can only browse
+	 * or report on.
+	 */
+	if (load_image) {
+		if (argv[optind] != NULL || save_image || reprocess_image ||
+		    (process_mode != pm_unspecified && process_mode != pm_report &&
+		    process_mode != pm_database))
+			usage(argv[0]);
+	} else if (argv[optind] == NULL || argv[optind + 1] != NULL)
+		usage(argv[0]);
+	// Units that are not processed again can't contribute to these outputs
+	if (reprocess_image && (db_engine || process_mode == pm_preprocess ||
+	    process_mode == pm_obfuscation))
+		usage(argv[0]);
+	/*
+	 * Workers process the units starting from an empty workspace,
+	 * and claim projects in an order that varies between runs
+	 */
+	if (Parallel::get_workers() && (load_image || reprocess_image ||
+	    cpp_output || monitor.is_valid() || CTag::is_enabled()))
+		usage(argv[0]);
+	// Replayed units produce no preprocessor output, ctags, or monitoring
+	if (unit_cache && (load_image || cpp_output || process_mode == pm_preprocess ||
+	    monitor.is_valid() || CTag::is_enabled()))
+		usage(argv[0]);
+	// Browse-only sessions already serve their requests concurrently
+	if (read_port && (browse_only || read_port == portno ||
+	    process_mode != pm_unspecified))
 		usage(argv[0]);
 
+	if (nthreads == 0 && (nthreads = thread::hardware_concurrency()) == 0)
+		nthreads = 1;
+	if (read_workers == 0 && (read_workers = thread::hardware_concurrency()) == 0)
+		read_workers = 1;
+
 	if (process_mode == pm_preprocess) {
 		Project::set_current_project("unspecified");
 		Fchar::set_input(argv[optind]);
@@ -3257,27 +3707,80 @@ main(int argc, char *argv[])
 	if (db_engine) {
 		if (!Sql::setEngine(db_engine))
 			return 1;
-		cout << Sql::getInterface()->begin_commands();
-		workdb_schema(Sql::getInterface(), cout);
+		if (Parallel::get_workers() &&
+		    (Sql::getInterface()->writes_database() || Sql::getBulkMode() == Sql::bm_csv))
+			/*
+			 * @error
+			 * The worker processes specified with the -P option
+			 * can only output SQL text; they cannot write into
+			 * an SQLite database or into CSV files
+			 */
+			Error::error(E_FATAL, "the -P option cannot be combined with direct or CSV table output", false);
+		ostringstream schema;
+		schema << Sql::getInterface()->begin_commands();
+		workdb_schema(Sql::getInterface(), schema);
+		Sql::getInterface()->execute(schema.str());
 	}
 
 	Project::set_current_project("unspecified");
+	if (profile_report)
+		atexit(profile_exit);
+	if (memory_report)
+		atexit(memory_exit);
+	Profile::start();
+
+	if (save_image) {
+		Snapshot::record_linkage();
+		Fdep::defer_dump();
+	}
+
+	// True when the workspace's post-processing results are available
+	bool analyzed = false;
+	if (load_image) {
+		input_file_id = Snapshot::load(load_image);
+		analyzed = true;
+	} else if (reprocess_image && monitor.is_valid())
+		/*
+		 * @error
+		 * The -R option cannot be combined with identifier
+		 * monitoring, because the workspace image lacks the
+		 * identifiers that monitoring removed
+		 */
+		Error::error(E_FATAL, "the -R and -m options are incompatible", false);
+	else if (reprocess_image && Snapshot::is_image_of(reprocess_image, argv[optind])) {
+		Fileidset stale;
+
+		input_file_id = Snapshot::load(reprocess_image);
+		if (Snapshot::retract_changed(stale)) {
+			vector <Fileid> units(Fileid::files(false));
+			for (vector <Fileid>::const_iterator i = units.begin(); i != units.end(); i++)
+				if (i->compilation_unit() && stale.find(*i) == stale.end())
+					Pdtoken::skip_unit(*i);
+		} else
+			analyzed = true;
+	} else if (reprocess_image)
+		/*
+		 * @error
+		 * The workspace image specified with the -R option
+		 * does not exist or was not created from the current
+		 * version of the workspace file
+		 */
+		Error::error(E_WARN, string(reprocess_image) + ": no image of the current workspace; processing all files", false);
 
-	// Set the contents of the master file as immutable
-	Fileid fi = Fileid(argv[optind]);
-	fi.set_readonly(true);
-
-	// Pass 1: process master file loop
-	Fchar::set_input(argv[optind]);
-	Error::set_parsing(true);
-	do
-		t.getnext();
-	while (t.get_code() != EOF);
-	Error::set_parsing(false);
-
-	input_file_id = Fileid(argv[optind]);
+	if (!analyzed) {
+		if (unit_cache)
+			UnitCache::enable(argv[optind]);
+		if (Parallel::get_workers())
+			input_file_id = Parallel::process(argv[optind], process_workspace);
+		else {
+			process_workspace(argv[optind]);
+			input_file_id = Fileid(argv[optind]);
+		}
 
-	Fileid::unify_identical_files();
+		PhaseTimer timer(Profile::ph_postprocess);
+		Fileid::unify_identical_files();
+		Tokid::resolve_all();
+	}
 
 	if (process_mode == pm_obfuscation)
 		return obfuscate();
@@ -3285,52 +3788,60 @@ main(int argc, char *argv[])
 	// Pass 2: Create web pages
 	files = Fileid::files(true);
 
-	if (process_mode != pm_compile) {
-		swill_handle("sproject.html", select_project_page, 0);
-		swill_handle("replacements.html", replacements_page, 0);
-		swill_handle("xreplacements.html", xreplacements_page, NULL);
-		swill_handle("funargrefs.html", funargrefs_page, 0);
-		swill_handle("xfunargrefs.html", xfunargrefs_page, NULL);
-		swill_handle("options.html", options_page, 0);
-		swill_handle("soptions.html", set_options_page, 0);
-		swill_handle("save_options.html", save_options_page, 0);
-		swill_handle("sexit.html", write_quit_page, "exit");
-		swill_handle("save.html", write_quit_page, 0);
-		swill_handle("qexit.html", quit_page, 0);
-	}
-
-	// Populate the EC identifier member and the directory tree
-	for (vector <Fileid>::iterator i = files.begin(); i != files.end(); i++) {
-		file_analyze(*i);
-		dir_add_file(*i);
-	}
+	if (process_mode != pm_compile)
+		web_setup();
 
-	// Update file and function metrics
-	file_msum.summarize_files();
-	fun_msum.summarize_functions();
+	if (analyzed) {
+		// The image contains the post-processing results
+		for (vector <Fileid>::const_iterator i = files.begin(); i != files.end(); i++)
+			dir_add_file(*i);
+		file_msum.summarize_files();
+		fun_msum.summarize_functions();
+	} else {
+		// Populate the EC identifier member and the directory tree
+		{
+			PhaseTimer timer(Profile::ph_postprocess);
+			files_analyze(files, nthreads);
+		}
 
-	// Set runtime file dependencies
-	GlobObj::set_file_dependencies();
+		// Update file and function metrics
+		{
+			PhaseTimer timer(Profile::ph_metrics);
+			file_msum.summarize_files();
+			fun_msum.summarize_functions();
+		}
 
-	// Set xfile and  metrics for each identifier
-	cerr << "Processing identifiers" << endl;
-	for (IdProp::iterator i = ids.begin(); i != ids.end(); i++) {
-		progress(i, ids);
-		Eclass *e = (*i).first;
-		IFSet ifiles = e->sorted_files();
-		(*i).second.set_xfile(ifiles.size() > 1);
-		// Update metrics
-		id_msum.add_unique_id(e);
+		// Set runtime file dependencies
+		GlobObj::set_file_dependencies();
+
+		// Set xfile and  metrics for each identifier
+		cerr << "Processing identifiers" << endl;
+		PhaseTimer timer(Profile::ph_xfile);
+		for (IdProp::iterator i = ids.begin(); i != ids.end(); i++) {
+			progress(i, ids);
+			Eclass *e = (*i).first;
+			(*i).second.set_xfile(e->get_files().size() > 1);
+			// Update metrics
+			id_msum.add_unique_id(e);
+		}
+		cerr << endl;
 	}
-	cerr << endl;
+	Profile::stop();
+
+	if (save_image)
+		Snapshot::save(save_image, input_file_id);
 
 	if (DP())
 		cout << "Size " << file_msum.get_total(Metrics::em_nchar) << endl;
 
 	if (Sql::getInterface()) {
+		// Dependencies of the workers' units or of a restored image
+		Fdep::dump_deferred(Sql::getInterface());
 		workdb_rest(Sql::getInterface(), cout);
 		Call::dumpSql(Sql::getInterface(), cout);
-		cout << Sql::getInterface()->end_commands();
+		Sql::getInterface()->flush_tables(true);
+		Sql::getInterface()->execute(Sql::getInterface()->end_commands());
+		Sql::getInterface()->close();
 #ifdef LINUX_STAT_MONITOR
 		char buff[100];
 		sprintf(buff, "cat /proc/%u/stat >%u.stat", getpid(), getpid());
@@ -3342,41 +3853,6 @@ main(int argc, char *argv[])
 		return 0;
 	}
 
-	if (process_mode != pm_compile) {
-		swill_handle("src.html", source_page, NULL);
-		swill_handle("qsrc.html", query_source_page, NULL);
-		swill_handle("fedit.html", fedit_page, NULL);
-		swill_handle("file.html", file_page, NULL);
-		swill_handle("dir.html", dir_page, NULL);
-
-		// Identifier query and execution
-		swill_handle("iquery.html", iquery_page, NULL);
-		swill_handle("xiquery.html", xiquery_page, NULL);
-		// File query and execution
-		swill_handle("filequery.html", filequery_page, NULL);
-		swill_handle("xfilequery.html", xfilequery_page, NULL);
-		swill_handle("qinc.html", query_include_page, NULL);
-
-		// Function query and execution
-		swill_handle("funquery.html", funquery_page, NULL);
-		swill_handle("xfunquery.html", xfunquery_page, NULL);
-
-		swill_handle("id.html", identifier_page, NULL);
-		swill_handle("fun.html", function_page, NULL);
-		swill_handle("funlist.html", funlist_page, NULL);
-		swill_handle("funmetrics.html", function_metrics_page, NULL);
-		swill_handle("filemetrics.html", file_metrics_page, NULL);
-		swill_handle("idmetrics.html", id_metrics_page, NULL);
-
-		graph_handle("cgraph", cgraph_page);
-		graph_handle("fgraph", fgraph_page);
-		graph_handle("cpath", cpath_page);
-
-		swill_handle("about.html", about_page, NULL);
-		swill_handle("setproj.html", set_project_page, NULL);
-		swill_handle("logo.png", logo_page, NULL);
-		swill_handle("index.html", (void (*)(FILE *, void *))((char *)index_page), 0);
-	}
 
 
 	if (file_msum.get_writable(Metrics::em_nuline)) {
@@ -3400,7 +3876,9 @@ main(int argc, char *argv[])
 	if (pico_ql) {
 		pico_ql_register(&files, "files");
 		pico_ql_register(&Identifier::ids, "ids");
-		pico_ql_register(&Tokid::tm, "tm");
+		static map <Tokid, Eclass *> tm;
+		Tokid::copy_map(tm);
+		pico_ql_register(&tm, "tm");
 		pico_ql_register(&Call::functions(), "fun_map");
 		while (pico_ql_serve(portno))
 			;
@@ -3410,15 +3888,30 @@ main(int argc, char *argv[])
 
 	if (process_mode == pm_compile)
 		return (0);
-	if (DP())
+	build_name_indexes();
+	if (DP()) {
 		cout  << "Tokid EC map size is " << Tokid::map_size() << endl;
+		const Pool &ecp = Eclass::get_pool();
+		cout << "Equivalence classes allocated " << ecp.get_allocated() <<
+		    " live " << ecp.get_live() << " peak " << ecp.get_peak() <<
+		    " reserved bytes " << ecp.get_reserved() << endl;
+	}
 	// Serve web pages
 	if (!must_exit)
 		cerr << "CScout is now ready to serve you at http://localhost:" << portno << endl;
 	if (browse_only)
 		swill_setfork();
-	while (!must_exit)
+	if (read_port && !must_exit) {
+		ReadServer::set_port(read_port, read_workers);
+		ReadServer::start(web_setup);
+		atexit(ReadServer::stop);
+		cerr << "Read-only pages are served concurrently at http://localhost:" << read_port << endl;
+	}
+	while (!must_exit) {
 		swill_serve();
+		ReadServer::refresh();
+	}
+	ReadServer::stop();
 
 #ifdef NODE_USE_PROFILE
 	cout << "Type node count = " << Type_node::get_count() << endl;
@@ -3434,6 +3927,7 @@ main(int argc, char *argv[])
 void
 garbage_collect(Fileid root)
 {
+	PhaseTimer timer(Profile::ph_gc);
 	vector <Fileid> files(Fileid::files(false));
 	set <Fileid> touched_files;
 
@@ -3461,26 +3955,12 @@ garbage_collect(Fileid root)
 			continue;
 		}
 
-		const string &fname = fi.get_path();
-		fifstream in;
-
-		in.open(fname.c_str(), ios::binary);
-		if (in.fail()) {
-			perror(fname.c_str());
-			exit(1);
-		}
+		FileScan scan(fi);
 		// Go through the file character by character
-		for (;;) {
-			Tokid ti;
-			int val;
-
-			ti = Tokid(fi, in.tellg());
-			if ((val = in.get()) == EOF)
-				break;
-			mapTokidEclass::iterator ei = ti.find_ec();
-			if (ei != ti.end_ec()) {
+		while (scan.next()) {
+			Eclass *ec = scan.get_ec();
+			if (ec) {
 				sum++;
-				Eclass *ec = ei->second;
 				IdPropElem ec_id(ec, Identifier());
 				if (!monitor.eval(ec_id)) {
 					count++;
@@ -3489,7 +3969,6 @@ garbage_collect(Fileid root)
 				}
 			}
 		}
-		in.close();
 		fi.set_gc(true);	// Mark the file as garbage collected
 	}
 	if (DP())
@@ -3504,7 +3983,7 @@ garbage_collect(Fileid root)
 	for (set <Fileid>::const_iterator i = touched_files.begin(); i != touched_files.end(); i++)
 		if (*i != root && *i != input_file_id)
 			root.includes(*i, /* directly included (conservatively) */ false, i->required());
-	if (Sql::getInterface())
+	if (Sql::getInterface() || Fdep::deferring())
 		Fdep::dumpSql(Sql::getInterface(), root);
 	Fdep::reset();
 
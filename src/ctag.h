@@ -106,6 +106,7 @@ public:
 	static void enable() {
 		enabled = true;
 	}
+	static bool is_enabled() { return enabled; }
 	// Save ctags
 	static void save();
 
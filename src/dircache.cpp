@@ -0,0 +1,119 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * For documentation read the corresponding .h file
+ *
+ */
+
+#include <map>
+#include <set>
+#include <string>
+#include <iostream>
+#include <cctype>
+#include <cerrno>
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#include "debug.h"
+#include "os.h"
+#include "dircache.h"
+
+map <string, DirCache::Entries> DirCache::dirs;
+set <string> DirCache::unlisted;
+string DirCache::cwd;
+
+// Return the form under which names are stored and looked up
+string
+DirCache::canonical(const string &name)
+{
+#ifdef __APPLE__
+	// The file system is typically case-insensitive
+	string r(name);
+	for (string::iterator i = r.begin(); i != r.end(); i++)
+		*i = tolower(*i);
+	return r;
+#else
+	return name;
+#endif
+}
+
+// Read the entries of the directory dir into e; return false if unknown
+bool
+DirCache::read_dir(const string &dir, Entries &e)
+{
+#ifndef WIN32
+	DIR *d = opendir(dir.c_str());
+	if (d == NULL)
+		// A non-existent directory has no entries
+		return errno == ENOENT || errno == ENOTDIR;
+	struct dirent *de;
+	while ((de = readdir(d)) != NULL)
+		e.insert(canonical(de->d_name));
+	closedir(d);
+	if (DP())
+		cout << "Read " << e.size() << " entries of " << dir << "\n";
+#endif
+	return true;
+}
+
+bool
+DirCache::may_exist(const string &path)
+{
+#ifdef WIN32
+	return true;
+#else
+	string dir, name;
+	string::size_type slash = path.rfind('/');
+	if (slash == string::npos) {
+		dir = ".";
+		name = path;
+	} else {
+		dir = (slash == 0) ? string("/") : path.substr(0, slash);
+		name = path.substr(slash + 1);
+	}
+	if (!is_absolute_filename(dir)) {
+		if (cwd.empty()) {
+			char buff[4096];
+
+			if (getcwd(buff, sizeof(buff)) == NULL)
+				return true;	// Can't tell
+			cwd = buff;
+		}
+		dir = cwd + "/" + dir;
+	}
+	if (unlisted.find(dir) != unlisted.end())
+		return true;	// Can't tell
+	map <string, Entries>::iterator i = dirs.find(dir);
+	if (i == dirs.end()) {
+		i = dirs.insert(make_pair(dir, Entries())).first;
+		if (!read_dir(dir, i->second)) {
+			dirs.erase(i);
+			unlisted.insert(dir);
+			return true;
+		}
+	}
+	return i->second.find(canonical(name)) != i->second.end();
+#endif
+}
@@ -0,0 +1,65 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * A cache of directory contents.
+ * Searching for an include file probes each directory of the include
+ * path in turn, and most probes fail.  Each directory is read once,
+ * and its entries are then used to reject paths that cannot exist
+ * without a system call.  A positive answer only means that the
+ * directory has an entry with that name; the caller must still
+ * open the file.
+ * Directories that exist but cannot be read (for example, searchable
+ * but not readable ones) are left to the caller's open.
+ * Directories are keyed by their absolute path, so that the cache
+ * remains valid when the current directory changes.
+ * The cache assumes that the processed source tree does not change
+ * while it is being processed.
+ *
+ */
+
+#ifndef DIRCACHE_
+#define DIRCACHE_
+
+#include <map>
+#include <set>
+#include <string>
+
+using namespace std;
+
+class DirCache {
+private:
+	typedef set <string> Entries;
+	static map <string, Entries> dirs;	// Entries of each read directory
+	static set <string> unlisted;		// Directories that could not be read
+	static string cwd;			// Current directory; empty if unknown
+
+	// Read the entries of the directory dir into e; return false if unknown
+	static bool read_dir(const string &dir, Entries &e);
+	// Return the form under which names are stored and looked up
+	static string canonical(const string &name);
+public:
+	// Return false if path is known not to exist
+	static bool may_exist(const string &path);
+	// Must be called after changing the current directory
+	static void directory_changed() { cwd.clear(); }
+	// Forget all cached directories
+	static void clear() { dirs.clear(); unlisted.clear(); cwd.clear(); }
+};
+
+#endif /* DIRCACHE_ */
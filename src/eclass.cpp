@@ -47,6 +47,10 @@
 #include "macro.h"
 #include "pdtoken.h"
 #include "eclass.h"
+#include "unitcache.h"
+#include "snapshot.h"
+
+Pool Eclass::pool(sizeof(Eclass));
 
 // Remove references to the equivalence class from the tokid map
 // Should be called when we delete the ec for good
@@ -55,21 +59,28 @@ Eclass::remove_from_tokid_map()
 {
 	if (DP())
 		cout << "Destructing " << *this << "\n";
+	materialize();
 	for (setTokid::const_iterator i = members.begin(); i != members.end(); i++)
 		(*i).erase_ec(this);
 }
 
+/*
+ * Merge the classes rooted at a and b, returning the root of the result.
+ * The smaller class is linked under the larger one, keeping the trees
+ * shallow (union by size).
+ */
 Eclass *
 merge(Eclass *a, Eclass *b)
 {
 	Eclass *little, *large;
 	if (a == b)
 		return a;
+	Profile::count(Profile::pc_merge);
 	if (DP())
 		cout << "merge a=" << a << *a << " b=" << b << *b << "\n";
 	csassert(a->len == b->len);
-	// It is more efficient to append the little at the end of the large one
-	if (a->members.size() > b->members.size()) {
+	csassert(a->parent == NULL && b->parent == NULL);
+	if (a->size > b->size) {
 		large = a;
 		little = b;
 	} else {
@@ -77,26 +88,84 @@ merge(Eclass *a, Eclass *b)
 		little = a;
 	}
 
-	for (setTokid::const_iterator i = little->members.begin(); i != little->members.end(); i++)
-		large->add_tokid(*i);
+	little->parent = large;
+	little->sibling = large->children;
+	large->children = little;
+	large->size += little->size;
+	if (little->files.empty())
+		large->files.clear();
+	else if (!large->files.empty())
+		large->files.insert(little->files);
+	setFileid().swap(little->files);
+	Tokid::nmerged++;
+	// Readonly members have already marked little
+	if (!Pdtoken::skipping() && !Snapshot::merging())
+		large->set_attribute(Project::get_current_projid());
 	large->merge_attributes(little);
-	delete little;
 	return (large);
 }
 
+// Move the members of the classes merged into us into our members
+void
+Eclass::materialize() const
+{
+	if (children == NULL)
+		return;
+	// Gather the tree of the merged classes
+	vector <Eclass *> merged;
+	for (Eclass *c = children; c; c = c->sibling)
+		merged.push_back(c);
+	for (vector <Eclass *>::size_type i = 0; i < merged.size(); i++)
+		for (Eclass *c = merged[i]->children; c; c = c->sibling)
+			merged.push_back(c);
+
+	vector <Tokid> tokids;
+	for (vector <Eclass *>::const_iterator i = merged.begin(); i != merged.end(); i++) {
+		tokids.insert(tokids.end(), (*i)->members.begin(), (*i)->members.end());
+		delete *i;
+	}
+	Tokid::nmerged -= merged.size();
+	children = NULL;
+	Eclass *self = const_cast<Eclass *>(this);
+	for (vector <Tokid>::const_iterator i = tokids.begin(); i != tokids.end(); i++)
+		i->set_ec(self);
+	members.insert(tokids.begin(), tokids.end());
+}
+
+// Return the root of the class a tokid map slot refers to, pointing the slot to it
+Eclass *
+Tokid::resolve(Eclass **slot)
+{
+	Eclass *root = *slot;
+	if (root->parent == NULL)
+		return root;
+	while (root->parent)
+		root = root->parent;
+	// Path compression
+	for (Eclass *e = *slot, *next; e != root; e = next) {
+		next = e->parent;
+		e->parent = root;
+	}
+	*slot = root;
+	return root;
+}
+
 // Split an equivalence class after the (0-based) character position
 // pos returning the new EC receiving the split Tokids
 Eclass *
 Eclass::split(int pos)
 {
 	int oldchars = pos + 1;		// Characters to retain in the old EC
+	Profile::count(Profile::pc_split);
 	if (DP())
 		cout << "Split " << this << " pos=" << pos << *this;
 	csassert(oldchars < len);
+	materialize();
 	Eclass *e = new Eclass(len - oldchars);
 	for (setTokid::const_iterator i = members.begin(); i != members.end(); i++)
 		e->add_tokid(*i + oldchars);
 	e->attr = attr;
+	e->files = files;
 	len = oldchars;
 	if (DP()) {
 		cout << "Split A: " << *e;
@@ -110,6 +179,7 @@ operator<<(ostream& o,const Eclass& ec)
 {
 	setTokid::const_iterator i;
 
+	ec.materialize();
 	for (i = ec.members.begin(); i != ec.members.end(); i++) {
 		Tpart p(*i, ec.len);
 		o << "\t" << p << "\n";
@@ -120,30 +190,48 @@ operator<<(ostream& o,const Eclass& ec)
 void
 Eclass::add_tokid(Tokid t)
 {
-	members.insert(t);
+	if (members.insert(t)) {
+		size++;
+		Profile::count(Profile::pc_tokid);
+		if (parent)
+			// The root's files cover ours
+			for (Eclass *e = parent; e; e = e->parent)
+				e->files.clear();
+		else if (!files.empty())
+			files.insert(t.get_fileid());
+	}
 	t.set_ec(this);
 	if (t.get_readonly()) {
 		if (DP())
 			cout << "readonly " << *this << "\n";
 		set_attribute(is_readonly);
 	}
-	if (!Pdtoken::skipping()) {
+	if (!Pdtoken::skipping() && !Snapshot::merging()) {
 		set_attribute(Project::get_current_projid());
+		UnitCache::touch(t, len);
 		if (DP())
 			cout << "Set_attribute for " << t << " to " << Project::get_current_projid() << "\n";
 	}
 }
 
+// Return the files where the equivalence class appears
+const setFileid &
+Eclass::get_files() const
+{
+	materialize();
+	if (files.empty())
+		// The members are ordered by their file
+		for (setTokid::const_iterator i = members.begin(); i != members.end(); i++)
+			files.insert(i->get_fileid());
+	return files;
+}
+
 // Return a set of all files where the equivalence class appears
 IFSet
 Eclass::sorted_files()
 {
-	set <Fileid, fname_order> r;
-	setTokid::const_iterator i;
-
-	for (i = members.begin(); i != members.end(); i++)
-		r.insert(i->get_fileid());
-	return (r);
+	const setFileid &f = get_files();
+	return IFSet(f.begin(), f.end());
 }
 
 // Return a set of all functions where the equivalence class appears
@@ -153,6 +241,7 @@ Eclass::functions()
 	set <Call *> r;
 	setTokid::const_iterator i;
 
+	materialize();
 	for (i = members.begin(); i != members.end(); i++) {
 		FCallSet fc(i->get_fileid().get_functions());
 		for (FCallSet::const_iterator j = fc.begin(); j != fc.end(); j++)
@@ -170,6 +259,7 @@ Eclass::is_unused()
 {
 	if (attr.get_attribute(is_declared_unused))
 		return (false);		// Programmer knows it
+	materialize();
 	if (members.size() == 1)
 		return (true);
 	// More complex case: see if all the members come from unified identical files
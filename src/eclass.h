@@ -33,17 +33,52 @@ using namespace std;
 #include "attr.h"
 #include "tokid.h"
 #include "tokmap.h"
+#include "flatset.h"
+#include "pool.h"
+#include "profile.h"
 
-typedef set<Tokid> setTokid;
+typedef FlatSet<Tokid> setTokid;
+typedef FlatSet<Fileid> setFileid;
 
 class Call;
 
+/*
+ * Merged equivalence classes form a union-find forest.
+ * A merge links the root of the smaller tree under that of the larger
+ * one in constant time, leaving the tokid map and the members of the
+ * linked class as they are.  Looking up a tokid's class follows the
+ * parent links to the root, and points the map entry to it.
+ * The members of the merged classes are moved into the root's
+ * members (and the merged classes deleted) only when the members are
+ * needed, or when Tokid::resolve_all is called.
+ * The distinct files of a class's members are computed when first
+ * needed and then kept current as tokids are added and classes are
+ * merged and split.
+ */
 class Eclass {
+	friend class Snapshot;
+	friend class Tokid;
+	friend class MemStat;
 private:
 	int len;			// Identifier length
-	setTokid members;		// Class members
+	mutable setTokid members;	// Class members (excluding children's)
 	Attributes attr;
+	Eclass *parent;			// Class we were merged into; NULL for a root
+	mutable Eclass *children;	// Classes merged into us
+	Eclass *sibling;		// Next class merged into our parent
+	unsigned size;			// Members, including those of our children
+	// Files of the members, including the children's; empty if not computed
+	mutable setFileid files;
+	static Pool pool;		// Storage for all equivalence classes
+
+	// Move the members of the classes merged into us into our members
+	void materialize() const;
 public:
+	// Allocate equivalence classes from the pool
+	static void *operator new(size_t s) { csassert(s == sizeof(Eclass)); return pool.allocate(); }
+	static void operator delete(void *p) { pool.release(p); }
+	// Return the pool's allocation statistics
+	static const Pool &get_pool() { return pool; }
 	// An equivalence class shall know its length
 	inline Eclass(int len);
 	// It can be constructed from an initiall Tokid
@@ -59,10 +94,12 @@ public:
 	// Return length
 	int get_len() const { return len; }
 	// Return number of members
-	int get_size() { return members.size(); }
+	int get_size() { materialize(); return members.size(); }
 	friend ostream& operator<<(ostream& o,const Eclass& ec);
-	const setTokid & get_members(void) const { return members; }
-	// Files where the this appears
+	const setTokid & get_members(void) const { materialize(); return members; }
+	// Files where the this appears, ordered by their id
+	const setFileid &get_files() const;
+	// Files where the this appears, ordered by their name
 	IFSet sorted_files();
 	// Functions where the this appears
 	set <Call *> functions();
@@ -78,16 +115,21 @@ public:
 	void remove_from_tokid_map();
 };
 
+// Make merge visible to classes with a merge method of their own
+Eclass *merge(Eclass *a, Eclass *b);
+
 inline
 Eclass::Eclass(int l)
-: len(l)
+: len(l), parent(NULL), children(NULL), sibling(NULL), size(0)
 {
+	Profile::count(Profile::pc_eclass);
 }
 
 inline
 Eclass::Eclass(Tokid t, int l)
-: len(l)
+: len(l), parent(NULL), children(NULL), sibling(NULL), size(0)
 {
+	Profile::count(Profile::pc_eclass);
 	add_tokid(t);
 }
 
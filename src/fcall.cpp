@@ -54,15 +54,36 @@
 #include "fcall.h"
 #include "eclass.h"
 #include "ctag.h"
+#include "parallel.h"
 
 // Constructor
 FCall::FCall(const Token& tok, Type typ, const string &s) :
 		Call(s, tok),
 		type(typ),
-		defined(false)
+		defined(false),
+		first_defined(-1),
+		last_defined(-1),
+		last_declared(-1)
 {
 }
 
+// Note the workspace segment of a definition
+void
+FCall::mark_defined()
+{
+	if (first_defined == -1)
+		first_defined = Parallel::get_segment();
+	last_defined = Parallel::get_segment();
+}
+
+// Set the number of parameters from the function's declaration
+void
+FCall::set_nparam(int n)
+{
+	metrics().set_metric(FunMetrics::em_nparam, n);
+	last_declared = Parallel::get_segment();
+}
+
 /*
  * Set the function currently being parsed
  * This is used for defining yytab, which is not explicitly defined
@@ -79,6 +100,7 @@ FCall::set_current_fun(const Id *id)
 	cfun->metrics().set_metric(FunMetrics::em_ngnsoc,
 	    Block::global_namespace_occupants_size() +
 	    Pdtoken::macros_size());
+	cfun->mark_defined();
 	nesting.push(current_fun);
 }
 
@@ -112,6 +134,7 @@ FCall::set_current_fun(const Type &t)
 	cfun->metrics().set_metric(FunMetrics::em_ngnsoc,
 	    Block::global_namespace_occupants_size() +
 	    Pdtoken::macros_size());
+	cfun->mark_defined();
 	nesting.push(cfun);
 	if (nesting.size() == 1)
 		Fchar::get_fileid().metrics().add_function(t.is_static());
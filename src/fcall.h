@@ -36,14 +36,25 @@
 
 // C function calling information
 class FCall : public Call {
+	friend class Snapshot;
 private:
 	Tokid definition;		// Function's definition
 	Type type;			// Function's type
 	bool defined;			// True if the function has been defined
+	/*
+	 * Workspace segments (see parallel.h) of the function's first
+	 * and last definition and its last declaration; these set
+	 * different details, which are merged in workspace order
+	 */
+	long first_defined, last_defined, last_declared;
 public:
 	// Set the C function currently being parsed
 	static void set_current_fun(const Type &t);
 	static void set_current_fun(const Id *id);
+	// Set the number of parameters from the function's declaration
+	void set_nparam(int n);
+	// Note the workspace segment of a definition
+	void mark_defined();
 
 	virtual Tokid get_definition() const { return definition; }
 	virtual bool is_defined() const { return defined; }
@@ -48,8 +48,10 @@
 #include "pdtoken.h"
 #include "parse.tab.h"
 #include "fdep.h"
+#include "unitcache.h"
+#include "profile.h"
 
-fifstream Fchar::in;
+mapfstream Fchar::in;
 Fileid Fchar::fi;
 StackFcharContext Fchar::cs;		// Pushed contexts (from push_input())
 stackFchar Fchar::ps;			// Putback Fchars (from putback())
@@ -83,6 +85,8 @@ Fchar::push_input(const string& s, int offset)
 	Fileid includer = fi;
 	int include_lnum = line_number - 1;
 
+	Profile::count(Profile::pc_include);
+
 	cs.push(get_context());
 	if (output_headers) {
 		for (StackFcharContext::size_type i = 0; i < cs.size(); i++)
@@ -99,6 +103,18 @@ Fchar::push_input(const string& s, int offset)
 		putback(Fchar(YACC_COOKIE));
 }
 
+void
+Fchar::skip_input(const string& s)
+{
+	Profile::count(Profile::pc_include);
+
+	if (output_headers) {
+		for (StackFcharContext::size_type i = 0; i <= cs.size(); i++)
+			cout << '.';
+		cout << ' ' << s << endl;
+	}
+}
+
 void
 Fchar::putback(Fchar c)
 {
@@ -193,6 +209,7 @@ Fchar::getnext()
 		if (val == EOF) {
 			fi.metrics().done_processing();
 			fi.set_attribute(Project::get_current_projid());
+			UnitCache::touch(fi);
 			if (DP())
 				cout << "Set projid for " << fi.get_path() << " = " << Project::get_current_projid() << "\n";
 		}
@@ -34,6 +34,7 @@
 #include "tokid.h"
 #include "fchar.h"
 #include "fifstream.h"
+#include "mapfstream.h"
 
 using namespace std;
 
@@ -70,7 +71,7 @@ class Fchar {
 private:
 	void simple_getnext();		// Trigraphs and slicing
 	static bool trigraphs_enabled;	// True if trigraphs are enabled
-	static fifstream in;		// Stream we are reading from
+	static mapfstream in;		// Memory-mapped file we are reading from
 	static Fileid fi;		// and its Fileid
 	static int line_number;		// Current line number
 	static bool yacc_file;		// True if input file is yacc, not C
@@ -90,8 +91,12 @@ public:
 	// Offset is the location of the include file path where the file
 	// was located, and is used for implementing include_next
 	static void push_input(const string& s, int offset = 0);
+	// Account for including s, like push_input, without reading it
+	static void skip_input(const string& s);
 	// Next constructor will return c
 	static void putback(Fchar c);
+	// Exchange the putback stack with s (for reading another file mid-line)
+	static void swap_putback(stackFchar &s) { swap(ps, s); }
 	/*
 	 * Lock current context into the file stack, so it can not
 	 * be popped by getnext until unlock is called.
@@ -100,6 +105,8 @@ public:
 	static void lock_stack() { stack_lock_size = cs.size(); }
 	static void unlock_stack() { stack_lock_size = 0; }
 	static void set_output_headers() { output_headers = true; }
+	// Return true when reading the top-level file (the workspace)
+	static bool at_top() { return cs.empty(); }
 
 	// Return the current file position
 	static FcharContext get_context() {
@@ -49,6 +49,8 @@ set <Fileid> Fdep::providers;	// Files providing code and data
 Fileid Fdep::last_provider;	// Cache last value entered
 // Symbols for which a given file is included
 map <Fdep::include_trigger_domain, Fdep::include_trigger_value> Fdep::include_triggers;
+bool Fdep::defer;			// Defer the SQL dumps
+vector <Fdep::UnitState> Fdep::deferred;	// Units whose dump was deferred
 
 /*
  * Mark transitively as used:
@@ -97,45 +99,119 @@ Fdep::reset()
 	last_provider = Fileid();	// Clear cache
 }
 
+// Save the current dependencies into s
+void
+Fdep::save(State &s)
+{
+	s.definers = definers;
+	s.includers = includers;
+	s.providers = providers;
+	s.include_triggers = include_triggers;
+}
+
+// Replace the current dependencies with s
+void
+Fdep::restore(const State &s)
+{
+	definers = s.definers;
+	includers = s.includers;
+	providers = s.providers;
+	include_triggers = s.include_triggers;
+	last_provider = Fileid();	// Clear cache
+}
+
+// Add the dependencies s to the current ones
+void
+Fdep::add(const State &s)
+{
+	for (FSFMap::const_iterator i = s.definers.begin(); i != s.definers.end(); i++)
+		definers[i->first].insert(i->second.begin(), i->second.end());
+	for (FSFMap::const_iterator i = s.includers.begin(); i != s.includers.end(); i++)
+		includers[i->first].insert(i->second.begin(), i->second.end());
+	providers.insert(s.providers.begin(), s.providers.end());
+	for (ITMap::const_iterator i = s.include_triggers.begin(); i != s.include_triggers.end(); i++)
+		include_triggers[i->first].insert(i->second.begin(), i->second.end());
+	last_provider = Fileid();	// Clear cache
+}
+
 /*
  * Dump using the provided SQL interface
  * the defines, providers and includers for the
  * compilation unit cu
  */
 void
-Fdep::dumpSql(Sql *db, Fileid cu)
+Fdep::dumpSql(Sql *db, int pid, Fileid cu, const FSFMap &dmap,
+    const FSFMap &imap, const set <Fileid> &provs, const ITMap &trigs)
 {
-	for (FSFMap::const_iterator di = definers.begin(); di != definers.end(); di++) {
+	SqlTable &tdefiners = db->table(cout, "DEFINERS");
+	SqlTable &tincluders = db->table(cout, "INCLUDERS");
+	SqlTable &tproviders = db->table(cout, "PROVIDERS");
+	SqlTable &tinctriggers = db->table(cout, "INCTRIGGERS");
+
+	for (FSFMap::const_iterator di = dmap.begin(); di != dmap.end(); di++) {
 		const set <Fileid> &defs = di->second;
-		for (set <Fileid>::const_iterator i = defs.begin(); i != defs.end(); i++)
-			cout << "INSERT INTO DEFINERS VALUES(" <<
-			Project::get_current_projid() << ',' <<
-			cu.get_id() << ',' <<
-			di->first.get_id() << ',' <<
-			i->get_id() << ");\n";
+		for (set <Fileid>::const_iterator i = defs.begin(); i != defs.end(); i++) {
+			tdefiners << pid << cu.get_id() << di->first.get_id() << i->get_id();
+			tdefiners.end_row();
+		}
 	}
-	for (FSFMap::const_iterator ii = includers.begin(); ii != includers.end(); ii++) {
+	for (FSFMap::const_iterator ii = imap.begin(); ii != imap.end(); ii++) {
 		const set <Fileid> &incs = ii->second;
-		for (set <Fileid>::const_iterator i = incs.begin(); i != incs.end(); i++)
-			cout << "INSERT INTO INCLUDERS VALUES(" <<
-			Project::get_current_projid() << ',' <<
-			cu.get_id() << ',' <<
-			ii->first.get_id() << ',' <<
-			i->get_id() << ");\n";
+		for (set <Fileid>::const_iterator i = incs.begin(); i != incs.end(); i++) {
+			tincluders << pid << cu.get_id() << ii->first.get_id() << i->get_id();
+			tincluders.end_row();
+		}
 	}
-	for (set <Fileid>::const_iterator i = providers.begin(); i != providers.end(); i++)
-		cout << "INSERT INTO PROVIDERS VALUES(" <<
-		Project::get_current_projid() << ',' <<
-		cu.get_id() << ',' <<
-		i->get_id() << ");\n";
-	for (ITMap::const_iterator i = include_triggers.begin(); i != include_triggers.end(); i++)
+	for (set <Fileid>::const_iterator i = provs.begin(); i != provs.end(); i++) {
+		tproviders << pid << cu.get_id() << i->get_id();
+		tproviders.end_row();
+	}
+	for (ITMap::const_iterator i = trigs.begin(); i != trigs.end(); i++)
 		for (include_trigger_value::const_iterator j = i->second.begin(); j != i->second.end(); j++) {
-			cout << "INSERT INTO INCTRIGGERS VALUES(" <<
-			Project::get_current_projid() << ',' <<
-			cu.get_id() << ',' <<
-			i->first.second.get_id() << ',' <<
-			i->first.first.get_id() << ',' <<
-			(unsigned)(j->first) << ',' <<
-			j->second << ");\n";
+			tinctriggers << pid <<
+			cu.get_id() <<
+			i->first.second.get_id() <<
+			i->first.first.get_id() <<
+			(unsigned)(j->first) <<
+			j->second;
+			tinctriggers.end_row();
 		}
 }
+
+/*
+ * Create SQL dump of the dependencies gathered while processing the
+ * compilation unit cu
+ */
+void
+Fdep::dumpSql(Sql *db, Fileid cu)
+{
+	int pid = Project::get_current_projid();
+
+	if (defer) {
+		deferred.push_back(UnitState());
+		deferred.back().pid = pid;
+		deferred.back().cu = cu;
+		save(deferred.back().deps);
+	} else
+		dumpSql(db, pid, cu, definers, includers, providers, include_triggers);
+}
+
+// Create the SQL dump of the deferred dependencies
+void
+Fdep::dump_deferred(Sql *db)
+{
+	for (vector <UnitState>::const_iterator i = deferred.begin(); i != deferred.end(); i++)
+		dumpSql(db, i->pid, i->cu, i->deps.definers, i->deps.includers,
+		    i->deps.providers, i->deps.include_triggers);
+}
+
+// Forget the deferred dependencies of the compilation units in r
+void
+Fdep::forget_deferred(const set <Fileid> &r)
+{
+	vector <UnitState> live;
+	for (vector <UnitState>::const_iterator i = deferred.begin(); i != deferred.end(); i++)
+		if (r.find(i->cu) == r.end())
+			live.push_back(*i);
+	deferred.swap(live);
+}
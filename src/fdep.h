@@ -41,6 +41,8 @@ class Sql;
 
 // A container for file dependencies
 class Fdep {
+	friend class MemStat;
+	friend class Snapshot;
 private:
 	typedef map <Fileid, set <Fileid> > FSFMap;	// A map from Fileid to set of Fileid
 	static FSFMap definers;				// Files containing definitions needed in a given file
@@ -54,6 +56,33 @@ private:
 	static ITMap include_triggers;			// Symbols for which a given file is included
 	static void mark_required_transitive(Fileid f);
 public:
+	// The dependencies gathered while processing a compilation unit
+	struct State {
+		FSFMap definers;
+		FSFMap includers;
+		set <Fileid> providers;
+		ITMap include_triggers;
+	};
+private:
+	// The dependencies of a compilation unit whose SQL dump is deferred
+	struct UnitState {
+		int pid;			// The unit's project
+		Fileid cu;			// The unit
+		State deps;
+	};
+	static bool defer;			// Defer the SQL dumps
+	static vector <UnitState> deferred;	// Units whose dump was deferred
+	// Create the SQL dump of the given dependencies of the compilation unit cu
+	static void dumpSql(Sql *db, int pid, Fileid cu, const FSFMap &dmap,
+	    const FSFMap &imap, const set <Fileid> &provs, const ITMap &trigs);
+public:
+	// Save the current dependencies into s
+	static void save(State &s);
+	// Replace the current dependencies with s
+	static void restore(const State &s);
+	// Add the dependencies s to the current ones
+	static void add(const State &s);
+
 	// File def contains a definition needed by file ref
 	static void add_def_ref(Tokid def, Tokid ref, int len) {
 		if (def.get_fileid() == ref.get_fileid())
@@ -90,6 +119,18 @@ public:
 	static void reset();
 	// Create SQL dump
 	static void dumpSql(Sql *db, Fileid cu);
+	/*
+	 * Keep the dependencies instead of dumping them, until
+	 * dump_deferred is called.  Used by processes whose file ids
+	 * are renumbered before their results are output, and for
+	 * storing the dependencies in workspace images.
+	 */
+	static void defer_dump() { defer = true; }
+	static bool deferring() { return defer; }
+	// Create the SQL dump of the deferred dependencies
+	static void dump_deferred(Sql *db);
+	// Forget the deferred dependencies of the compilation units in r
+	static void forget_deferred(const set <Fileid> &r);
 };
 
 
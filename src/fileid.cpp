@@ -54,6 +54,7 @@
 #include "call.h"
 #include "md5.h"
 #include "os.h"
+#include "parallel.h"
 
 int Fileid::counter;		// To generate ids
 FI_uname_to_id Fileid::u2i;	// From unique name to id
@@ -127,6 +128,8 @@ Fileid::Fileid(const string &name)
 
 		u2i[sid] = id = counter++;
 		i2d.push_back(Filedetails(fpath, is_readonly(name.c_str()), hash));
+		if (Parallel::own_project())
+			i2d.back().set_segment(Parallel::get_segment());
 
 		identical_files[hash].insert(*this);
 	}
@@ -190,6 +193,9 @@ Filedetails::Filedetails(string n, bool r, const FileHash &h) :
 	m_compilation_unit(false),
 	hash(h),
 	ipath_offset(0),
+	segment(-1),
+	guard_scanned(false),
+	guard_offs(0),
 	hand_edited(false),
 	visited(false)
 {
@@ -199,6 +205,9 @@ Filedetails::Filedetails(string n, bool r, const FileHash &h) :
 Filedetails::Filedetails() :
 	m_compilation_unit(false),
 	ipath_offset(0),
+	segment(-1),
+	guard_scanned(false),
+	guard_offs(0),
 	hand_edited(false)
 {
 }
@@ -312,6 +321,9 @@ Filedetails::hand_edit()
 	if (DP())
 		cout << '[' << contents << ']' << endl;
 	hand_edited = true;
+	forget_include_guard();
+	// The file will change under us; don't serve its stale image
+	MappedFile::forget(get_name());
 	return 0;
 }
 
@@ -86,6 +86,8 @@ typedef set <Fileid> Fileidset;
 
 // Details we keep for each file
 class Filedetails {
+	friend class Snapshot;
+	friend class MemStat;
 private:
 	string name;	// File name (complete path)
 	bool m_garbage_collected;	// When postprocessing files to garbage collect ECs
@@ -100,6 +102,10 @@ private:
 	FileIncMap includers;	// Files that include us
 	FileHash hash;			// MD5 hash for the file's contents
 	int ipath_offset;	// Offset in the include file path where this file was found
+	long segment;		// Workspace segment (see parallel.h) we processed when opening the file; -1 if skipped
+	bool guard_scanned;	// True after looking for an include guard
+	string guard;		// Include guard macro name; empty if none
+	cs_offset_t guard_offs;	// Offset of the guard's name in #ifndef
 	Fileidset runtime_uses;	// Files whose global objects this file uses at runtime
 	Fileidset runtime_used_by;	// Files that use at runtime this file's global objects
 
@@ -148,6 +154,17 @@ public:
 	// Include file path offset
 	int get_ipath_offset() const { return ipath_offset; }
 	void set_ipath_offset(int o) { ipath_offset = o; }
+	void set_segment(long s) { segment = s; }
+	// Multiple-inclusion guard
+	bool include_guard_scanned() const { return guard_scanned; }
+	void set_include_guard(const string &g, cs_offset_t o) {
+		guard_scanned = true;
+		guard = g;
+		guard_offs = o;
+	}
+	void forget_include_guard() { guard_scanned = false; guard.clear(); }
+	const string &get_include_guard() const { return guard; }
+	cs_offset_t get_include_guard_offset() const { return guard_offs; }
 	void set_visited() { visited = true; }
 	void clear_visited() { visited = false; }
 	bool is_visited() const { return visited; }
@@ -178,6 +195,8 @@ typedef map <FileHash, set<Fileid> > FI_hash_to_ids;
  * Add details in the Filedetails class
  */
 class Fileid {
+	friend class Snapshot;
+	friend class MemStat;
 private:
 	int id;				// One global unique id per workspace file
 
@@ -253,6 +272,15 @@ public:
 	// Include file path offset
 	void set_ipath_offset(int o) { i2d[id].set_ipath_offset(o); }
 	int get_ipath_offset() const { return i2d[id].get_ipath_offset(); }
+	/*
+	 * Multiple-inclusion guard: the name of the macro that must be
+	 * defined for the file's contents to be skipped, and its offset
+	 * in the #ifndef directive
+	 */
+	bool include_guard_scanned() const { return i2d[id].include_guard_scanned(); }
+	void set_include_guard(const string &g, cs_offset_t o) { i2d[id].set_include_guard(g, o); }
+	const string &get_include_guard() const { return i2d[id].get_include_guard(); }
+	cs_offset_t get_include_guard_offset() const { return i2d[id].get_include_guard_offset(); }
 
 	void set_visited() { i2d[id].set_visited(); }
 	void clear_visited() { i2d[id].clear_visited(); }
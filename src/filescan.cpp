@@ -0,0 +1,145 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * For documentation read the corresponding .h file
+ *
+ */
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <deque>
+#include <vector>
+#include <stack>
+#include <set>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace std;
+
+#include "cpp.h"
+#include "error.h"
+#include "attr.h"
+#include "metrics.h"
+#include "fileid.h"
+#include "tokid.h"
+#include "eclass.h"
+#include "fchar.h"
+#include "filescan.h"
+
+FileScan::FileScan(Fileid f) :
+	fid(f), pos((size_t)-1), consumed(false), cstate(s_normal),
+	idx(NULL), slot(0), nslots(0), ec(NULL)
+{
+	const MappedFile *m = MappedFile::get(f.get_path());
+	if (m == NULL) {
+		perror(f.get_path().c_str());
+		exit(1);
+	}
+	base = m->begin();
+	len = m->size();
+	if (f.get_id() < (int)Tokid::tm.size()) {
+		idx = &Tokid::tm[f.get_id()];
+		nslots = idx->slots();
+	}
+}
+
+// Set ec to the EC starting at the current character
+void
+FileScan::find_ec()
+{
+	ec = NULL;
+	if (idx == NULL)
+		return;
+	if (idx->slots() != nslots) {
+		// Removed ECs caused the index to be compacted
+		slot = idx->position(pos);
+		nslots = idx->slots();
+	}
+	while (slot < nslots && idx->offset(slot) < (cs_offset_t)pos)
+		slot++;
+	if (slot == nslots || idx->offset(slot) != (cs_offset_t)pos)
+		return;
+	Eclass **s = idx->ec_slot(slot++);
+	if (*s)
+		ec = Tokid::nmerged ? Tokid::resolve(s) : *s;
+}
+
+string
+FileScan::get_token(int n)
+{
+	size_t end = pos + n;
+	if (end > len)
+		end = len;
+	string r(base + pos, base + end);
+	pos = end - 1;
+	consumed = true;
+	return r;
+}
+
+// Return the state following s on character c
+enum e_cfile_state
+FileScan::next_state(enum e_cfile_state s, char c)
+{
+	switch (s) {
+	case s_normal:
+		if (c == '/')
+			return s_saw_slash;
+		else if (c == '\'')
+			return s_char;
+		else if (c == '"')
+			return s_string;
+		return s_normal;
+	case s_char:
+		if (c == '\'')
+			return s_normal;
+		else if (c == '\\')
+			return s_saw_chr_backslash;
+		return s_char;
+	case s_string:
+		if (c == '"')
+			return s_normal;
+		else if (c == '\\')
+			return s_saw_str_backslash;
+		return s_string;
+	case s_saw_chr_backslash:
+		return s_char;
+	case s_saw_str_backslash:
+		return s_string;
+	case s_saw_slash:		// After a / character
+		if (c == '/')
+			return s_cpp_comment;
+		else if (c == '*')
+			return s_block_comment;
+		return s_normal;
+	case s_cpp_comment:		// Inside C++ comment
+		return c == '\n' ? s_normal : s_cpp_comment;
+	case s_block_comment:		// Inside C block comment
+		return c == '*' ? s_block_star : s_block_comment;
+	case s_block_star:		// Found a * in a block comment
+		if (c == '/')
+			return s_normal;
+		else if (c != '*')
+			return s_block_comment;
+		return s_block_star;
+	default:
+		csassert(0);
+		return s;
+	}
+}
@@ -0,0 +1,90 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * A character by character scan of a processed file.
+ * This is the walk shared by post-processing, garbage collection,
+ * the database dump, and obfuscation.
+ * For each character it provides its offset, the equivalence class
+ * starting there (if any), and the C lexical state before it.
+ * The characters come from the file's shared memory image, and
+ * the equivalence classes are obtained by advancing through the
+ * file's (sorted) tokid map index in step with the scan, rather than
+ * by looking up each character's tokid.
+ * Equivalence classes can be removed during the scan.
+ *
+ */
+
+#ifndef FILESCAN_
+#define FILESCAN_
+
+#include <string>
+
+using namespace std;
+
+#include "metrics.h"
+#include "fileid.h"
+#include "tokid.h"
+
+class FileScan {
+private:
+	Fileid fid;			// File being scanned
+	const char *base;		// Its contents
+	size_t len;			// and their length
+	size_t pos;			// Offset of the current character
+	bool consumed;			// True if the current token was consumed
+	enum e_cfile_state cstate;	// Lexical state before the current char
+	FileEcIndex *idx;		// The file's ECs; NULL if it has none
+	FileEcIndex::size_type slot;	// Index slot of the next EC
+	FileEcIndex::size_type nslots;	// Index size when slot was set
+	Eclass *ec;			// EC starting at the current character
+
+	// Set ec to the EC starting at the current character
+	void find_ec();
+	// Return the state following s on character c
+	static enum e_cfile_state next_state(enum e_cfile_state s, char c);
+public:
+	// Prepare to scan file f; exit with an error if it can't be read
+	FileScan(Fileid f);
+	// Move to the next character; return false at the end of the file
+	bool next() {
+		if (pos != (size_t)-1 && !consumed)
+			cstate = next_state(cstate, base[pos]);
+		consumed = false;
+		if (++pos >= len)
+			return false;
+		find_ec();
+		return true;
+	}
+	// The current character and its location
+	char get_char() const { return base[pos]; }
+	cs_offset_t get_offset() const { return pos; }
+	Tokid get_tokid() const { return Tokid(fid, pos); }
+	// The EC starting at the current character, or NULL
+	Eclass *get_ec() const { return ec; }
+	// The lexical state before the current character
+	enum e_cfile_state get_state() const { return cstate; }
+	/*
+	 * Return the n characters starting at the current one,
+	 * and continue the scan after them.
+	 * The state is not affected by the returned characters.
+	 */
+	string get_token(int n);
+};
+
+#endif /* FILESCAN_ */
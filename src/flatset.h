@@ -0,0 +1,116 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * A set kept as a sorted vector.
+ * It provides the subset of the std::set interface we use, with
+ * a fraction of its space overhead, and cache-friendly iteration.
+ * Elements are typically added in ascending order, which appends
+ * them in constant time; other insertions cost a binary search and
+ * a move of the following elements.
+ * Iterators are invalidated when the set is modified.
+ *
+ */
+
+#ifndef FLATSET_
+#define FLATSET_
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+using namespace std;
+
+template <class T>
+class FlatSet {
+private:
+	typedef vector <T> container_type;
+	container_type v;		// Sorted unique elements
+public:
+	typedef T value_type;
+	typedef typename container_type::size_type size_type;
+	typedef typename container_type::const_iterator const_iterator;
+	typedef const_iterator iterator;
+
+	const_iterator begin() const { return v.begin(); }
+	const_iterator end() const { return v.end(); }
+	size_type size() const { return v.size(); }
+	size_type capacity() const { return v.capacity(); }
+	bool empty() const { return v.empty(); }
+	void clear() { v.clear(); }
+	void swap(FlatSet &s) { v.swap(s.v); }
+
+	// Add t; return true if it was not already a member
+	bool insert(const T &t) {
+		if (v.empty() || v.back() < t) {
+			v.push_back(t);
+			return true;
+		}
+		typename container_type::iterator i = lower_bound(v.begin(), v.end(), t);
+		if (*i == t)
+			return false;
+		v.insert(i, t);
+		return true;
+	}
+	// Compatibility with std::set; the hint is not needed
+	const_iterator insert(const_iterator, const T &t) {
+		insert(t);
+		return lower_bound(v.begin(), v.end(), t);
+	}
+	// Add the elements of s
+	void insert(const FlatSet &s) {
+		if (s.empty())
+			return;
+		if (v.empty() || v.back() < s.v.front()) {
+			v.insert(v.end(), s.v.begin(), s.v.end());
+			return;
+		}
+		container_type r;
+		r.reserve(v.size() + s.v.size());
+		set_union(v.begin(), v.end(), s.v.begin(), s.v.end(), back_inserter(r));
+		v.swap(r);
+	}
+	// Add the elements in the range [b, e)
+	template <class InputIterator>
+	void insert(InputIterator b, InputIterator e) {
+		size_type n = v.size();
+		v.insert(v.end(), b, e);
+		sort(v.begin() + n, v.end());
+		inplace_merge(v.begin(), v.begin() + n, v.end());
+		v.erase(unique(v.begin(), v.end()), v.end());
+	}
+	// Remove t; return the number of elements removed
+	size_type erase(const T &t) {
+		typename container_type::iterator i = lower_bound(v.begin(), v.end(), t);
+		if (i == v.end() || t < *i)
+			return 0;
+		v.erase(i);
+		return 1;
+	}
+	const_iterator find(const T &t) const {
+		const_iterator i = lower_bound(v.begin(), v.end(), t);
+		if (i == v.end() || t < *i)
+			return v.end();
+		return i;
+	}
+	size_type count(const T &t) const { return find(t) != v.end(); }
+	// Release unused capacity
+	void shrink() { container_type(v).swap(v); }
+};
+
+#endif /* FLATSET_ */
@@ -55,7 +55,6 @@
 #include "pltoken.h"
 
 vector<bool> &FunMetrics::is_operator_map = make_is_operator();
-FunMetrics::KeywordMap &FunMetrics::keyword_map = make_keyword_map();
 
 MetricDetails FunMetrics::metric_details[] = {
 // BEGIN AUTOSCHEMA FunMetrics
@@ -233,26 +232,13 @@ FunMetrics::summarize_identifiers()
 	ids.clear();
 }
 
-// Initialize map
-FunMetrics::KeywordMap &
-FunMetrics::make_keyword_map()
+// Clear the metrics collected during post-processing
+void
+FunMetrics::clear_postprocessing()
 {
-	static KeywordMap km;
-
-	km.insert(KeywordMap::value_type("if", em_nif));
-	km.insert(KeywordMap::value_type("else", em_nelse));
-	km.insert(KeywordMap::value_type("switch", em_nswitch));
-	km.insert(KeywordMap::value_type("case", em_ncase));
-	km.insert(KeywordMap::value_type("default", em_ndefault));
-	km.insert(KeywordMap::value_type("break", em_nbreak));
-	km.insert(KeywordMap::value_type("for", em_nfor));
-	km.insert(KeywordMap::value_type("while", em_nwhile));
-	km.insert(KeywordMap::value_type("do", em_ndo));
-	km.insert(KeywordMap::value_type("continue", em_ncontinue));
-	km.insert(KeywordMap::value_type("goto", em_ngoto));
-	km.insert(KeywordMap::value_type("return", em_nreturn));
-
-	return (km);
+	Metrics::clear_postprocessing();
+	for (int i = em_npid; i <= em_nlabid; i++)
+		count[i] = 0;
 }
 
 // Process a single token read from a file
@@ -42,12 +42,14 @@ using namespace std;
 
 #include "metrics.h"
 #include "parse.tab.h"
+#include "keyword.h"
 
 class Call;
 class Pltoken;
 class Eclass;
 
 class FunMetrics : public Metrics {
+	friend class MemStat;
 private:
 	static MetricDetails metric_details[];	// Descriptions of the metrics we store
 
@@ -60,17 +62,12 @@ private:
 	// Initialize map
 	static vector<bool> &make_is_operator();
 
-	// String-indexed enum metric map of keywords we collect
-	typedef map<string, int> KeywordMap;
-	static KeywordMap &keyword_map;
 	// If a string represents a keyword we collect,
 	// return its metric enum value otherwise return -1
 	static inline int keyword_metric(const string &s) {
-		KeywordMap::iterator i = keyword_map.find(s);
-		return (i == keyword_map.end() ? -1 : i->second);
+		const Keyword *k = Keyword::find(s);
+		return (k == NULL ? -1 : k->get_metric());
 	}
-	// Initialize map
-	static KeywordMap &make_keyword_map();
 
 	set <int> operators;			// Operators used in the function
 	set <Eclass *> pids;			// Project-scope dentifiers used in the function
@@ -156,6 +153,8 @@ public:
 	void summarize_operators();
 	// Summarize the identifiers collected by process_id
 	void summarize_identifiers();
+	// Clear the metrics collected during post-processing
+	void clear_postprocessing();
 	// Update the level of nesting
 	void update_nesting(int nesting) { if (nesting > count[em_maxnest]) count[em_maxnest] = nesting; }
 
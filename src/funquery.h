@@ -90,6 +90,11 @@ public:
 
 	// Perform a query
 	bool eval(Call *c);
+	// Return the RE that the names of all matching functions match
+	// or NULL if the query does not restrict function names
+	const string *name_re() const {
+		return (!lazy && !call && !id_ec && match_fnre && !exclude_fnre) ? &str_fnre : NULL;
+	}
 	// Return the URL for re-executing this query
 	string base_url() const;
 	// Return the query's parameters as a URL
@@ -36,6 +36,7 @@ using namespace std;
 #include "tokid.h"
 
 class GlobObj {
+	friend class Snapshot;
 private:
 	string name;
 	set <Fileid> defined;	// Files where this is defined
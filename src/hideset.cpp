@@ -0,0 +1,132 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Interned macro expansion hide sets.
+ *
+ */
+
+#include <iostream>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <deque>
+
+using namespace std;
+
+#include "cpp.h"
+#include "fileid.h"
+#include "tokid.h"
+#include "token.h"
+#include "hideset.h"
+
+vector <Token> HideSet::tokens;
+map <Token, unsigned> HideSet::token_index;
+vector <HideSet::Elements> HideSet::sets(1);	// The empty set
+map <HideSet::Elements, unsigned> HideSet::set_index;
+HideSet::mapResult HideSet::unions;
+HideSet::mapResult HideSet::intersections;
+
+// Return the hide set with the specified elements
+HideSet
+HideSet::intern(const Elements &e)
+{
+	if (e.empty())
+		return HideSet();
+	map <Elements, unsigned>::const_iterator i = set_index.find(e);
+	if (i != set_index.end())
+		return HideSet(i->second);
+	unsigned id = sets.size();
+	sets.push_back(e);
+	set_index.insert(make_pair(e, id));
+	return HideSet(id);
+}
+
+bool
+HideSet::contains(const Token &t) const
+{
+	if (empty())
+		return false;
+	map <Token, unsigned>::const_iterator i = token_index.find(t);
+	if (i == token_index.end())
+		return false;
+	return binary_search(elements().begin(), elements().end(), i->second);
+}
+
+void
+HideSet::insert(const Token &t)
+{
+	map <Token, unsigned>::const_iterator i = token_index.find(t);
+	unsigned k;
+	if (i == token_index.end()) {
+		k = tokens.size();
+		tokens.push_back(t);
+		token_index.insert(make_pair(t, k));
+	} else
+		k = i->second;
+	*this = hs_union(*this, intern(Elements(1, k)));
+}
+
+HideSet
+hs_union(HideSet a, HideSet b)
+{
+	if (a == b || b.empty())
+		return a;
+	if (a.empty())
+		return b;
+	pair <unsigned, unsigned> key(min(a.id, b.id), max(a.id, b.id));
+	HideSet::mapResult::const_iterator i = HideSet::unions.find(key);
+	if (i != HideSet::unions.end())
+		return HideSet(i->second);
+	HideSet::Elements r;
+	set_union(a.elements().begin(), a.elements().end(),
+		b.elements().begin(), b.elements().end(),
+		back_inserter(r));
+	HideSet result(HideSet::intern(r));
+	HideSet::unions.insert(make_pair(key, result.id));
+	return result;
+}
+
+HideSet
+hs_intersection(HideSet a, HideSet b)
+{
+	if (a == b || a.empty())
+		return a;
+	if (b.empty())
+		return b;
+	pair <unsigned, unsigned> key(min(a.id, b.id), max(a.id, b.id));
+	HideSet::mapResult::const_iterator i = HideSet::intersections.find(key);
+	if (i != HideSet::intersections.end())
+		return HideSet(i->second);
+	HideSet::Elements r;
+	set_intersection(a.elements().begin(), a.elements().end(),
+		b.elements().begin(), b.elements().end(),
+		back_inserter(r));
+	HideSet result(HideSet::intern(r));
+	HideSet::intersections.insert(make_pair(key, result.id));
+	return result;
+}
+
+ostream&
+operator<<(ostream& o, HideSet hs)
+{
+	for (HideSet::Elements::const_iterator i = hs.elements().begin(); i != hs.elements().end(); i++)
+		o << HideSet::tokens[*i];
+	return (o);
+}
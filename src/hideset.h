@@ -0,0 +1,79 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * A macro expansion hide set.
+ * Hide sets are interned: each distinct set is stored once in a
+ * table and a hide set value is just its index.  Copying, assigning
+ * and comparing hide sets is therefore as cheap as for an integer,
+ * and the result of each union and intersection is computed only once.
+ * Interned sets are never freed; their number is bounded by the
+ * distinct macro nesting patterns of the processed code.
+ * The tables are not thread-safe.
+ *
+ */
+
+#ifndef HIDESET_
+#define HIDESET_
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+using namespace std;
+
+#include "token.h"
+
+class HideSet {
+private:
+	typedef vector <unsigned> Elements;	// Sorted token indices
+
+	unsigned id;				// Index into sets; 0 is the empty set
+
+	static vector <Token> tokens;		// Tokens appearing in hide sets
+	static map <Token, unsigned> token_index; // Their index in tokens
+	static vector <Elements> sets;		// All distinct hide sets
+	static map <Elements, unsigned> set_index; // Their index in sets
+	// Memoized results of set operations, keyed by the smaller operand first
+	typedef map <pair <unsigned, unsigned>, unsigned> mapResult;
+	static mapResult unions, intersections;
+
+	HideSet(unsigned i) : id(i) {}
+	// Return the hide set with the specified elements
+	static HideSet intern(const Elements &e);
+	// Return the elements of a hide set
+	const Elements &elements() const { return sets[id]; }
+public:
+	// Construct an empty hide set
+	HideSet() : id(0) {}
+	// Return true if t is in the hide set
+	bool contains(const Token &t) const;
+	// Add t to the hide set
+	void insert(const Token &t);
+	bool empty() const { return id == 0; }
+	// Set operations
+	friend HideSet hs_union(HideSet a, HideSet b);
+	friend HideSet hs_intersection(HideSet a, HideSet b);
+	friend bool operator ==(HideSet a, HideSet b) { return a.id == b.id; }
+	// Print it (for debugging)
+	friend ostream& operator<<(ostream& o, HideSet hs);
+	// Number of distinct interned hide sets
+	static vector <Elements>::size_type interned() { return sets.size(); }
+};
+
+#endif /* HIDESET_ */
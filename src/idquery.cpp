@@ -291,8 +291,8 @@ IdQuery::eval(const IdPropElem &i)
 		return false;
 	if (match_fre) {
 		// Before we add it check if its filename matches the RE
-		IFSet f = i.first->sorted_files();
-		IFSet::iterator j;
+		const setFileid &f = i.first->get_files();
+		setFileid::const_iterator j;
 		for (j = f.begin(); j != f.end(); j++)
 			if (fre.exec((*j).get_path()) == 0) {
 				if (DP())
@@ -38,6 +38,7 @@ typedef map <Eclass *, Identifier> IdProp;
 
 // Our identifiers to store as a map
 class Identifier {
+	friend class Snapshot;
 	string id;		// Identifier name
 	string newid;		// New identifier name
 	bool xfile;		// True if it crosses files
@@ -55,7 +56,7 @@ public:
 		 * For this second condition it is enough to check the identical files of one element
 		 */
 		Tokid amember(*(e->get_members().begin()));
-		xfile = e->sorted_files().size() > amember.get_fileid().get_identical_files().size();
+		xfile = e->get_files().size() > amember.get_fileid().get_identical_files().size();
 	}
 	Identifier() {}
 	string get_id() const { return id; }
@@ -110,6 +111,11 @@ public:
 
 	// Perform a query
 	bool eval(const IdPropElem &i);
+	// Return the RE that the names of all matching identifiers match
+	// or NULL if the query does not restrict identifier names
+	const string *name_re() const {
+		return (!lazy && !ec && match_ire && !exclude_ire) ? &str_ire : NULL;
+	}
 	// Return the URL for re-executing this query
 	string base_url() const;
 	// Return the query's parameters as a URL
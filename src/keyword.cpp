@@ -0,0 +1,219 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * For documentation read the corresponding .h file
+ *
+ */
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <deque>
+#include <set>
+#include <vector>
+#include <cstring>
+
+using namespace std;
+
+#include "cpp.h"
+#include "error.h"
+#include "attr.h"
+#include "metrics.h"
+#include "funmetrics.h"
+#include "parse.tab.h"
+#include "keyword.h"
+
+// The keywords we recognize
+static const Keyword keywords[] = {
+	Keyword("auto", AUTO),
+	Keyword("break", BREAK, FunMetrics::em_nbreak),
+	Keyword("case", CASE, FunMetrics::em_ncase),
+	Keyword("char", CHAR),
+	Keyword("const", TCONST),
+	Keyword("continue", CONTINUE, FunMetrics::em_ncontinue),
+	Keyword("default", DEFAULT, FunMetrics::em_ndefault),
+	Keyword("do", DO, FunMetrics::em_ndo),
+	Keyword("double", DOUBLE),
+	Keyword("else", ELSE, FunMetrics::em_nelse),
+	Keyword("enum", ENUM),
+	Keyword("extern", EXTERN),
+	Keyword("float", FLOAT),
+	Keyword("for", FOR, FunMetrics::em_nfor),
+	Keyword("goto", GOTO, FunMetrics::em_ngoto),
+	Keyword("if", IF, FunMetrics::em_nif),
+	Keyword("int", INT),
+	Keyword("long", LONG),
+	Keyword("register", REGISTER),
+	Keyword("return", RETURN, FunMetrics::em_nreturn),
+	Keyword("short", SHORT),
+	Keyword("signed", SIGNED),
+	Keyword("sizeof", SIZEOF),
+	Keyword("static", STATIC),
+	Keyword("struct", STRUCT),
+	Keyword("switch", SWITCH, FunMetrics::em_nswitch),
+	Keyword("typedef", TYPEDEF),
+	Keyword("union", UNION),
+	Keyword("unsigned", UNSIGNED),
+	Keyword("void", TVOID),
+	Keyword("volatile", VOLATILE),
+	Keyword("while", WHILE, FunMetrics::em_nwhile),
+	/* C99 */
+	Keyword("inline", INLINE),
+	Keyword("restrict", RESTRICT),
+	Keyword("_Bool", BOOL),
+	Keyword("_Complex", COMPLEX),
+	Keyword("_Imaginary", IMAGINARY),
+	/* C11 */
+	Keyword("_Thread_local", THREAD_LOCAL),
+	/* Microsoft */
+	Keyword("_asm", MSC_ASM),
+	Keyword("__try", TRY),
+	Keyword("__except", EXCEPT),
+	Keyword("__finally", FINALLY),
+	Keyword("__leave", LEAVE),
+	/* gcc; from c-parse.in */
+	Keyword("__asm", GNUC_ASM),
+	Keyword("__asm__", GNUC_ASM),
+	Keyword("__attribute", ATTRIBUTE),
+	Keyword("__attribute__", ATTRIBUTE),
+	Keyword("__const", TCONST),
+	Keyword("__const__", TCONST),
+	Keyword("__inline", INLINE),
+	Keyword("__inline__", INLINE),
+	Keyword("__label", LABEL),
+	Keyword("__label__", LABEL),
+	Keyword("__restrict", RESTRICT),
+	Keyword("__restrict__", RESTRICT),
+	Keyword("__signed", SIGNED),
+	Keyword("__signed__", SIGNED),
+	Keyword("__typeof", TYPEOF),
+	Keyword("__typeof__", TYPEOF),
+	Keyword("__alignof", ALIGNOF),
+	Keyword("__alignof__", ALIGNOF),
+	Keyword("__volatile", VOLATILE),
+	Keyword("__volatile__", VOLATILE),
+};
+
+/*
+ * A perfect hash table of the keywords.
+ * The hash function's seed is chosen when the table is built, so that
+ * no two keywords share a slot; adding keywords requires no other change.
+ */
+class KeywordTable {
+private:
+	enum {size = 512};		// Number of slots; a power of two
+	const Keyword *slot[size];	// Keyword hashing to each slot or NULL
+	unsigned seed;			// Hash function seed
+public:
+	// Return the slot of the len characters at s (FNV-1a hash)
+	unsigned hash(const char *s, size_t len) const {
+		unsigned h = 2166136261u ^ seed;
+		for (size_t i = 0; i < len; i++) {
+			h ^= (unsigned char)s[i];
+			h *= 16777619u;
+		}
+		return h & (size - 1);
+	}
+	KeywordTable(const Keyword *begin, const Keyword *end);
+	const Keyword *find(const string &s) const {
+		const Keyword *k = slot[hash(s.data(), s.length())];
+		if (k && k->get_len() == s.length() &&
+		    memcmp(k->get_name(), s.data(), s.length()) == 0)
+			return k;
+		return NULL;
+	}
+};
+
+KeywordTable::KeywordTable(const Keyword *begin, const Keyword *end)
+{
+	for (seed = 0;; seed++) {
+		csassert(seed < 10000);
+		for (int i = 0; i < size; i++)
+			slot[i] = NULL;
+		const Keyword *k;
+		for (k = begin; k != end; k++) {
+			const Keyword **s = &slot[hash(k->get_name(), k->get_len())];
+			if (*s)
+				break;		// Collision; try another seed
+			*s = k;
+		}
+		if (k == end)
+			return;
+	}
+}
+
+const Keyword *
+Keyword::find(const string &s)
+{
+	static const KeywordTable table(keywords, keywords + sizeof(keywords) / sizeof(keywords[0]));
+
+	return table.find(s);
+}
+
+#ifdef UNIT_TEST
+// Microbenchmark comparing the keyword lookup of the identifiers
+// in the specified files against a map lookup, e.g.:
+// g++ -O2 -I. -DUNIT_TEST -DNDEBUG keyword.cpp -o kwbench
+// ./kwbench ../example/awk/*.c
+
+#include <fstream>
+#include <cctype>
+#include <ctime>
+
+int
+main(int argc, char *argv[])
+{
+	vector <string> ids;
+
+	for (int i = 1; i < argc; i++) {
+		ifstream in(argv[i]);
+		string id;
+		char c;
+		while (in.get(c))
+			if (isalnum((unsigned char)c) || c == '_')
+				id += c;
+			else if (!id.empty()) {
+				if (!isdigit((unsigned char)id[0]))
+					ids.push_back(id);
+				id.clear();
+			}
+	}
+
+	map <string, int> m;
+	for (const Keyword *k = keywords; k != keywords + sizeof(keywords) / sizeof(keywords[0]); k++)
+		m[k->get_name()] = k->get_token();
+
+	const int passes = 200;
+	long nmap = 0, nhash = 0;
+	clock_t start = clock();
+	for (int p = 0; p < passes; p++)
+		for (vector <string>::const_iterator i = ids.begin(); i != ids.end(); i++)
+			nmap += m.find(*i) != m.end();
+	clock_t mid = clock();
+	for (int p = 0; p < passes; p++)
+		for (vector <string>::const_iterator i = ids.begin(); i != ids.end(); i++)
+			nhash += Keyword::find(*i) != NULL;
+	clock_t stop = clock();
+
+	cout << ids.size() << " identifiers, " << nmap / passes << " keywords\n";
+	cout << "map:  " << (double)(mid - start) / CLOCKS_PER_SEC << "s\n";
+	cout << "hash: " << (double)(stop - mid) / CLOCKS_PER_SEC << "s\n";
+	return (nmap != nhash);
+}
+#endif /* UNIT_TEST */
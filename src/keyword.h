@@ -0,0 +1,55 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * The C keywords and their extensions, with the token code the lexer
+ * returns for them and the function metric they contribute to.
+ * Every identifier is looked up as a potential keyword, so the
+ * lookup goes through a perfect hash table: a hash value selects
+ * a single candidate keyword, which is then compared with the
+ * identifier.
+ *
+ */
+
+#ifndef KEYWORD_
+#define KEYWORD_
+
+#include <string>
+#include <cstring>
+
+using namespace std;
+
+class Keyword {
+private:
+	const char *name;	// Keyword's spelling
+	size_t len;		// and its length
+	int token;		// Token code returned by the lexer
+	int metric;		// Function metric it increments or -1
+public:
+	Keyword(const char *n, int t, int m = -1) :
+		name(n), len(strlen(n)), token(t), metric(m) {}
+	// Return the keyword spelled as s, or NULL if s is not a keyword
+	static const Keyword *find(const string &s);
+	// Accessor functions
+	const char *get_name() const { return name; }
+	size_t get_len() const { return len; }
+	int get_token() const { return token; }
+	int get_metric() const { return metric; }
+};
+
+#endif /* KEYWORD_ */
@@ -42,6 +42,7 @@
 #include "type.h"
 #include "call.h"
 #include "mcall.h"
+#include "profile.h"
 
 
 /*
@@ -362,7 +363,7 @@ Macro::Macro( const Ptoken& name, bool id, bool isfun) :
 }
 
 static PtokenSequence subst(const Macro &m, dequePtoken is, const mapArgval &args, HideSet hs, bool skip_defined, const Macro *caller);
-static PtokenSequence inline hsadd(const HideSet& hs, const PtokenSequence& ts);
+static PtokenSequence inline hsadd(HideSet hs, const PtokenSequence& ts);
 static PtokenSequence glue(PtokenSequence ls, PtokenSequence rs);
 static bool fill_in(PtokenSequence &ts, bool get_more, PtokenSequence &removed);
 
@@ -376,6 +377,7 @@ static bool fill_in(PtokenSequence &ts, bool get_more, PtokenSequence &removed);
 PtokenSequence
 macro_expand(PtokenSequence ts, bool get_more, bool skip_defined, const Macro *caller)
 {
+	PhaseTimer timer(Profile::ph_macro_expand);
 	PtokenSequence r;	// Return value
 
 	if (DP()) cout << "Expanding: " << ts << endl;
@@ -417,6 +419,7 @@ macro_expand(PtokenSequence ts, bool get_more, bool skip_defined, const Macro *c
 		PtokenSequence removed_spaces;
 		if (!m.is_function) {
 			// Object-like macro
+			Profile::count(Profile::pc_macro_expand);
 			Token::unify((*mi).second.name_token, head);
 			HideSet hs(head.get_hideset());
 			hs.insert(m.get_name_token());
@@ -425,6 +428,7 @@ macro_expand(PtokenSequence ts, bool get_more, bool skip_defined, const Macro *c
 			caller = &m;
 		} else if (fill_in(ts, get_more, removed_spaces) && ts.front().get_code() == '(') {
 			// Application of a function-like macro
+			Profile::count(Profile::pc_macro_expand);
 			Token::unify((*mi).second.name_token, head);
 			mapArgval args;			// Map from formal name to value
 
@@ -440,10 +444,7 @@ macro_expand(PtokenSequence ts, bool get_more, bool skip_defined, const Macro *c
 			Ptoken close;
 			if (!gather_args(name, ts, m.formal_args, args, get_more, m.is_vararg, close))
 				continue;	// Attempt to bail-out on error
-			HideSet hs;
-			set_intersection(head.get_hideset().begin(), head.get_hideset().end(),
-				close.get_hideset().begin(), close.get_hideset().end(),
-				inserter(hs, hs.begin()));
+			HideSet hs(hs_intersection(head.get_hideset(), close.get_hideset()));
 			hs.insert(m.get_name_token());
 			PtokenSequence s(subst(m, m.value, args, hs, skip_defined, caller));
 			ts.splice(ts.begin(), s);
@@ -565,12 +566,12 @@ subst(const Macro &m, dequePtoken is, const mapArgval &args, HideSet hs, bool sk
 
 // Return a new token sequence with hs added to the hide set of every element of ts
 static inline PtokenSequence
-hsadd(const HideSet& hs, const PtokenSequence& ts)
+hsadd(HideSet hs, const PtokenSequence& ts)
 {
 	PtokenSequence r;
 	for (PtokenSequence::const_iterator i = ts.begin(); i != ts.end(); i++) {
 		Ptoken t(*i);
-		t.hideset_insert(hs.begin(), hs.end());
+		t.hideset_insert(hs);
 		r.push_back(t);
 	}
 	if (DP()) cout << "hsadd returns: " << r << endl;
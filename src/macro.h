@@ -51,6 +51,8 @@ typedef map<Tokid, MCall *> mapMacroBody;
 
 // A macro definition
 class Macro {
+	friend class UnitCache;
+	friend class MemStat;
 private:
 	Ptoken name_token;		// Name (used for unification)
 	bool is_function;		// True if it is a function-macro
@@ -0,0 +1,156 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * For documentation read the corresponding .h file
+ *
+ */
+
+#include <fstream>
+#include <string>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <cerrno>
+#include <cstdio>
+
+#if defined(unix) || defined(__unix__) || defined(__MACH__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define HAVE_MMAP
+#define HAVE_INODE
+#endif
+
+#include "error.h"
+#include "os.h"
+#include "mapfstream.h"
+
+MappedFile::Cache MappedFile::cache;	// Images of the files we have opened
+mutex MappedFile::cache_mutex;		// Protects cache
+
+/*
+ * Set key to a string identifying the file at path independently of
+ * the name and the working directory used to reach it, and changing
+ * when the file is modified.
+ * Return false (setting errno) if the file cannot be accessed.
+ */
+bool
+MappedFile::file_key(const string &path, string &key)
+{
+#ifdef HAVE_INODE
+	struct stat sb;
+	if (stat(path.c_str(), &sb) < 0)
+		return false;
+	char buff[100];
+	snprintf(buff, sizeof(buff), "%ld:%ld:%ld:%ld", (long)sb.st_dev,
+	    (long)sb.st_ino, (long)sb.st_size, (long)sb.st_mtime);
+	key = buff;
+#else
+	key = get_full_path(path.c_str());
+#endif
+	return true;
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef HAVE_MMAP
+	if (mapped) {
+		munmap((void *)base, len);
+		return;
+	}
+#endif
+	delete[] base;
+}
+
+// Return the image of the file at path, or NULL (setting errno)
+const MappedFile *
+MappedFile::get(const string &path)
+{
+	string key;
+	{
+		lock_guard <mutex> lock(cache_mutex);
+		if (!file_key(path, key))
+			return NULL;
+		Cache::const_iterator i = cache.find(key);
+		if (i != cache.end())
+			return i->second;
+	}
+
+	// Map the file without holding the lock
+	MappedFile *m = NULL;
+#ifdef HAVE_MMAP
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	struct stat sb;
+	if (fstat(fd, &sb) < 0) {
+		int e = errno;
+		close(fd);
+		errno = e;
+		return NULL;
+	}
+	// Zero-length files can't be mapped; special files are read below
+	if (S_ISREG(sb.st_mode) && sb.st_size > 0) {
+		void *p = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+			(void)madvise(p, sb.st_size, MADV_SEQUENTIAL);
+#endif
+			m = new MappedFile((const char *)p, sb.st_size, true);
+		}
+	}
+	close(fd);
+#endif
+	if (m == NULL) {
+		// Fall back to reading the file into memory
+		ifstream in(path.c_str(), ios::binary);
+		if (in.fail())
+			return NULL;
+		vector <char> v;
+		char buff[8192];
+		while (in.read(buff, sizeof(buff)), in.gcount() > 0)
+			v.insert(v.end(), buff, buff + in.gcount());
+		char *b = new char[v.size()];
+		copy(v.begin(), v.end(), b);
+		m = new MappedFile(b, v.size(), false);
+	}
+	lock_guard <mutex> lock(cache_mutex);
+	pair <Cache::iterator, bool> r(cache.insert(Cache::value_type(key, m)));
+	if (!r.second)
+		delete m;		// Another thread mapped it first
+	return r.first->second;
+}
+
+// Release the cached image of path (e.g. before it is modified)
+void
+MappedFile::forget(const string &path)
+{
+	lock_guard <mutex> lock(cache_mutex);
+	string key;
+	if (!file_key(path, key))
+		return;
+	Cache::iterator i = cache.find(key);
+	if (i == cache.end())
+		return;
+	delete i->second;
+	cache.erase(i);
+}
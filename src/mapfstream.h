@@ -0,0 +1,153 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Input stream reading from a memory-mapped image of a file.
+ * It supports the subset of the ifstream methods provided by fifstream,
+ * so that it can be used in its place.
+ *
+ * The file images are kept in a cache keyed by the file's device, inode,
+ * size, and modification time, so that different names of the same file
+ * (e.g. relative names used from different directories) share an image,
+ * while same-named files in different directories do not.
+ * A header that is included by many compilation units is thus mapped
+ * only once, and reopening it (e.g. when Fchar restores the context
+ * of an includer after an include file ends) requires a single stat call.
+ * The cache can be accessed from multiple threads.
+ * The images remain valid until forget() is called for the file.
+ * (Files that CScout rewrites are unlinked and recreated, so
+ * existing images are not affected.)
+ *
+ * This file is included by fchar.h; do not include it directly.
+ *
+ */
+
+#ifndef MAPFSTREAM_
+#define MAPFSTREAM_
+
+#include <fstream>
+#include <string>
+#include <map>
+#include <mutex>
+
+using namespace std;
+
+#include "error.h"
+
+// A read-only memory image of a file shared by all its readers
+class MappedFile {
+private:
+	const char *base;	// Start of the file's contents
+	size_t len;		// File length
+	bool mapped;		// True if memory-mapped (rather than read)
+	MappedFile(const char *b, size_t l, bool m) : base(b), len(l), mapped(m) {}
+	~MappedFile();
+
+	typedef map <string, MappedFile *> Cache;
+	static Cache cache;	// Images of the files we have opened
+	static mutex cache_mutex;	// Protects cache
+	// Set key to the cache key of path; return false on error
+	static bool file_key(const string &path, string &key);
+public:
+	// Return the image of the file at path, or NULL (setting errno)
+	static const MappedFile *get(const string &path);
+	// Release the cached image of path (e.g. before it is modified)
+	static void forget(const string &path);
+	const char *begin() const { return base; }
+	const char *end() const { return base + len; }
+	size_t size() const { return len; }
+};
+
+class mapfstream {
+private:
+	const char *base;	// Start of the file's image
+	const char *p;		// Read position
+	const char *limit;	// End of the file's image
+	ios_base::iostate state;
+public:
+	mapfstream() : base(NULL), p(NULL), limit(NULL), state(ios_base::goodbit) {}
+	mapfstream(const char *s, ios_base::openmode mode = ios_base::in) :
+		base(NULL), p(NULL), limit(NULL), state(ios_base::goodbit) {
+		open(s, mode);
+	}
+
+	// mapfstream supports the same subset of the ifstream methods as fifstream
+	bool is_open() const { return base != NULL; }
+	void close() {
+		if (!base)
+			state |= ios_base::failbit;
+		base = p = limit = NULL;
+	}
+	void clear(ios_base::iostate s = ios_base::goodbit) {
+		state = s;
+	}
+	void open(const char *s, ios_base::openmode mode = ios_base::in) {
+		// Only binary access is supported
+		csassert(mode & ios::binary);
+		if (base) {
+			state |= ios_base::failbit;
+			return;
+		}
+		const MappedFile *m = MappedFile::get(s);
+		if (m == NULL) {
+			state |= ios_base::failbit;
+			return;
+		}
+		base = p = m->begin();
+		limit = m->end();
+	}
+	bool fail() const {
+		return (state & (ios_base::failbit | ios_base::badbit)) != 0;
+	}
+	bool eof() const {
+		return (state & ios_base::eofbit) != 0;
+	}
+	ifstream::pos_type tellg() const {
+		if (fail() || !base)
+			return (ifstream::pos_type)-1;
+		return (ifstream::pos_type)(p - base);
+	}
+	ifstream::int_type get() {
+		if (state != ios_base::goodbit || p == limit) {
+			if (p == limit)
+				state |= ios_base::eofbit;
+			state |= ios_base::failbit;
+			return EOF;
+		}
+		return (unsigned char)*p++;
+	}
+	mapfstream &putback(char c) {
+		if (state != ios_base::goodbit || p == base)
+			state |= ios_base::badbit;
+		else
+			p--;
+		return *this;
+	}
+	mapfstream &seekg(ifstream::pos_type pos) {
+		streamoff off(pos);
+
+		state &= ~ios_base::eofbit;
+		if (fail() || !base || off < 0 || off > limit - base)
+			state |= ios_base::failbit;
+		else
+			p = base + off;
+		return *this;
+	}
+};
+
+#endif /* MAPFSTREAM_ */
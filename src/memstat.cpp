@@ -0,0 +1,274 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * For documentation read the corresponding .h file
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <stack>
+#include <vector>
+
+#include "cpp.h"
+#include "debug.h"
+#include "error.h"
+#include "attr.h"
+#include "metrics.h"
+#include "fileid.h"
+#include "tokid.h"
+#include "token.h"
+#include "ptoken.h"
+#include "fchar.h"
+#include "macro.h"
+#include "pdtoken.h"
+#include "eclass.h"
+#include "funmetrics.h"
+#include "call.h"
+#include "idquery.h"
+#include "fdep.h"
+#include "profile.h"
+#include "memstat.h"
+
+size_t MemStat::bytes[ms_max];
+size_t MemStat::elements[ms_max];
+
+const char * const MemStat::structure_name[ms_max] = {
+	"Tokid::tm",
+	"Eclass objects",
+	"Eclass::members",
+	"Identifier::ids",
+	"Call::all",
+	"Call::call/caller",
+	"FunMetrics sets",
+	"Filedetails::line_ends",
+	"Filedetails::processed_lines",
+	"Filedetails::includes/includers",
+	"Pdtoken::macros",
+	"Pdtoken::macro_body_tokens",
+	"Fdep",
+};
+
+size_t
+MemStat::deque_bytes(size_t n, size_t s)
+{
+	// The library allocates 512-byte nodes and a map of at least 8 pointers
+	size_t per_node = s < 512 ? 512 / s : 1;
+	size_t nodes = n / per_node + 1;
+	return nodes * per_node * s + (nodes + 2 > 8 ? nodes + 2 : 8) * sizeof(void *);
+}
+
+void
+MemStat::measure_tokid_map()
+{
+	const mapTokidEclass &tm = Tokid::tm;
+	FileEcIndex::size_type nslots = 0;
+
+	// Only the class roots hold the members we sample
+	Tokid::resolve_all();
+
+	bytes[ms_tokid_map] = tm.capacity() * sizeof(FileEcIndex);
+	elements[ms_tokid_map] = 0;
+	for (mapTokidEclass::const_iterator i = tm.begin(); i != tm.end(); i++) {
+		bytes[ms_tokid_map] += i->offs.capacity() * sizeof(unsigned) +
+			i->ecs.capacity() * sizeof(Eclass *);
+		elements[ms_tokid_map] += i->size();
+		nslots += i->slots();
+	}
+
+	const Pool &ecp = Eclass::get_pool();
+	bytes[ms_eclass] = ecp.get_reserved();
+	elements[ms_eclass] = ecp.get_live();
+
+	/*
+	 * Every tokid is a member of exactly one class, so the members
+	 * occupy the mapped tokids times the ratio between the capacity
+	 * and the size of the member vectors, which we sample.
+	 */
+	FileEcIndex::size_type stride = nslots / sample_size + 1;
+	FileEcIndex::size_type skip = 0;
+	size_t capacity = 0, size = 0;
+	for (mapTokidEclass::const_iterator i = tm.begin(); i != tm.end(); i++) {
+		FileEcIndex::size_type j;
+		for (j = skip; j < i->slots(); j += stride)
+			if (i->ec(j)) {
+				capacity += i->ec(j)->members.capacity();
+				size += i->ec(j)->members.size();
+			}
+		skip = j - i->slots();
+	}
+	elements[ms_eclass_members] = elements[ms_tokid_map];
+	bytes[ms_eclass_members] = size ?
+		(size_t)((double)elements[ms_tokid_map] * capacity / size * sizeof(Tokid)) :
+		elements[ms_tokid_map] * sizeof(Tokid);
+}
+
+void
+MemStat::measure_identifiers()
+{
+	bytes[ms_identifiers] = tree_bytes(Identifier::ids.size(), sizeof(IdProp::value_type));
+	elements[ms_identifiers] = Identifier::ids.size();
+	for (IdProp::const_iterator i = Identifier::ids.begin(); i != Identifier::ids.end(); i++)
+		bytes[ms_identifiers] += string_bytes(i->second.get_id().length()) +
+			string_bytes(i->second.get_newid().length());
+}
+
+void
+MemStat::measure_calls()
+{
+	bytes[ms_calls] = tree_bytes(Call::all.size(), sizeof(Call::fun_map::value_type));
+	elements[ms_calls] = Call::all.size();
+	bytes[ms_call_sets] = elements[ms_call_sets] = 0;
+	bytes[ms_funmetrics] = elements[ms_funmetrics] = 0;
+	for (Call::fun_map::const_iterator i = Call::all.begin(); i != Call::all.end(); i++) {
+		const Call *c = i->second;
+		bytes[ms_calls] += sizeof(Call) + string_bytes(c->name.length());
+
+		size_t n = c->call.size() + c->caller.size();
+		bytes[ms_call_sets] += tree_bytes(n, sizeof(Call *));
+		elements[ms_call_sets] += n;
+
+		const FunMetrics &m = c->m;
+		bytes[ms_funmetrics] += tree_bytes(m.operators.size(), sizeof(int));
+		n = m.pids.size() + m.fids.size() + m.mids.size() + m.ids.size();
+		bytes[ms_funmetrics] += tree_bytes(n, sizeof(Eclass *));
+		elements[ms_funmetrics] += n + m.operators.size();
+	}
+}
+
+void
+MemStat::measure_files()
+{
+	bytes[ms_line_ends] = elements[ms_line_ends] = 0;
+	bytes[ms_processed_lines] = elements[ms_processed_lines] = 0;
+	bytes[ms_includes] = elements[ms_includes] = 0;
+	for (FI_id_to_details::const_iterator i = Fileid::i2d.begin(); i != Fileid::i2d.end(); i++) {
+		bytes[ms_line_ends] += i->line_ends.capacity() * sizeof(streampos);
+		elements[ms_line_ends] += i->line_ends.size();
+		bytes[ms_processed_lines] += i->processed_lines.capacity() / 8;
+		elements[ms_processed_lines] += i->processed_lines.size();
+
+		const FileIncMap * const maps[] = {&i->includes, &i->includers};
+		for (int j = 0; j < 2; j++) {
+			bytes[ms_includes] += tree_bytes(maps[j]->size(), sizeof(FileIncMap::value_type));
+			elements[ms_includes] += maps[j]->size();
+			for (FileIncMap::const_iterator k = maps[j]->begin(); k != maps[j]->end(); k++)
+				bytes[ms_includes] += tree_bytes(k->second.include_line_numbers().size(), sizeof(int));
+		}
+	}
+}
+
+void
+MemStat::measure_macros()
+{
+	bytes[ms_macros] = tree_bytes(Pdtoken::macros.size(), sizeof(mapMacro::value_type));
+	elements[ms_macros] = Pdtoken::macros.size();
+	for (mapMacro::const_iterator i = Pdtoken::macros.begin(); i != Pdtoken::macros.end(); i++) {
+		const Macro &m = i->second;
+		bytes[ms_macros] += string_bytes(i->first.length()) +
+			deque_bytes(m.name_token.get_parts_size(), sizeof(Tpart));
+		const dequePtoken * const seqs[] = {&m.formal_args, &m.value};
+		for (int j = 0; j < 2; j++) {
+			bytes[ms_macros] += deque_bytes(seqs[j]->size(), sizeof(Ptoken));
+			for (dequePtoken::const_iterator k = seqs[j]->begin(); k != seqs[j]->end(); k++)
+				bytes[ms_macros] += string_bytes(k->get_val().length()) +
+					deque_bytes(k->get_parts_size(), sizeof(Tpart));
+		}
+	}
+	bytes[ms_macro_body] = tree_bytes(Pdtoken::macro_body_tokens.size(), sizeof(mapMacroBody::value_type));
+	elements[ms_macro_body] = Pdtoken::macro_body_tokens.size();
+}
+
+void
+MemStat::measure_fdep()
+{
+	const Fdep::FSFMap * const maps[] = {&Fdep::definers, &Fdep::includers};
+	bytes[ms_fdep] = elements[ms_fdep] = 0;
+	for (int j = 0; j < 2; j++) {
+		bytes[ms_fdep] += tree_bytes(maps[j]->size(), sizeof(Fdep::FSFMap::value_type));
+		elements[ms_fdep] += maps[j]->size();
+		for (Fdep::FSFMap::const_iterator i = maps[j]->begin(); i != maps[j]->end(); i++) {
+			bytes[ms_fdep] += tree_bytes(i->second.size(), sizeof(Fileid));
+			elements[ms_fdep] += i->second.size();
+		}
+	}
+	bytes[ms_fdep] += tree_bytes(Fdep::providers.size(), sizeof(Fileid));
+	elements[ms_fdep] += Fdep::providers.size();
+	bytes[ms_fdep] += tree_bytes(Fdep::include_triggers.size(), sizeof(Fdep::ITMap::value_type));
+	elements[ms_fdep] += Fdep::include_triggers.size();
+	for (Fdep::ITMap::const_iterator i = Fdep::include_triggers.begin(); i != Fdep::include_triggers.end(); i++) {
+		bytes[ms_fdep] += tree_bytes(i->second.size(), sizeof(Fdep::include_trigger_element));
+		elements[ms_fdep] += i->second.size();
+	}
+}
+
+void
+MemStat::measure()
+{
+	measure_tokid_map();
+	measure_identifiers();
+	measure_calls();
+	measure_files();
+	measure_macros();
+	measure_fdep();
+}
+
+void
+MemStat::html(ostream &o)
+{
+	measure();
+	size_t total = 0;
+	for (int i = 0; i < ms_max; i++)
+		total += bytes[i];
+
+	o << fixed << setprecision(1);
+	o << "<h2>Memory Use</h2>\n"
+		"<table class='metrics'>"
+		"<tr><th>" "Structure" "</th>"
+		"<th>" "Elements" "</th>"
+		"<th>" "Estimated bytes" "</th>"
+		"<th>" "%" "</th></tr>\n";
+	for (int i = 0; i < ms_max; i++)
+		o << "<tr><td>" << structure_name[i] << "</td>"
+			"<td>" << elements[i] << "</td>"
+			"<td>" << bytes[i] << "</td>"
+			"<td>" << (total ? bytes[i] * 100. / total : 0.) << "</td></tr>\n";
+	o << "<tr><td>" "Total" "</td>"
+		"<td></td>"
+		"<td>" << total << "</td>"
+		"<td></td></tr>\n";
+	o << "</table>\n";
+	o << "<p>Peak resident set size: " << Profile::peak_rss_kb() << " kB</p>\n";
+}
+
+void
+MemStat::json(ostream &o)
+{
+	measure();
+	o << "{\n\t\"structures\": {";
+	for (int i = 0; i < ms_max; i++)
+		o << (i ? "," : "") << "\n\t\t\"" << structure_name[i] << "\": "
+			"{\"elements\": " << elements[i] << ", \"bytes\": " << bytes[i] << "}";
+	o << "\n\t},\n\t\"peak_rss_kb\": " << Profile::peak_rss_kb() << "\n}\n";
+}
@@ -0,0 +1,91 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * An estimate of the memory held by CScout's main data structures.
+ * The estimate is obtained on demand by traversing the structures
+ * and adding the node and element sizes of the containers they use,
+ * as laid out by the GNU C++ library, so that it costs nothing while
+ * the code is processed.
+ * The members of the equivalence classes, which are far too many to
+ * traverse, are estimated from a sample of the classes.
+ *
+ */
+
+#ifndef MEMSTAT_
+#define MEMSTAT_
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <iostream>
+
+using namespace std;
+
+class MemStat {
+public:
+	// Data structures whose memory is estimated
+	enum e_structure {
+		ms_tokid_map,		// Tokid::tm
+		ms_eclass,		// Eclass objects
+		ms_eclass_members,	// Eclass member sets
+		ms_identifiers,		// Identifier::ids
+		ms_calls,		// Call::all and the Call objects
+		ms_call_sets,		// Call call and caller sets
+		ms_funmetrics,		// FunMetrics operator and identifier sets
+		ms_line_ends,		// Filedetails line_ends
+		ms_processed_lines,	// Filedetails processed_lines
+		ms_includes,		// Filedetails includes and includers maps
+		ms_macros,		// Pdtoken::macros
+		ms_macro_body,		// Pdtoken::macro_body_tokens
+		ms_fdep,		// Fdep maps
+		ms_max
+	};
+private:
+	static const char * const structure_name[ms_max];
+	static size_t bytes[ms_max];		// Estimated bytes held
+	static size_t elements[ms_max];		// Elements held
+	enum {sample_size = 10000};		// Classes sampled for their members
+
+	// Bytes of a tree (set or map) node holding n elements of size s
+	static size_t tree_bytes(size_t n, size_t s) {
+		return n * (4 * sizeof(void *) + s);
+	}
+	// Bytes of the elements and the map of a deque holding n elements of size s
+	static size_t deque_bytes(size_t n, size_t s);
+	// Bytes allocated for the characters of a string of length len
+	static size_t string_bytes(size_t len) {
+		return len > 15 ? len + 1 : 0;
+	}
+	// Estimate the memory of all structures
+	static void measure();
+	// Estimate the memory of each structure
+	static void measure_tokid_map();
+	static void measure_identifiers();
+	static void measure_calls();
+	static void measure_files();
+	static void measure_macros();
+	static void measure_fdep();
+public:
+	// Report the estimates as an HTML table
+	static void html(ostream &o);
+	// Report the estimates as a JSON object
+	static void json(ostream &o);
+};
+
+#endif // MEMSTAT_
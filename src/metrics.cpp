@@ -68,6 +68,16 @@ Metrics::process_id(const string &s, Eclass *ec)
 	currlinelen += s.length();
 }
 
+// Clear the metrics collected during post-processing
+void
+Metrics::clear_postprocessing()
+{
+	for (int i = 0; i < em_nppdirective; i++)
+		count[i] = 0;
+	currlinelen = 0;
+	cstate = s_normal;
+}
+
 // Called for all file characters appart from identifiers
 void
 Metrics::process_char(char c)
@@ -159,6 +169,15 @@ IdCount::add(Eclass *ec, UnaryFunction f)
 			count[i] = f(count[i]);
 }
 
+// Add the counts of c
+void
+IdCount::add(const IdCount &c)
+{
+	total += c.total;
+	for (int i = attr_begin; i < attr_end; i++)
+		count[i] += c.count[i];
+}
+
 // Called for each identifier occurence (all)
 void
 IdMetricsSummary::add_id(Eclass *ec)
@@ -166,6 +185,14 @@ IdMetricsSummary::add_id(Eclass *ec)
 	rw[ec->get_attribute(is_readonly)].all.add(ec, add_one());
 }
 
+// Add the identifier occurences counted in s
+void
+IdMetricsSummary::add_ids(const IdMetricsSummary &s)
+{
+	rw[false].all.add(s.rw[false].all);
+	rw[true].all.add(s.rw[true].all);
+}
+
 // Called for each unique identifier occurence (EC)
 void
 IdMetricsSummary::add_unique_id(Eclass *ec)
@@ -70,6 +70,7 @@ struct MetricDetails {
 
 // Metrics for regions of code (files and functions)
 class Metrics {
+	friend class Snapshot;
 private:
 	int currlinelen;
 	enum e_cfile_state cstate;
@@ -126,6 +127,8 @@ public:
 	void add_ctoken() { if (!processed) count[em_nctoken]++; }
 
 	void done_processing() { processed = true; }
+	// Clear the metrics collected during post-processing
+	void clear_postprocessing();
 	bool is_processed() const { return processed; }
 
 	// Get methods
@@ -157,6 +160,7 @@ class IdMetricsSet;
 
 // A class for keeping taly of various identifier type counts
 class IdCount {
+	friend class Snapshot;
 private:
 	double total;
 	vector <double> count;		// Counts per identifier attribute
@@ -170,6 +174,8 @@ public:
 	// using function object f
 	template <class UnaryFunction>
 	void add(Eclass *ec, UnaryFunction f);
+	// Add the counts of c
+	void add(const IdCount &c);
 	friend ostream& operator<<(ostream& o, const IdMetricsSet &m);
 };
 
@@ -179,6 +185,7 @@ class IdMetricsSet;
 
 // One such set is kept for readable and writable identifiers
 class IdMetricsSet {
+	friend class Snapshot;
 	friend class IdMetricsSummary;
 	IdCount once;	// Each identifier EC is counted once
 	IdCount len;	// Use the len of each EC
@@ -191,12 +198,15 @@ public:
 
 // This can be kept per project and globally
 class IdMetricsSummary {
+	friend class Snapshot;
 	IdMetricsSet rw[2];			// For writable (0) and read-only (1) cases
 public:
 	// Called for every identifier occurence
 	void add_id(Eclass *ec);
 	// Called for every unique identifier occurence (EC)
 	void add_unique_id(Eclass *ec);
+	// Add the identifier occurences counted in s
+	void add_ids(const IdMetricsSummary &s);
 	friend ostream& operator<<(ostream& o,const IdMetricsSummary &ms);
 };
 
@@ -0,0 +1,146 @@
+#!/usr/bin/env perl
+#
+# (C) Copyright 2016 Diomidis Spinellis
+#
+# This file is part of CScout.
+#
+# CScout is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# CScout is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+#
+#
+# Generate a synthetic C workspace for benchmarking CScout
+#
+# Syntax: mkbench.pl [-d depth] [-f files] [-i ids] [-m macros] [-x xrefs] dir
+#
+# -d depth	Depth of the header file include chain (default 5)
+# -f files	Number of C files (default 100)
+# -i ids	Functions and variables defined in each file (default 50)
+# -m macros	Macros defined in each header and file (default 10)
+# -x xrefs	References from each file to functions of other files
+#		(default 10)
+#
+# The generated workspace is stored in dir/bench.cs.
+# The output depends only on the specified parameters, so that the
+# same workspace is generated on every run.
+#
+
+use strict;
+use Getopt::Std;
+
+my %opt;
+getopts('d:f:i:m:x:', \%opt) || usage();
+usage() unless ($#ARGV == 0);
+
+my $depth = defined($opt{d}) ? $opt{d} : 5;
+my $files = defined($opt{f}) ? $opt{f} : 100;
+my $ids = defined($opt{i}) ? $opt{i} : 50;
+my $macros = defined($opt{m}) ? $opt{m} : 10;
+my $xrefs = defined($opt{x}) ? $opt{x} : 10;
+my $dir = $ARGV[0];
+
+$depth = 1 if ($depth < 1);
+$files = 1 if ($files < 1);
+$ids = 1 if ($ids < 1);
+$macros = 1 if ($macros < 1);
+
+mkdir($dir);
+mkdir("$dir/include");
+
+# Header files: h0.h includes h1.h, which includes h2.h, and so on.
+# Each macro of a header expands the corresponding macro of the next one.
+for (my $d = 0; $d < $depth; $d++) {
+	open(OUT, ">$dir/include/h$d.h") || die "Unable to open $dir/include/h$d.h for writing: $!\n";
+	print OUT "#ifndef H${d}_H\n#define H${d}_H\n\n";
+	print OUT '#include "h' . ($d + 1) . ".h\"\n\n" if ($d + 1 < $depth);
+	for (my $j = 0; $j < $macros; $j++) {
+		if ($d + 1 < $depth) {
+			print OUT "#define H${d}_M$j(x) ((x) * $j + H" . ($d + 1) . "_M$j(x))\n";
+		} else {
+			print OUT "#define H${d}_M$j(x) ((x) + $j)\n";
+		}
+	}
+	print OUT "\nstruct h${d}_s {\n";
+	for (my $j = 0; $j < $macros; $j++) {
+		print OUT "\tint m$j;\n";
+	}
+	print OUT "};\n\n";
+	for (my $j = 0; $j < $macros; $j++) {
+		print OUT "extern int h${d}_var$j;\n";
+	}
+	print OUT "\n#endif\n";
+	close(OUT);
+}
+
+# C files: each defines $ids functions with a static variable,
+# and its first function calls functions defined in other files
+for (my $i = 0; $i < $files; $i++) {
+	open(OUT, ">$dir/f$i.c") || die "Unable to open $dir/f$i.c for writing: $!\n";
+	print OUT "#include \"h0.h\"\n\n";
+	for (my $j = 0; $j < $macros; $j++) {
+		print OUT "#define F${i}_M$j(x) (H0_M$j(x) + $j)\n";
+	}
+	print OUT "\n";
+	for (my $r = 1; $r <= $xrefs; $r++) {
+		print OUT "extern int " . xref($i, $r) . "(int);\n";
+	}
+	print OUT "\n";
+	for (my $j = 0; $j < $ids; $j++) {
+		my $m = $j % $macros;
+		print OUT "static int f${i}_var$j;\n\n";
+		print OUT "int\nf${i}_fn$j(int a)\n{\n";
+		print OUT "\tstruct h0_s s;\n\tint l = a;\n\n";
+		print OUT "\ts.m$m = F${i}_M$m(l);\n";
+		print OUT "\tl += f${i}_var$j + s.m$m + h0_var$m;\n";
+		if ($j == 0) {
+			for (my $r = 1; $r <= $xrefs; $r++) {
+				print OUT "\tl += " . xref($i, $r) . "(l);\n";
+			}
+		} else {
+			print OUT "\tl += f${i}_fn" . ($j - 1) . "(l);\n";
+		}
+		print OUT "\treturn l;\n}\n\n";
+	}
+	close(OUT);
+}
+
+# The workspace
+open(OUT, ">$dir/bench.cs") || die "Unable to open $dir/bench.cs for writing: $!\n";
+print OUT "// workspace bench\n";
+print OUT "#pragma project \"bench\"\n";
+print OUT "#pragma block_enter\n";
+for (my $i = 0; $i < $files; $i++) {
+	print OUT "// file f$i.c\n";
+	print OUT "#pragma block_enter\n";
+	print OUT "#pragma clear_defines\n";
+	print OUT "#pragma clear_include\n";
+	print OUT "#pragma includepath \"include\"\n";
+	print OUT "#pragma process \"f$i.c\"\n";
+	print OUT "#pragma block_exit\n";
+}
+print OUT "#pragma block_exit\n";
+close(OUT);
+
+# Return the name of the function that file $i references through its
+# reference $r
+sub xref
+{
+	my($i, $r) = @_;
+
+	return 'f' . (($i + $r * 7) % $files) . '_fn' . ($r % $ids);
+}
+
+sub usage
+{
+	print STDERR "usage: $0 [-d depth] [-f files] [-i ids] [-m macros] [-x xrefs] dir\n";
+	exit(1);
+}
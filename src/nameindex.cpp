@@ -0,0 +1,296 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * For documentation read the corresponding .h file
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+
+#include "nameindex.h"
+
+// Return the position of the ] closing the bracket expression at re[i]
+// or string::npos if there is none
+static string::size_type
+bracket_end(const string &re, string::size_type i)
+{
+	i++;
+	if (i < re.length() && re[i] == '^')
+		i++;
+	if (i < re.length() && re[i] == ']')
+		i++;
+	for (; i < re.length(); i++)
+		if (re[i] == '[' && i + 1 < re.length() &&
+		    (re[i + 1] == ':' || re[i + 1] == '.' || re[i + 1] == '=')) {
+			// Character class, collating symbol, or equivalence class
+			string::size_type e = re.find(string(1, re[i + 1]) + "]", i + 2);
+			if (e == string::npos)
+				return string::npos;
+			i = e + 1;
+		} else if (re[i] == ']')
+			return i;
+	return string::npos;
+}
+
+// Return the position of the ) closing the group at re[i]
+// or string::npos if there is none
+static string::size_type
+group_end(const string &re, string::size_type i)
+{
+	int depth = 0;
+	for (; i < re.length(); i++)
+		switch (re[i]) {
+		case '\\':
+			i++;
+			break;
+		case '[':
+			if ((i = bracket_end(re, i)) == string::npos)
+				return string::npos;
+			break;
+		case '(':
+			depth++;
+			break;
+		case ')':
+			if (--depth == 0)
+				return i;
+			break;
+		}
+	return string::npos;
+}
+
+// Remove from s its last (possibly multibyte UTF-8) character
+static void
+drop_last(string &s)
+{
+	while (!s.empty() && ((unsigned char)s[s.length() - 1] & 0xc0) == 0x80)
+		s.erase(s.length() - 1);
+	if (!s.empty())
+		s.erase(s.length() - 1);
+}
+
+/*
+ * Scan the RE, collecting the maximal runs of literal characters
+ * that are not subject to alternation or to a quantifier allowing
+ * zero repetitions.  Groups are skipped as a whole, so only
+ * alternation at the top level prevents the analysis.
+ */
+RELiterals::RELiterals(const string &re) : valid(false), exact(false)
+{
+	string run;			// Current run of literal characters
+	bool literal = false;		// The last atom is run's last character
+	bool whole = true;		// Run started at the RE's beginning
+	bool start_anchored = false, end_anchored = false;
+
+	for (string::size_type i = 0; i < re.length(); i++) {
+		switch (re[i]) {
+		case '|':
+			return;
+		case '^':
+			if (i == 0) {
+				start_anchored = true;
+				continue;
+			}
+			break;
+		case '$':
+			if (i == re.length() - 1) {
+				end_anchored = true;
+				continue;
+			}
+			break;
+		case '.':
+			break;
+		case '[':
+			if ((i = bracket_end(re, i)) == string::npos)
+				return;
+			break;
+		case '(':
+			if ((i = group_end(re, i)) == string::npos)
+				return;
+			break;
+		case '{':
+			if ((i = re.find('}', i)) == string::npos)
+				return;
+			// FALLTHROUGH
+		case '*':
+		case '?':
+			if (literal)
+				drop_last(run);
+			break;
+		case '+':
+			/*
+			 * A following quantifier, as in a+? or a+*, applies
+			 * to the repetition, making the character optional
+			 */
+			for (string::size_type j = i + 1; j < re.length() && strchr("+*?{", re[j]); j++)
+				if (re[j] != '+') {
+					if (literal)
+						drop_last(run);
+					break;
+				}
+			break;
+		case '\\':
+			if (i + 1 < re.length() && CompiledRE::is_special(re[i + 1])) {
+				run += re[++i];
+				literal = true;
+				continue;
+			}
+			i++;
+			break;
+		default:
+			run += re[i];
+			literal = true;
+			continue;
+		}
+		// A non-literal element or a quantifier ends the run
+		if (!run.empty()) {
+			if (start_anchored && whole)
+				prefix = run;
+			required.push_back(run);
+			run.clear();
+		}
+		literal = false;
+		whole = false;
+	}
+	if (!run.empty()) {
+		if (start_anchored && whole)
+			prefix = run;
+		required.push_back(run);
+	}
+	exact = start_anchored && end_anchored && whole && !prefix.empty();
+	valid = true;
+}
+
+#ifdef UNIT_TEST
+// g++ -DUNIT_TEST nameindex.cpp
+
+#include <set>
+
+static void
+show(const string &re)
+{
+	RELiterals lit(re);
+	cout << re << ':';
+	if (!lit.is_valid()) {
+		cout << " invalid\n";
+		return;
+	}
+	for (vector <string>::const_iterator i = lit.get_required().begin(); i != lit.get_required().end(); i++)
+		cout << " [" << *i << ']';
+	cout << " prefix=" << lit.get_prefix() << (lit.is_exact() ? " exact" : "") << '\n';
+}
+
+static const char *names[] = {
+	"main", "get", "get_value", "get_name", "getName", "GET_NAME",
+	"Get_Name", "set_name", "reset_name", "name", "names", "nam", "a",
+	"ab", "x_count", "xab_count", "xAB_count", "str_cpy", "strcpy_s",
+	"strcat_s", "foobar", "fobar", "fooobar", "abcdef", "abdef",
+	"abccdef", "get_get", "target", "getter", "_get", "get2", "read",
+	"write", "readwrite", "a1b2c3", "caf\xc3\xa9", "CAF\xc3\x89",
+	"\xc3\xa9t\xc3\xa9", NULL
+};
+
+static const char *res[] = {
+	"^main$", "^get_", "^get", "get$", "_name$", "name", "NAME",
+	"^GET_NAME$", "Get", "\\<get\\>", "\\<get", "get\\>", "get\\_name",
+	"read|write", "^(get|set)_", "^str(cpy|cat)_s$", "x[a-z]+_count",
+	"fo{0,1}bar", "^abc*def", "a.e", "ab", "^a$", "^$", "",
+	"^[A-Z]", "caf\xc3\xa9", "\xc3\xa9", "^CAF", "get_+?name", "a+*",
+	NULL
+};
+
+/*
+ * Match the names against re through regexec, through CompiledRE,
+ * which can use its literal matching, and through the regexec of the
+ * index's candidates.  Report the results and return false if they
+ * differ.
+ */
+static bool
+check(const NameIndex <int> &ni, const string &re, bool icase)
+{
+	int flags = REG_EXTENDED | REG_NOSUB | (icase ? REG_ICASE : 0);
+	regex_t raw;
+	cout << '"' << re << '"' << (icase ? " icase" : "") << ':';
+	if (regcomp(&raw, re.c_str(), flags) != 0) {
+		cout << " invalid\n";
+		return true;
+	}
+	CompiledRE cre(re.c_str(), flags);
+	set <int> expected, literal, indexed;
+	for (int i = 0; names[i]; i++) {
+		if (regexec(&raw, names[i], 0, NULL, 0) == 0)
+			expected.insert(i);
+		if (cre.exec(names[i]) == 0)
+			literal.insert(i);
+	}
+	vector <int> r;
+	bool narrowed = ni.candidates(re, icase, r);
+	if (!narrowed)
+		for (int i = 0; names[i]; i++)
+			r.push_back(i);
+	for (vector <int>::const_iterator i = r.begin(); i != r.end(); i++)
+		if (regexec(&raw, names[*i], 0, NULL, 0) == 0)
+			indexed.insert(*i);
+	regfree(&raw);
+
+	cout << ' ' << expected.size() << " matches";
+	if (narrowed)
+		cout << " in " << r.size() << " candidates";
+	if (literal != expected)
+		cout << " literal mismatch";
+	if (indexed != expected)
+		cout << " index mismatch";
+	cout << '\n';
+	return literal == expected && indexed == expected;
+}
+
+int
+main()
+{
+	show("^main$");
+	show("^get_");
+	show("^abc*def");
+	show("read|write");
+	show("^str(cpy|cat)_s$");
+	show("x[a-z]+_count");
+	show("\\.c$");
+	show("fo{0,1}bar");
+	show("\\<get\\>");
+
+	NameIndex <int> ni;
+	for (int i = 0; names[i]; i++)
+		ni.add(names[i], i);
+	ni.build();
+	int failed = 0;
+	for (int i = 0; res[i]; i++) {
+		if (!check(ni, res[i], false))
+			failed++;
+		if (!check(ni, res[i], true))
+			failed++;
+	}
+	return failed ? 1 : 0;
+}
+#endif /* UNIT_TEST */
@@ -0,0 +1,190 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * An index of identifier and function names for narrowing the
+ * elements whose names a query's regular expression must examine.
+ * A sorted name table answers exact-name and literal-prefix queries
+ * with a binary search; a trigram index answers queries containing
+ * literal strings of three or more characters.  The returned
+ * candidates are a superset of the matching elements: the query's
+ * regular expression must still be applied to each one of them.
+ *
+ */
+
+#ifndef NAMEINDEX_
+#define NAMEINDEX_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <cctype>
+
+#include "compiledre.h"
+
+using namespace std;
+
+// The literal strings that all matches of an extended RE contain
+class RELiterals {
+private:
+	bool valid;			// False if nothing is known about matches
+	vector <string> required;	// Strings every match contains
+	string prefix;			// String every match starts with
+	bool exact;			// True if the RE only matches prefix
+public:
+	RELiterals(const string &re);
+	bool is_valid() const { return valid; }
+	const vector <string> &get_required() const { return required; }
+	const string &get_prefix() const { return prefix; }
+	bool is_exact() const { return exact; }
+};
+
+template <class T>
+class NameIndex {
+private:
+	typedef vector <pair <string, T> > names_type;
+	typedef vector <unsigned> postings_type;
+	typedef map <unsigned, postings_type> trigrams_type;
+
+	names_type names;		// Elements ordered by name
+	trigrams_type trigrams;		// Lower case trigram to names ordinals
+
+	// Compare an element's name against a string
+	struct name_less {
+		bool operator()(const pair <string, T> &a, const string &b) const {
+			return a.first < b;
+		}
+	};
+
+	// Return the key of the lower case trigram starting at s
+	static unsigned trigram(const char *s) {
+		return ((unsigned)(unsigned char)tolower(s[0]) << 16) |
+		    ((unsigned)(unsigned char)tolower(s[1]) << 8) |
+		    (unsigned)(unsigned char)tolower(s[2]);
+	}
+
+	// Intersect r with the ordinals of the names containing s
+	// Return false if r becomes empty
+	bool intersect(const string &s, postings_type &r, bool &first) const {
+		for (string::size_type i = 0; i + 3 <= s.length(); i++) {
+			typename trigrams_type::const_iterator t = trigrams.find(trigram(s.c_str() + i));
+			if (t == trigrams.end()) {
+				r.clear();
+				first = false;
+				return false;
+			}
+			if (first) {
+				r = t->second;
+				first = false;
+			} else {
+				postings_type both;
+				set_intersection(r.begin(), r.end(),
+				    t->second.begin(), t->second.end(),
+				    back_inserter(both));
+				r.swap(both);
+			}
+			if (r.empty())
+				return false;
+		}
+		return true;
+	}
+public:
+	// Add an element; build must be called before lookups
+	void add(const string &name, T val) {
+		names.push_back(pair <string, T>(name, val));
+	}
+
+	// Order the names and index their trigrams
+	void build() {
+		sort(names.begin(), names.end());
+		trigrams.clear();
+		for (unsigned n = 0; n < names.size(); n++) {
+			const string &s = names[n].first;
+			for (string::size_type i = 0; i + 3 <= s.length(); i++) {
+				postings_type &p = trigrams[trigram(s.c_str() + i)];
+				if (p.empty() || p.back() != n)
+					p.push_back(n);
+			}
+		}
+	}
+
+	void clear() {
+		names.clear();
+		trigrams.clear();
+	}
+
+	int size() const { return names.size(); }
+
+	/*
+	 * Set result to the elements whose names can match the
+	 * specified extended RE, compiled with REG_ICASE if icase is true.
+	 * Return false if the RE does not allow the index to narrow
+	 * the elements; all of them must then be examined.
+	 */
+	bool candidates(const string &re, bool icase, vector <T> &result) const {
+		RELiterals lit(re);
+		if (!lit.is_valid())
+			return false;
+
+		// Range of the names starting with the RE's literal prefix
+		unsigned lo = 0, hi = names.size();
+		bool narrowed = false;
+		const string &prefix = lit.get_prefix();
+		if (!icase && !prefix.empty()) {
+			typename names_type::const_iterator b, e;
+			b = lower_bound(names.begin(), names.end(), prefix, name_less());
+			if (lit.is_exact()) {
+				e = b;
+				while (e != names.end() && e->first == prefix)
+					e++;
+			} else {
+				e = b;
+				while (e != names.end() && e->first.compare(0, prefix.length(), prefix) == 0)
+					e++;
+			}
+			lo = b - names.begin();
+			hi = e - names.begin();
+			narrowed = true;
+		}
+
+		postings_type ordinals;
+		bool first = true;
+		const vector <string> &req = lit.get_required();
+		for (vector <string>::const_iterator i = req.begin(); i != req.end(); i++)
+			if ((!icase || CompiledRE::is_ascii(*i)) && !intersect(*i, ordinals, first))
+				break;
+
+		result.clear();
+		if (!first) {
+			for (postings_type::const_iterator i = ordinals.begin(); i != ordinals.end(); i++)
+				if (*i >= lo && *i < hi)
+					result.push_back(names[*i].second);
+			return true;
+		} else if (narrowed) {
+			for (unsigned i = lo; i < hi; i++)
+				result.push_back(names[i].second);
+			return true;
+		} else
+			return false;
+	}
+};
+
+#endif // NAMEINDEX_
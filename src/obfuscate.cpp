@@ -57,6 +57,7 @@
 #include "ctoken.h"
 #include "type.h"
 #include "stab.h"
+#include "filescan.h"
 
 /*
  * Infrastructure to print everything but comments
@@ -213,14 +214,9 @@ file_obfuscate(Fileid fid)
 {
 	string plain;
 	Tokid plainstart;
-	fifstream in;
 	ofstream out;
 
-	in.open(fid.get_path().c_str(), ios::binary);
-	if (in.fail()) {
-		perror(fid.get_path().c_str());
-		exit(1);
-	}
+	FileScan scan(fid);
 	string ofname = fid.get_path() + ".obf";
 	out.open(ofname.c_str(), ios::binary);
 	if (out.fail()) {
@@ -231,16 +227,10 @@ file_obfuscate(Fileid fid)
 	bool yacc_file = (fid.get_path()[fid.get_path().length() - 1] == 'y');
 	CProcessor::reset();
 	// Go through the file character by character
-	for (;;) {
-		Tokid ti;
-		int val;
-
-		ti = Tokid(fid, in.tellg());
-		if ((val = in.get()) == EOF)
-			break;
+	while (scan.next()) {
 		Eclass *ec;
 		// Identifiers that can be obfuscated
-		if ((ec = ti.check_ec()) &&
+		if ((ec = scan.get_ec()) &&
 		    (ec->get_attribute(is_readonly) == false) &&
 		    (ec->get_attribute(is_macro) ||
 		     ec->get_attribute(is_macro_arg) ||
@@ -248,11 +238,7 @@ file_obfuscate(Fileid fid)
 		     ec->get_attribute(is_suetag) ||
 		     ec->get_attribute(is_sumember) ||
 		     ec->get_attribute(is_label))) {
-			int len = ec->get_len();
-			string s;
-			s = (char)val;
-			for (int j = 1; j < len; j++)
-				s += (char)in.get();
+			string s(scan.get_token(ec->get_len()));
 			if (yacc_file) {
 				if (s == "error" ||
 				    s == "yyerrok" ||
@@ -270,7 +256,7 @@ file_obfuscate(Fileid fid)
 					CProcessor::output_id(out, ptr_offset(ec));
 			}
 		} else {
-			CProcessor::process_char(out, (char)val);
+			CProcessor::process_char(out, scan.get_char());
 		}
 	}
 }
@@ -0,0 +1,181 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * For documentation read the corresponding .h file
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#if defined(unix) || defined(__unix__) || defined(__MACH__)
+#include <unistd.h>		// fork(2)
+#include <sys/mman.h>		// mmap(2)
+#include <sys/wait.h>		// waitpid(2)
+#define HAVE_FORK
+#endif
+
+#include "cpp.h"
+#include "error.h"
+#include "attr.h"
+#include "metrics.h"
+#include "fileid.h"
+#include "tokid.h"
+#include "fdep.h"
+#include "snapshot.h"
+#include "parallel.h"
+
+int Parallel::nworkers;
+long *Parallel::next_segment;
+long Parallel::segment;
+long Parallel::claimed;
+
+long
+Parallel::claim()
+{
+	return __sync_fetch_and_add(next_segment, 1);
+}
+
+void
+Parallel::new_project()
+{
+	if (nworkers == 0)
+		return;
+	// Once done with our segment, go for the next unclaimed one
+	if (segment == claimed)
+		claimed = claim();
+	segment++;
+}
+
+#ifdef HAVE_FORK
+// Create an empty temporary file, setting name to its path; return its descriptor
+static int
+temp_file(string &name)
+{
+	const char *dir = getenv("TMPDIR");
+	string tmpl(string(dir ? dir : "/tmp") + "/cscoutXXXXXX");
+	vector <char> path(tmpl.begin(), tmpl.end());
+	path.push_back('\0');
+	int fd = mkstemp(&path[0]);
+	if (fd == -1)
+		/*
+		 * @error
+		 * A temporary file for the results of a worker
+		 * process specified with the -P option could not be
+		 * created.
+		 * Set the TMPDIR environment variable to a writable
+		 * directory
+		 */
+		Error::error(E_FATAL, tmpl + ": unable to create temporary file: " + string(strerror(errno)), false);
+	name = &path[0];
+	return fd;
+}
+
+Fileid
+Parallel::process(const char *fname, void (*pass)(const char *))
+{
+	vector <string> images(nworkers), outputs(nworkers);
+	vector <pid_t> pids(nworkers);
+
+	next_segment = (long *)mmap(NULL, sizeof(long), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+	if (next_segment == MAP_FAILED)
+		Error::error(E_FATAL, "mmap: " + string(strerror(errno)), false);
+	*next_segment = 0;
+
+	cerr << "Processing the workspace with " << nworkers << " worker processes" << endl;
+	cout.flush();
+	fflush(NULL);
+	for (int i = 0; i < nworkers; i++) {
+		close(temp_file(images[i]));
+		int out = temp_file(outputs[i]);
+		pids[i] = fork();
+		if (pids[i] == -1)
+			Error::error(E_FATAL, "fork: " + string(strerror(errno)), false);
+		if (pids[i] == 0) {
+			dup2(out, STDOUT_FILENO);
+			close(out);
+			claimed = claim();
+			Snapshot::record_linkage();
+			Fdep::defer_dump();
+			pass(fname);
+			Snapshot::save(images[i], Fileid(fname));
+			cout.flush();
+			fflush(NULL);
+			_exit(0);
+		}
+		close(out);
+	}
+
+	bool failed = false;
+	for (int i = 0; i < nworkers; i++) {
+		int status;
+		while (waitpid(pids[i], &status, 0) == -1)
+			if (errno != EINTR)
+				Error::error(E_FATAL, "waitpid: " + string(strerror(errno)), false);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			failed = true;
+	}
+	munmap(next_segment, sizeof(long));
+
+	// The workers' output, in the order of the workers, not of the projects
+	for (int i = 0; i < nworkers; i++) {
+		ifstream in(outputs[i].c_str(), ios::binary);
+		if (in.peek() != EOF)
+			cout << in.rdbuf();
+		in.close();
+		unlink(outputs[i].c_str());
+	}
+	if (failed) {
+		for (int i = 0; i < nworkers; i++)
+			unlink(images[i].c_str());
+		/*
+		 * @error
+		 * A worker process specified with the -P option
+		 * failed to process its part of the workspace.
+		 * Its errors are reported before this one
+		 */
+		Error::error(E_FATAL, "workspace processing failed in a worker process", false);
+	}
+
+	Snapshot::prepare_merge(images);
+	for (int i = 0; i < nworkers; i++) {
+		Snapshot::merge(images[i]);
+		unlink(images[i].c_str());
+	}
+	return Fileid(fname);
+}
+#else
+Fileid
+Parallel::process(const char *fname, void (*pass)(const char *))
+{
+	/*
+	 * @error
+	 * Processing the workspace with multiple worker processes
+	 * (the -P option) is not supported on this platform
+	 */
+	Error::error(E_FATAL, "parallel workspace processing is not supported on this platform", false);
+	return Fileid();
+}
+#endif
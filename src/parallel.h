@@ -0,0 +1,65 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Processing of a workspace's projects by parallel worker processes.
+ * The preprocessor, the parser, and the symbol tables keep their
+ * state in static members, so projects cannot be processed by
+ * threads sharing an address space.  Instead, each worker is a
+ * forked process that reads the whole workspace file, but processes
+ * only the compilation units of the projects it claims from a shared
+ * counter.  Every worker saves its results in a workspace image,
+ * and the parent merges the images into its (empty) workspace.
+ * The output workers produce while processing is buffered in
+ * temporary files and copied to the standard output in the order
+ * of the workers.
+ *
+ */
+
+#ifndef PARALLEL_
+#define PARALLEL_
+
+#include "fileid.h"
+
+class Parallel {
+private:
+	static int nworkers;		// Number of worker processes; 0 for sequential processing
+	static long *next_segment;	// Next unclaimed segment; shared among the workers
+	static long segment;		// Segment of the workspace being read
+	static long claimed;		// Segment the worker processes next
+	// Return the next unclaimed workspace segment
+	static long claim();
+public:
+	// Process the workspace's projects using n worker processes
+	static void set_workers(int n) { nworkers = (n > 1 ? n : 0); }
+	static int get_workers() { return nworkers; }
+	// Return the segment being read; 0 for sequential processing
+	static long get_segment() { return segment; }
+	// Called when a new project (workspace segment) starts
+	static void new_project();
+	// Return true if this process must process the current project's units
+	static bool own_project() { return nworkers == 0 || segment == claimed; }
+	/*
+	 * Have the worker processes call pass(fname) to process the
+	 * workspace fname, and merge their results.
+	 * Return the workspace's root file.
+	 */
+	static Fileid process(const char *fname, void (*pass)(const char *));
+};
+
+#endif /* PARALLEL_ */
@@ -61,16 +61,24 @@
 #include "call.h"
 #include "mcall.h"
 #include "os.h"
+#include "dircache.h"
+#include "fdep.h"
 #include "ctag.h"
+#include "parallel.h"
+#include "unitcache.h"
+#include "profile.h"
 #include "type.h"		// stab.h
 #include "stab.h"		// Block::enter()
 
 bool Pdtoken::at_bol = true;
 bool Pdtoken::output_defines = false;
+bool Pdtoken::reread_guarded = false;
 PtokenSequence Pdtoken::expand;
 mapMacro Pdtoken::macros;		// Defined macros
 stackbool Pdtoken::iftaken;		// Taken #ifs
 vectorstring Pdtoken::include_path;	// Files in include path
+set <string> Pdtoken::skipped_units;	// Unique names of units #pragma process skips
+set <Fileid> Pdtoken::once_files;	// Files with #pragma once read
 int Pdtoken::skiplevel = 0;		// Level of enclosing #ifs when skipping
 mapMacroBody Pdtoken::macro_body_tokens;	// Tokens and the macros they belong to
 
@@ -78,6 +86,7 @@ mapMacroBody Pdtoken::macro_body_tokens;	// Tokens and the macros they belong to
 void
 Pdtoken::getnext()
 {
+	PhaseTimer timer(Profile::ph_preprocess);
 	Pltoken t;
 
 expand_get:
@@ -587,6 +596,8 @@ Pdtoken::process_endif()
 static bool
 can_open(const string& s)
 {
+	if (!DirCache::may_exist(s))
+		return (false);
 	ifstream in;
 	in.open(s.c_str());
 	if (!in.fail()) {
@@ -596,6 +607,239 @@ can_open(const string& s)
 		return (false);
 }
 
+// Return true if c can appear in an identifier
+static inline bool
+is_idchar(char c)
+{
+	return isalnum((unsigned char)c) || c == '_' || c == '$';
+}
+
+// Skip spaces and tabs starting at p
+static inline const char *
+skip_blanks(const char *p, const char *e)
+{
+	while (p < e && (*p == ' ' || *p == '\t'))
+		p++;
+	return p;
+}
+
+/*
+ * Return the position after the end of the block comment whose body
+ * starts at p, or NULL if the comment is not terminated
+ */
+static inline const char *
+comment_end(const char *p, const char *e)
+{
+	static const char close[] = "*/";
+	const char *end = search(p, e, close, close + 2);
+	return end == e ? NULL : end + 2;
+}
+
+// Return true if only blanks and comments remain on the line starting at p
+static bool
+rest_is_blank(const char *p, const char *e)
+{
+	for (;;) {
+		p = skip_blanks(p, e);
+		if (p == e || *p == '\n' || *p == '\r')
+			return true;
+		if (*p != '/' || p + 1 == e)
+			return false;
+		if (p[1] == '/')
+			return true;
+		if (p[1] != '*' || (p = comment_end(p + 2, e)) == NULL)
+			return false;
+	}
+}
+
+// Return the identifier starting at p, advancing p past it
+static string
+get_identifier(const char *&p, const char *e)
+{
+	const char *start = p;
+	while (p < e && is_idchar(*p))
+		p++;
+	return string(start, p);
+}
+
+/*
+ * Return the name of the macro guarding the contents of the file
+ * image [b, e) against multiple inclusion, setting offs to the name's
+ * offset, or an empty string if the file is not guarded.
+ * A guarded file contains, apart from white space and comments,
+ * only a #ifndef NAME or #if !defined(NAME) block that lacks
+ * a top-level #else or #elif.
+ * Unusual constructs make the file count as unguarded, which
+ * just means that it will be read again.
+ */
+static string
+find_include_guard(const char *b, const char *e, cs_offset_t &offs)
+{
+	string guard;
+	int depth = 0;		// Conditional nesting level
+	bool closed = false;	// True after the guard's #endif
+	bool bol = true;	// At the beginning of a line
+
+	for (const char *p = b; p < e;) {
+		switch (*p) {
+		case '\n':
+			bol = true;
+			p++;
+			continue;
+		case ' ': case '\t': case '\r': case '\f': case '\v':
+			p++;
+			continue;
+		case '\\':
+			if (p + 1 < e && p[1] == '\n') {
+				p += 2;
+				continue;
+			}
+			if (p + 2 < e && p[1] == '\r' && p[2] == '\n') {
+				p += 3;
+				continue;
+			}
+			break;
+		case '/':
+			if (p + 1 < e && p[1] == '*') {
+				if ((p = comment_end(p + 2, e)) == NULL)
+					return "";
+				continue;
+			}
+			if (p + 1 < e && p[1] == '/') {
+				while (p < e && *p != '\n')
+					p++;
+				continue;
+			}
+			break;
+		case '#':
+			if (!bol)
+				break;
+			{
+				if (closed)
+					return "";
+				p = skip_blanks(p + 1, e);
+				string directive(get_identifier(p, e));
+				if (guard.empty()) {
+					bool paren = false;
+					p = skip_blanks(p, e);
+					if (directive == "if") {
+						if (p == e || *p != '!')
+							return "";
+						p = skip_blanks(p + 1, e);
+						if (get_identifier(p, e) != "defined")
+							return "";
+						p = skip_blanks(p, e);
+						if (p < e && *p == '(') {
+							paren = true;
+							p = skip_blanks(p + 1, e);
+						}
+					} else if (directive != "ifndef")
+						return "";
+					offs = p - b;
+					guard = get_identifier(p, e);
+					if (guard.empty() || isdigit((unsigned char)guard[0]))
+						return "";
+					if (paren) {
+						p = skip_blanks(p, e);
+						if (p == e || *p != ')')
+							return "";
+						p++;
+					}
+					// Reject e.g. #if !defined(X) || Y
+					if (!rest_is_blank(p, e))
+						return "";
+					depth = 1;
+				} else if (directive == "if" || directive == "ifdef" || directive == "ifndef")
+					depth++;
+				else if (directive == "endif") {
+					if (--depth == 0)
+						closed = true;
+				} else if (depth == 1 && (directive == "else" || directive == "elif"))
+					return "";
+				else if (directive == "include" || directive == "include_next") {
+					// Header names are not tokenized like the rest
+					while (p < e && *p != '\n')
+						p++;
+				}
+				bol = false;
+				continue;
+			}
+		case '"':
+		case '\'':
+			if (guard.empty() || closed)
+				return "";
+			// Skip the literal; an unterminated one ends at the line's end
+			for (const char *q = p++; p < e && *p != *q && *p != '\n'; p++)
+				if (*p == '\\' && p + 1 < e)
+					p++;
+			if (p < e && *p != '\n')
+				p++;
+			bol = false;
+			continue;
+		}
+		// Any other token must be part of the guarded contents
+		if (guard.empty() || closed)
+			return "";
+		bol = false;
+		p++;
+	}
+	return closed ? guard : "";
+}
+
+/*
+ * Read the included file fname, found at the specified offset of
+ * the include path (or -1 if it was found elsewhere).
+ * If the file has been read before, and its contents are guarded
+ * against multiple inclusion by a defined macro or #pragma once,
+ * do not read it again: all its lines would be skipped.  Only
+ * record the inclusion and the guard's use.
+ */
+void
+Pdtoken::include_file(const string &fname, int ipath_offset)
+{
+	if (UnitCache::include(fname, ipath_offset))
+		return;
+
+	Fileid f(fname);
+
+	if (ipath_offset >= 0)
+		f.set_ipath_offset(ipath_offset);
+	if (!f.include_guard_scanned()) {
+		// Look for a guard the first time we see the file
+		const MappedFile *m = MappedFile::get(fname);
+		cs_offset_t offs = 0;
+		string guard;
+		if (m)
+			guard = find_include_guard(m->begin(), m->end(), offs);
+		if (DP() && !guard.empty())
+			cout << fname << " is guarded by " << guard << "\n";
+		f.set_include_guard(guard, offs);
+		Fchar::push_input(fname);
+		return;
+	}
+
+	const string &guard = f.get_include_guard();
+	bool once = (once_files.find(f) != once_files.end());
+	mapMacro::const_iterator mi = macros.end();
+	if (!once && !guard.empty() && !reread_guarded)
+		mi = macros.find(guard);
+	if (!once && !macro_is_defined(mi)) {
+		Fchar::push_input(fname);
+		return;
+	}
+	if (DP())
+		cout << "Skipping guarded include " << fname << "\n";
+	// Bookkeeping otherwise performed by reading the file
+	Fchar::skip_input(fname);
+	Fdep::add_include(Fchar::get_fileid(), f, Fchar::get_line_num() - 1);
+	f.set_attribute(Project::get_current_projid());
+	UnitCache::touch(f);
+	if (!once)
+		// The guard's #ifndef refers to the macro
+		Token::unify(mi->second.get_name_token(),
+		    Token(IDENTIFIER, guard, Tokid(f, f.get_include_guard_offset())));
+}
+
 /*
  * When next is true we start scanning the include path from the directory
  * following the one in which the current file was found (gcc extension).
@@ -670,7 +914,7 @@ Pdtoken::process_include(bool next)
 	// #include <foo.h> and #include "foo.h"
 	if (is_absolute_filename(f.get_val())) {
 		if (can_open(f.get_val())) {
-			Fchar::push_input(f.get_val());
+			include_file(f.get_val(), -1);
 			return;
 		}
 	} else {
@@ -689,7 +933,7 @@ Pdtoken::process_include(bool next)
 		if (f.get_code() == ABSFNAME && !next) {
 			string fname(Fchar::get_dir() + "/" + f.get_val());
 			if (can_open(fname)) {
-				Fchar::push_input(fname);
+				include_file(fname, -1);
 				return;
 			}
 		}
@@ -701,8 +945,7 @@ Pdtoken::process_include(bool next)
 			string fname(*i + "/" + f.get_val());
 			if (DP()) cout << "Try open " << fname << "\n";
 			if (can_open(fname)) {
-				Fchar::push_input(fname);
-				Fchar::get_fileid().set_ipath_offset(i - include_path.begin());
+				include_file(fname, i - include_path.begin());
 				return;
 			}
 		}
@@ -950,6 +1193,13 @@ Pdtoken::process_error(enum e_error_level e)
 		Error::error(e, msg);
 }
 
+// Do not process the compilation unit f (its results are available)
+void
+Pdtoken::skip_unit(Fileid f)
+{
+	skipped_units.insert(get_uniq_fname_string(f.get_path().c_str()));
+}
+
 void
 Pdtoken::process_pragma()
 {
@@ -966,6 +1216,12 @@ Pdtoken::process_pragma()
 		eat_to_eol();
 		return;
 	}
+	// Pragmas that don't depend on the macros of a replayed unit
+	if (t.get_val() != "echo" && t.get_val() != "includepath" &&
+	    t.get_val() != "clear_include" && t.get_val() != "clear_defines" &&
+	    t.get_val() != "pushd" && t.get_val() != "popd" &&
+	    t.get_val() != "block_enter" && t.get_val() != "block_exit")
+		UnitCache::establish_macros();
 	if (t.get_val() == "sync") {
 		t.getnext_nospc<Fchar>();
 		if (t.get_code() != STRING_LITERAL) {
@@ -1030,6 +1286,8 @@ Pdtoken::process_pragma()
 			eat_to_eol();
 			return;
 		}
+		if (!Parallel::own_project())
+			return;
 		string s = t.get_val();
 		for (string::const_iterator i = s.begin(); i != s.end();)
 			cerr << unescape_char(s, i);
@@ -1048,6 +1306,7 @@ Pdtoken::process_pragma()
 			return;
 		}
 		Project::set_current_project(t.get_val());
+		Parallel::new_project();
 	} else if (t.get_val() == "readonly") {
 		t.getnext_nospc<Fchar>();
 		if (t.get_code() != STRING_LITERAL) {
@@ -1081,11 +1340,33 @@ Pdtoken::process_pragma()
 			eat_to_eol();
 			return;
 		}
+		/*
+		 * Decide before creating the unit's Fileid, which hashes
+		 * and registers the file, whether it is processed at all.
+		 */
+		if (!Parallel::own_project() ||
+		    skipped_units.find(get_uniq_fname_string(t.get_val().c_str())) != skipped_units.end()) {
+			/*
+			 * Dependencies gathered since the last unit belong to
+			 * the skipped one; don't attribute them to the next.
+			 */
+			Fdep::reset();
+			return;
+		}
+		Fileid unit(t.get_val());
+		if (UnitCache::replay(t.get_val(), unit)) {
+			garbage_collect(unit);
+			return;
+		}
 		Fchar::push_input(t.get_val());
 		Fchar::lock_stack();
-		if (parse_parse() != 0)
-			exit(1);
-		garbage_collect(Fileid(t.get_val()));
+		{
+			PhaseTimer timer(Profile::ph_parse);
+			if (parse_parse() != 0)
+				exit(1);
+		}
+		UnitCache::end_unit();
+		garbage_collect(unit);
 		Fchar::unlock_stack();
 	} else if (t.get_val() == "pushd") {
 		char buff[4096];
@@ -1115,6 +1396,7 @@ Pdtoken::process_pragma()
 		}
 		if (chdir(t.get_val().c_str()) != 0)
 			Error::error(E_FATAL, "chdir " + t.get_val() + ": " + string(strerror(errno)));
+		DirCache::directory_changed();
 	} else if (t.get_val() == "popd") {
 		if (dirstack.empty()) {
 			/*
@@ -1132,11 +1414,14 @@ Pdtoken::process_pragma()
 			cout << "popd to " << dirstack.top().c_str() << endl;
 		if (chdir(dirstack.top().c_str()) != 0)
 			Error::error(E_FATAL, "popd: " + dirstack.top() + ": " + string(strerror(errno)));
+		DirCache::directory_changed();
 		dirstack.pop();
 	} else if (t.get_val() == "clear_include")
 		Pdtoken::clear_include();
-	else if (t.get_val() == "clear_defines")
+	else if (t.get_val() == "clear_defines") {
+		UnitCache::clear_macros();
 		Pdtoken::macros_clear();
+	}
 	else if (t.get_val() == "ro_prefix") {
 		t.getnext_nospc<Fchar>();
 		if (t.get_code() != STRING_LITERAL) {
@@ -1152,10 +1437,15 @@ Pdtoken::process_pragma()
 			return;
 		}
 		Fileid::add_ro_prefix(t.get_val());
-	} else if (t.get_val() == "block_enter")
+	} else if (t.get_val() == "once")
+		once_files.insert(Fchar::get_fileid());
+	else if (t.get_val() == "block_enter") {
+		UnitCache::enter_block();
 		Block::enter();
-	else if (t.get_val() == "block_exit")
+	} else if (t.get_val() == "block_exit") {
+		UnitCache::exit_block();
 		Block::exit();
+	}
 	eat_to_eol();
 }
 
@@ -1180,6 +1470,8 @@ Pdtoken::process_directive()
 		eat_to_eol();
 		return;
 	}
+	if (t.get_val() != "pragma")
+		UnitCache::establish_macros();
 	if (t.get_val() == "define")
 		process_define();
 	else if (t.get_val() == "include_next") // GCC extension
@@ -56,6 +56,9 @@ class Macro;
 typedef map<string, Macro> mapMacro;
 
 class Pdtoken: public Ptoken {
+	friend class Snapshot;
+	friend class UnitCache;
+	friend class MemStat;
 private:
 	static mapMacro macros;			// Defined macros
 	static mapMacroBody macro_body_tokens;	// Tokens and the macros they belong to
@@ -65,12 +68,17 @@ private:
 	static stackbool iftaken;		// Taken #ifs
 	static int skiplevel;			// Level of enclosing #ifs
 	static bool output_defines;		// Output #defines on stdout
+	static bool reread_guarded;		// Read again guarded includes
 
 	static vectorstring include_path;	// Include file path
+	static set <string> skipped_units;	// Unique names of units #pragma process skips
+	static set <Fileid> once_files;		// Files with #pragma once read
 
 	static void process_directive();	// Handle a cpp directive
 	static void eat_to_eol();		// Consume input including \n
 	static void process_include(bool next);	// Handle a #include
+	// Read an included file, unless its contents would be skipped
+	static void include_file(const string &fname, int ipath_offset);
 	static void process_define();		// Handle a #define
 	static void process_undef();		// Handle a #undef
 	static void process_if();		// Handle #if
@@ -101,6 +109,7 @@ public:
 	static void macros_clear() {
 		macros.clear();
 		macro_body_tokens.clear();
+		once_files.clear();
 	}
 
 	// Return the number of defined macros
@@ -130,6 +139,10 @@ public:
 	static bool skipping() { return skiplevel != 0; }
 	// Call this to output the #define code on stdout
 	static void set_output_defines() { output_defines = true; }
+	// Call this to read again files guarded by an include guard macro
+	static void set_reread_guarded() { reread_guarded = true; }
+	// Do not process the compilation unit f (its results are available)
+	static void skip_unit(Fileid f);
 };
 
 ostream& operator<<(ostream& o,const dequePtoken &dp);
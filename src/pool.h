@@ -0,0 +1,97 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * A pool allocator for objects of a single size.
+ * Objects are carved out of large slabs, and freed objects are
+ * kept in a free list for reuse; slabs are never returned.
+ * This avoids the time and space overhead the general-purpose
+ * allocator has for the millions of small objects we create and
+ * destroy while processing.
+ * The pool is not thread-safe.
+ *
+ */
+
+#ifndef POOL_
+#define POOL_
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+class Pool {
+private:
+	// A free object; it holds the next one
+	struct Free {
+		Free *next;
+	};
+	enum {slab_objects = 4096};	// Objects allocated at once
+	size_t object_size;		// Size of each object
+	Free *free_list;		// Objects available for reuse
+	char *slab;			// Unused part of the current slab
+	char *slab_end;			// End of the current slab
+	vector <char *> slabs;		// All allocated slabs
+
+	// Allocation statistics
+	unsigned long nallocated;	// Objects allocated
+	unsigned long nlive;		// Objects currently in use
+	unsigned long npeak;		// Maximum objects in use
+public:
+	Pool(size_t s) :
+		object_size(s < sizeof(Free) ? sizeof(Free) :
+		    // Keep objects aligned as the general allocator would
+		    (s + sizeof(void *) - 1) / sizeof(void *) * sizeof(void *)),
+		free_list(NULL), slab(NULL), slab_end(NULL),
+		nallocated(0), nlive(0), npeak(0) {}
+	// Return storage for an object
+	void *allocate() {
+		nallocated++;
+		if (++nlive > npeak)
+			npeak = nlive;
+		if (free_list) {
+			Free *f = free_list;
+			free_list = f->next;
+			return f;
+		}
+		if (slab == slab_end) {
+			slab = new char[object_size * slab_objects];
+			slab_end = slab + object_size * slab_objects;
+			slabs.push_back(slab);
+		}
+		void *r = slab;
+		slab += object_size;
+		return r;
+	}
+	// Make the storage of an object available for reuse
+	void release(void *p) {
+		if (p == NULL)
+			return;
+		nlive--;
+		Free *f = static_cast<Free *>(p);
+		f->next = free_list;
+		free_list = f;
+	}
+	unsigned long get_allocated() const { return nallocated; }
+	unsigned long get_live() const { return nlive; }
+	unsigned long get_peak() const { return npeak; }
+	// Bytes reserved from the system
+	size_t get_reserved() const { return slabs.size() * object_size * slab_objects; }
+};
+
+#endif /* POOL_ */
@@ -0,0 +1,140 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * For documentation read the corresponding .h file
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "profile.h"
+
+bool Profile::timing;
+Profile::e_phase Profile::current = Profile::ph_other;
+Profile::clock::time_point Profile::last;
+Profile::clock::duration Profile::elapsed[ph_max];
+unsigned long Profile::counter[pc_max];
+
+const char * const Profile::phase_name[ph_max] = {
+	"other",
+	"preprocess",
+	"macro_expand",
+	"lex",
+	"parse",
+	"unify",
+	"gc",
+	"postprocess",
+	"metrics",
+	"xfile",
+};
+
+const char * const Profile::counter_name[pc_max] = {
+	"tokids",
+	"eclasses",
+	"merges",
+	"splits",
+	"macro_expansions",
+	"include_opens",
+};
+
+void
+Profile::start()
+{
+	current = ph_other;
+	last = clock::now();
+	timing = true;
+}
+
+void
+Profile::stop()
+{
+	if (!timing)
+		return;
+	charge();
+	timing = false;
+}
+
+double
+Profile::ms(e_phase p)
+{
+	return chrono::duration<double, milli>(elapsed[p]).count();
+}
+
+void
+Profile::html(ostream &o)
+{
+	double total = 0;
+	for (int i = 0; i < ph_max; i++)
+		total += ms((e_phase)i);
+
+	o << fixed << setprecision(1);
+	o << "<h2>Processing Phases</h2>\n"
+		"<table class='metrics'>"
+		"<tr><th>" "Phase" "</th>"
+		"<th>" "Time (ms)" "</th>"
+		"<th>" "%" "</th></tr>\n";
+	for (int i = 0; i < ph_max; i++)
+		o << "<tr><td>" << phase_name[i] << "</td>"
+			"<td>" << ms((e_phase)i) << "</td>"
+			"<td>" << (total ? ms((e_phase)i) * 100 / total : 0.) << "</td></tr>\n";
+	o << "<tr><td>" "total" "</td>"
+		"<td>" << total << "</td>"
+		"<td></td></tr>\n";
+	o << "</table>\n";
+
+	o << "<h2>Events</h2>\n"
+		"<table class='metrics'>"
+		"<tr><th>" "Event" "</th>"
+		"<th>" "Count" "</th></tr>\n";
+	for (int i = 0; i < pc_max; i++)
+		o << "<tr><td>" << counter_name[i] << "</td>"
+			"<td>" << counter[i] << "</td></tr>\n";
+	o << "</table>\n";
+}
+
+long
+Profile::peak_rss_kb()
+{
+	struct rusage u;
+
+	getrusage(RUSAGE_SELF, &u);
+#ifdef __APPLE__
+	return u.ru_maxrss / 1024;	// Reported in bytes
+#else
+	return u.ru_maxrss;
+#endif
+}
+
+void
+Profile::json(ostream &o)
+{
+	o << fixed << setprecision(3);
+	o << "{\n\t\"phases_ms\": {";
+	for (int i = 0; i < ph_max; i++)
+		o << (i ? "," : "") << "\n\t\t\"" << phase_name[i] << "\": " << ms((e_phase)i);
+	o << "\n\t},\n\t\"counters\": {";
+	for (int i = 0; i < pc_max; i++)
+		o << (i ? "," : "") << "\n\t\t\"" << counter_name[i] << "\": " << counter[i];
+	o << "\n\t},\n\t\"peak_rss_kb\": " << peak_rss_kb() << "\n}\n";
+}
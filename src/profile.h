@@ -0,0 +1,122 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Profiling of CScout's processing.
+ * The execution time of each processing phase is measured through
+ * PhaseTimer objects declared in the code implementing the phase.
+ * Phases nest: the time spent in a phase entered from another one
+ * is only attributed to the inner phase.
+ * Timing is only performed on the main thread, between calls to
+ * start() and stop().
+ * Events are counted through Profile::count().
+ *
+ */
+
+#ifndef PROFILE_
+#define PROFILE_
+
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+class Profile {
+public:
+	// Processing phases
+	enum e_phase {
+		ph_other,		// Workspace processing not covered below
+		ph_preprocess,		// Preprocessing, including lexing (Pdtoken::getnext)
+		ph_macro_expand,	// Macro expansion (macro_expand)
+		ph_lex,			// C token classification (parse_lex)
+		ph_parse,		// Parsing and semantic analysis
+		ph_unify,		// Token unification (Token::unify)
+		ph_gc,			// Garbage collection after each unit
+		ph_postprocess,		// Post-processing of files (file_analyze)
+		ph_metrics,		// Summarizing file and function metrics
+		ph_xfile,		// Identifier xfile and metrics computation
+		ph_max
+	};
+	// Counted events
+	enum e_counter {
+		pc_tokid,		// Tokids added to equivalence classes
+		pc_eclass,		// Equivalence classes created
+		pc_merge,		// Equivalence class merges
+		pc_split,		// Equivalence class splits
+		pc_macro_expand,	// Macro expansions
+		pc_include,		// Files opened for inclusion or processing
+		pc_max
+	};
+private:
+	typedef chrono::steady_clock clock;
+	static bool timing;			// True while timing
+	static e_phase current;			// Phase being timed
+	static clock::time_point last;		// Time current was last charged
+	static clock::duration elapsed[ph_max];	// Time spent in each phase
+	static unsigned long counter[pc_max];	// Event counts
+	static const char * const phase_name[ph_max];
+	static const char * const counter_name[pc_max];
+
+	// Charge the time since last to the current phase
+	static void charge() {
+		clock::time_point now(clock::now());
+		elapsed[current] += now - last;
+		last = now;
+	}
+	// Return the time spent in phase p in ms
+	static double ms(e_phase p);
+public:
+	// Start and stop timing
+	static void start();
+	static void stop();
+	// Enter phase p, returning the phase to resume on leaving it
+	static e_phase enter(e_phase p) {
+		e_phase outer = current;
+		if (timing && p != current) {
+			charge();
+			current = p;
+		}
+		return outer;
+	}
+	// Leave the current phase, resuming outer
+	static void leave(e_phase outer) {
+		if (timing && outer != current) {
+			charge();
+			current = outer;
+		}
+	}
+	// Count an event of type c
+	static void count(e_counter c) { counter[c]++; }
+	// Return the process's peak resident set size in kB
+	static long peak_rss_kb();
+	// Report the results as HTML tables
+	static void html(ostream &o);
+	// Report the results as a JSON object
+	static void json(ostream &o);
+};
+
+// Attribute the execution time of a block to a processing phase
+class PhaseTimer {
+private:
+	Profile::e_phase outer;
+public:
+	PhaseTimer(Profile::e_phase p) : outer(Profile::enter(p)) {}
+	~PhaseTimer() { Profile::leave(outer); }
+};
+
+#endif /* PROFILE_ */
@@ -44,10 +44,7 @@ ostream&
 operator<<(ostream& o,const Ptoken &t)
 {
 	o << (Token)t;
-	o << "Value: [" << t.val << "] HS(";
-	for (HideSet::const_iterator i = t.hideset.begin(); i != t.hideset.end(); i++)
-		o << *i;
-	o << ')' << endl;
+	o << "Value: [" << t.val << "] HS(" << t.hideset << ')' << endl;
 	return (o);
 }
 
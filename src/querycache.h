@@ -0,0 +1,74 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * A least recently used cache of query results, keyed by a string
+ * that identifies the query and the settings affecting its results.
+ *
+ */
+
+#ifndef QUERYCACHE_
+#define QUERYCACHE_
+
+#include <string>
+#include <list>
+#include <map>
+#include <utility>
+
+using namespace std;
+
+template <class V>
+class QueryCache {
+private:
+	typedef list <pair <string, V> > entries_type;
+	entries_type entries;		// Most recently used first
+	map <string, typename entries_type::iterator> index;
+	typename entries_type::size_type max_entries;
+public:
+	QueryCache(typename entries_type::size_type n) : max_entries(n) {}
+	// Return the result cached for key k, or NULL
+	V *find(const string &k) {
+		typename map <string, typename entries_type::iterator>::iterator i = index.find(k);
+		if (i == index.end())
+			return NULL;
+		entries.splice(entries.begin(), entries, i->second);
+		return &entries.front().second;
+	}
+	// Return a new empty result for key k, evicting the least recently used
+	V &insert(const string &k) {
+		typename map <string, typename entries_type::iterator>::iterator i = index.find(k);
+		if (i != index.end()) {
+			entries.erase(i->second);
+			index.erase(i);
+		}
+		if (entries.size() >= max_entries) {
+			index.erase(entries.back().first);
+			entries.pop_back();
+		}
+		entries.push_front(make_pair(k, V()));
+		index[k] = entries.begin();
+		return entries.front().second;
+	}
+	// Remove all results
+	void clear() {
+		entries.clear();
+		index.clear();
+	}
+};
+
+#endif // QUERYCACHE_
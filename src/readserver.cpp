@@ -0,0 +1,149 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * For documentation read the corresponding .h file
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#if defined(unix) || defined(__unix__) || defined(__MACH__)
+#include <unistd.h>		// fork(2)
+#include <signal.h>		// killpg(2), sigprocmask(2)
+#include <sys/wait.h>		// waitpid(2)
+#define HAVE_FORK
+#endif
+
+#include "cpp.h"
+#include "error.h"
+#include "swill.h"
+#include "readserver.h"
+
+int ReadServer::port;
+int ReadServer::nworkers = 1;
+int ReadServer::group;
+bool ReadServer::reader;
+bool ReadServer::stale;
+void (*ReadServer::setup)();
+
+#ifdef HAVE_FORK
+/*
+ * SIGTERM handler of the first serving process.
+ * Terminate the other serving processes and wait for them, so that
+ * when the main process has waited for us, the port is no longer in use.
+ */
+static void
+terminate_pool(int)
+{
+	signal(SIGTERM, SIG_IGN);
+	// Also reach processes forked after the signal was sent
+	kill(0, SIGTERM);
+	while (wait(NULL) != -1 || errno == EINTR)
+		;
+	_exit(0);
+}
+
+void
+ReadServer::start(void (*s)())
+{
+	setup = s;
+	stale = false;
+	cout.flush();
+	fflush(NULL);
+	pid_t pid = fork();
+	if (pid == -1)
+		Error::error(E_FATAL, "fork: " + string(strerror(errno)), false);
+	if (pid > 0) {
+		// Also set here to avoid racing with a stop()
+		setpgid(pid, pid);
+		group = pid;
+		return;
+	}
+
+	// The first serving process
+	setpgid(0, 0);
+	group = 0;
+	reader = true;
+	// Only our copy of the main process's socket is closed
+	swill_close();
+	if (!swill_init(port)) {
+		cerr << "Unable to serve the read-only pages on port " << port << endl;
+		_exit(1);
+	}
+	setup();
+	sigset_t term, old;
+	sigemptyset(&term);
+	sigaddset(&term, SIGTERM);
+	sigprocmask(SIG_BLOCK, &term, &old);
+	signal(SIGTERM, terminate_pool);
+	for (int i = 1; i < nworkers; i++)
+		if (fork() == 0) {
+			signal(SIGTERM, SIG_DFL);
+			break;
+		}
+	sigprocmask(SIG_SETMASK, &old, NULL);
+	for (;;)
+		swill_serve();
+}
+
+void
+ReadServer::refresh()
+{
+	if (!stale || group == 0)
+		return;
+	stop();
+	start(setup);
+}
+
+void
+ReadServer::stop()
+{
+	if (group == 0)
+		return;
+	killpg(group, SIGTERM);
+	while (waitpid(group, NULL, 0) == -1 && errno == EINTR)
+		;
+	group = 0;
+}
+#else
+void
+ReadServer::start(void (*s)())
+{
+	/*
+	 * @error
+	 * Serving the read-only pages through separate processes
+	 * (the -w option) is not supported on this platform
+	 */
+	Error::error(E_FATAL, "concurrent serving of read-only pages is not supported on this platform", false);
+}
+
+void
+ReadServer::refresh()
+{
+}
+
+void
+ReadServer::stop()
+{
+}
+#endif
@@ -0,0 +1,61 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Concurrent serving of the read-only web pages.
+ * Swill serves one request at a time and keeps the request's state in
+ * global variables, while the query and graph code caches results in
+ * the workspace's structures, so pages cannot be served by threads.
+ * Instead, a pool of processes forked after the workspace's analysis
+ * accept requests on a separate port, each serving its requests from
+ * its copy-on-write view of the workspace.
+ * Pages that modify the workspace (identifier replacements, refactorings,
+ * options, file edits) are only served by the main process, one at a time.
+ * After such a modification the pool is replaced by a new one, forked
+ * from the modified workspace.
+ *
+ */
+
+#ifndef READSERVER_
+#define READSERVER_
+
+class ReadServer {
+private:
+	static int port;		// Port of the read-only pages; 0 if not served
+	static int nworkers;		// Processes serving the pages
+	static int group;		// Process group of the serving processes; 0 if none
+	static bool reader;		// True in the serving processes
+	static bool stale;		// True after the main process modified the workspace
+	static void (*setup)();		// Registers the pages with swill
+public:
+	// Serve the read-only pages on port p using n processes
+	static void set_port(int p, int n) { port = p; nworkers = (n > 1 ? n : 1); }
+	static bool is_enabled() { return port != 0; }
+	// Return true in the processes serving the read-only pages
+	static bool is_reader() { return reader; }
+	// Start the serving processes; they call s to register the pages
+	static void start(void (*s)());
+	// Note that the workspace was modified
+	static void invalidate() { stale = true; }
+	// Restart the serving processes, if the workspace was modified
+	static void refresh();
+	// Terminate the serving processes
+	static void stop();
+};
+
+#endif /* READSERVER_ */
@@ -0,0 +1,119 @@
+#!/usr/bin/env bash
+#
+# (C) Copyright 2016 Diomidis Spinellis
+#
+# This file is part of CScout.
+#
+# CScout is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# CScout is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+#
+#
+# Benchmark CScout on a synthetic workspace and on the awk example.
+# The results are written on the standard output as tab-separated
+# lines, one for each workspace and processing mode, so that the
+# output of different builds can be compared with diff(1) or
+# processed further.
+#
+# The synthetic workspace is generated by mkbench.pl; the following
+# options are passed to it to specify its size.
+# -d depth	Depth of the header file include chain
+# -f files	Number of C files
+# -i ids	Functions and variables defined in each file
+# -m macros	Macros defined in each header and file
+# -x xrefs	References from each file to functions of other files
+#
+# Other options:
+# -n runs	Run each benchmark the specified number of times and
+#		report the fastest run (default 1)
+# -p port	Port used by the CScout runs that start the web server
+#
+
+CSCOUT_SRC=$(cd $(dirname $0) && pwd)
+CSCOUT=$CSCOUT_SRC/build/cscout
+RUNS=1
+MKBENCH_FLAGS=
+
+while getopts "d:f:i:m:x:n:p:" opt
+do
+	case $opt in
+	d|f|i|m|x)
+		MKBENCH_FLAGS="$MKBENCH_FLAGS -$opt $OPTARG"
+		;;
+	n)
+		RUNS=$OPTARG
+		;;
+	p)
+		PORT="-p $OPTARG"
+		;;
+	*)
+		echo "usage: $0 [-d depth] [-f files] [-i ids] [-m macros] [-x xrefs] [-n runs] [-p port]" 1>&2
+		exit 1
+		;;
+	esac
+done
+
+if ! [ -x "$CSCOUT" ] ; then
+	echo "Unable to find $CSCOUT; run make first." 1>&2
+	exit 1
+fi
+
+BENCH_DIR=$(mktemp -d)
+trap 'rm -rf "$BENCH_DIR"' 0
+
+# Obtain a counter or resource value from the profile JSON output in $1
+profile_value()
+{
+	sed -n "s/^[	 ]*\"$2\": \([0-9]*\).*/\1/p" "$1" | tail -1
+}
+
+# Benchmark a workspace (arguments name, directory, workspace file)
+# in all processing modes
+bench()
+{
+	for mode in -c -r '-s mysql'
+	do
+		best=
+		for run in $(seq $RUNS)
+		do
+			wall=$(
+				cd "$2" &&
+				TIMEFORMAT=%R &&
+				{ time $CSCOUT $PORT -t $mode "$3" >/dev/null 2>"$BENCH_DIR/err" ; } 2>&1
+			)
+			if [ $? != 0 ] ; then
+				echo "$1: cscout $mode failed" 1>&2
+				tail "$BENCH_DIR/err" 1>&2
+				continue 2
+			fi
+			if [ -z "$best" ] || awk "BEGIN {exit !($wall < $best)}" ; then
+				best=$wall
+				cp "$BENCH_DIR/err" "$BENCH_DIR/best"
+			fi
+		done
+		tokids=$(profile_value "$BENCH_DIR/best" tokids)
+		printf '%s\t%s\t%s\t%s\t%s\t%s\t%s\n' \
+			"$1" "$(echo $mode | sed 's/ /:/')" $best \
+			$(profile_value "$BENCH_DIR/best" peak_rss_kb) \
+			$tokids \
+			$(awk "BEGIN {print $best ? int($tokids / $best) : 0}") \
+			$(profile_value "$BENCH_DIR/best" eclasses)
+	done
+}
+
+perl $CSCOUT_SRC/mkbench.pl $MKBENCH_FLAGS "$BENCH_DIR/synth" || exit 1
+
+echo "# $($CSCOUT -v | head -1)"
+echo "# mkbench.pl$MKBENCH_FLAGS"
+printf 'workspace\tmode\twall_s\tpeak_rss_kb\ttokids\ttokids_per_s\teclasses\n'
+bench synthetic "$BENCH_DIR/synth" bench.cs
+bench awk "$CSCOUT_SRC/../example" awk.cs
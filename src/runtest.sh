@@ -25,6 +25,13 @@
 # -TEST_CPP
 # -TEST_C
 # -TEST_OBFUSCATION
+# -TEST_IMAGE
+# -TEST_PARALLEL
+# -TEST_UNITCACHE
+# -TEST_BULK
+# -TEST_SQLITE
+# -TEST_GUARD
+# -TEST_UNIT
 #
 # To run a single test set the corresponding environment variable e.g.
 # CFILES=c36-endlabel.c ./runtest.sh -TEST_C
@@ -94,6 +101,13 @@ end_compare()
 	fi
 }
 
+# Skip a test (arguments name, reason)
+skip_test()
+{
+	NTEST=`expr $NTEST + 1`
+	echo "ok $NTEST - $TEST_GROUP $1 # SKIP $2"
+}
+
 # End a test (arguments result, name)
 end_test()
 {
@@ -114,19 +128,54 @@ end_test()
 	fi
 }
 
-# Test the analysis of a C project
-# runtest name directory csfile
-runtest_c()
+# Analyze a workspace in the specified way, writing its SQL dump
+# run_cscout run cscout csfile
+# where run is one of
+# serial:	process the workspace
+# image:	save a workspace image and dump the restored image
+# parallel:	process the workspace with two worker processes
+# unitcache:	process the workspace replaying repeated units (-u)
+# values:	load the tables through multi-row INSERT statements (-B values)
+# reread:	read again the headers guarded against multiple inclusion (-G)
+run_cscout()
+{
+	case $1 in
+	image)
+		$2 -c -S cscout.img $3 >/dev/null &&
+		$2 -L cscout.img -s hsqldb
+		rm -f cscout.img
+		;;
+	parallel)
+		$2 -P 2 -s hsqldb $3
+		;;
+	unitcache)
+		$2 -u -s hsqldb $3
+		;;
+	values)
+		$2 -s hsqldb -B values $3
+		;;
+	reread)
+		$2 -G -s hsqldb $3
+		;;
+	*)
+		$2 -s hsqldb $3
+		;;
+	esac
+}
+
+# Output the normalized contents of the tables of a C project's analysis
+# sqldump_c name directory srcpath csfile run
+sqldump_c()
 {
 	NAME=$1
 	DIR=$2
 	SRCPATH=$3
 	CSFILE=$4
-	start_test $DIR $NAME
+	RUN=$5
 	mkdir -p test/err/chunk
 (
 echo '\p Loading database'
-(cd $DIR ; $SRCPATH/$CSCOUT -s hsqldb $CSFILE) 2>test/err/chunk/$NAME.cs
+(cd $DIR ; run_cscout $RUN $SRCPATH/$CSCOUT $CSFILE) 2>test/err/chunk/$NAME.$RUN.cs
 cat <<\EOF
 \p Fixing EIDs
 
@@ -228,10 +277,179 @@ SELECT * from Fcalls ORDER BY SourceID, DESTID;
 EOF
 ) |
 $HSQLDB mem - |
-sed -e '1,/^Running selections/d' >test/nout/$NAME
+sed -e '1,/^Running selections/d'
+}
+
+# Test the analysis of a C project
+# runtest name directory srcpath csfile
+runtest_c()
+{
+	NAME=$1
+	DIR=$2
+	start_test $DIR $NAME
+	sqldump_c $NAME $DIR $3 $4 serial >test/nout/$NAME
 	end_compare $DIR $NAME
 }
 
+# Test the analysis of a C project performed in another way
+# against the specified expected output
+# runtest_c_run name directory srcpath csfile run expected
+runtest_c_run()
+{
+	NAME=$1
+	DIR=$2
+	RUN=$5
+	EXPECTED=$6
+	start_test $DIR "$NAME $RUN"
+	mkdir -p test/vout test/err/diff
+	sqldump_c $NAME $DIR $3 $4 $RUN >test/vout/$NAME.$RUN
+	if [ "$PRIME" = 1 ]
+	then
+		return 0
+	fi
+	if diff -ib $EXPECTED test/vout/$NAME.$RUN >test/err/diff/$NAME.$RUN
+	then
+		end_test $NAME.$RUN 1
+	else
+		end_test $NAME.$RUN 0
+		show_error test/err/diff/$NAME.$RUN
+	fi
+}
+
+# Output the normalized contents of all the tables of a C project's
+# analysis, loaded into an SQLite database through the specified method
+# sqlitedump_c name directory srcpath csfile method
+# where method is one of
+# insert, values, copy:	load the PostgreSQL dump made with -B method
+# csv:		load the PostgreSQL dump made with -B csv:dir
+# direct:	write the database with -s sqlite:file
+sqlitedump_c()
+{
+	NAME=$1
+	DIR=$2
+	SRCPATH=$3
+	CSFILE=$4
+	METHOD=$5
+	DB=$(pwd)/test/sqlite/$NAME.$METHOD.db
+	CSV=$(pwd)/test/sqlite/$NAME.csv
+	mkdir -p test/sqlite test/err/chunk
+	rm -rf $DB $CSV
+	case $METHOD in
+	direct)
+		(cd $DIR ; $SRCPATH/$CSCOUT -s sqlite:$DB $CSFILE) \
+			2>test/err/chunk/$NAME.$METHOD.cs
+		;;
+	csv)
+		mkdir -p $CSV
+		(cd $DIR ; $SRCPATH/$CSCOUT -s postgres -B csv:$CSV $CSFILE) \
+			2>test/err/chunk/$NAME.$METHOD.cs |
+		perl -pe 's/^\\copy (\w+) FROM \x27(.*)\x27 WITH \(FORMAT csv\)$/.import --csv $2 $1/' |
+		sqlite3 $DB 2>test/err/chunk/$NAME.$METHOD.sql
+		;;
+	copy)
+		# Convert the COPY data blocks into INSERT statements
+		# (carriage returns become expressions, because the sqlite3
+		# shell drops them from its input lines)
+		(cd $DIR ; $SRCPATH/$CSCOUT -s postgres -B copy $CSFILE) \
+			2>test/err/chunk/$NAME.$METHOD.cs |
+		perl -ne '
+			if (/^COPY (\w+) FROM STDIN;$/) { $table = $1; next; }
+			if (!defined($table)) { print; next; }
+			if (/^\\\.$/) { undef $table; next; }
+			chomp;
+			@v = split(/\t/, $_, -1);
+			for (@v) {
+				s/\\(.)/$1 eq "t" ? "\t" : $1 eq "n" ? "\n" : $1 eq "r" ? "\r" : $1/ge;
+				s/\x27/\x27\x27/g;
+				$_ = "\x27$_\x27";
+			}
+			print "INSERT INTO $table VALUES(", join(",", @v), ");\n";
+		' |
+		perl -pe 's/\r/\x27||char(13)||\x27/g' |
+		sqlite3 $DB 2>test/err/chunk/$NAME.$METHOD.sql
+		;;
+	*)
+		(cd $DIR ; $SRCPATH/$CSCOUT -s postgres -B $METHOD $CSFILE) \
+			2>test/err/chunk/$NAME.$METHOD.cs |
+		perl -pe 's/\r/\x27||char(13)||\x27/g' |
+		sqlite3 $DB 2>test/err/chunk/$NAME.$METHOD.sql
+		;;
+	esac
+	# Booleans are loaded either as true/false text or as integers
+	sqlite3 $DB "SELECT 'UPDATE ' || m.name || ' SET ' || p.name || '=CASE ' ||
+		p.name || ' WHEN ''true'' THEN 1 WHEN ''false'' THEN 0 ELSE ' ||
+		p.name || ' END;'
+		FROM sqlite_master AS m, pragma_table_info(m.name) AS p
+		WHERE m.type = 'table' AND p.type = 'BOOLEAN'" |
+	sqlite3 $DB
+	# SQL text carries the default six significant digits of real numbers
+	sqlite3 $DB "SELECT 'UPDATE ' || m.name || ' SET ' || p.name ||
+		'=CAST(printf(''%.6g'', ' || p.name || ') AS REAL);'
+		FROM sqlite_master AS m, pragma_table_info(m.name) AS p
+		WHERE m.type = 'table' AND p.type = 'REAL'" |
+	sqlite3 $DB
+	# Map EIDs and function ids into file offsets, as in sqldump_c
+	sqlite3 $DB <<\EOF
+CREATE TABLE FixedIds(EID BIGINT primary key, fixedid integer);
+INSERT INTO FixedIds
+SELECT Eid, Min(Fid + foffset * (select max(Fid) from files)) * 2 + 1
+FROM Tokens GROUP BY Eid;
+UPDATE Ids SET Eid=(SELECT FixedId FROM FixedIds WHERE FixedIds.Eid = Ids.Eid);
+UPDATE Tokens SET Eid=(SELECT FixedId FROM FixedIds WHERE FixedIds.Eid = Tokens.Eid);
+UPDATE IdProj SET Eid=(SELECT FixedId FROM FixedIds WHERE FixedIds.Eid = IdProj.Eid);
+UPDATE FunctionId SET Eid=(SELECT FixedId FROM FixedIds WHERE FixedIds.Eid = FunctionId.Eid);
+DROP TABLE FixedIds;
+CREATE TABLE FixedIds(FunId BIGINT primary key, FixedId integer);
+INSERT INTO FixedIds
+SELECT ID, (Fid + foffset * (select max(Fid) from files)) * 2 + 1
+FROM Functions;
+UPDATE Functions SET id=(SELECT FixedId FROM FixedIds WHERE FixedIds.FunId = Functions.id);
+UPDATE FunctionId SET FunctionId=(SELECT FixedId FROM FixedIds WHERE FixedIds.FunId = FunctionId.FunctionId);
+UPDATE FunctionMetrics SET FunctionId=(SELECT FixedId FROM FixedIds WHERE FixedIds.FunId = FunctionMetrics.FunctionId);
+UPDATE Fcalls SET
+SourceId=(SELECT FixedId FROM FixedIds WHERE FixedIds.FunId = Fcalls.sourceid),
+DestId=(SELECT FixedId FROM FixedIds WHERE FixedIds.FunId = Fcalls.DestId);
+DROP TABLE FixedIds;
+EOF
+	# Output every table ordered by all its columns
+	sqlite3 $DB "SELECT 'SELECT ''Table: ' || m.name || '''; SELECT * FROM ' ||
+		m.name || ' ORDER BY ' ||
+		(SELECT group_concat(p.name, ', ') FROM pragma_table_info(m.name) AS p) ||
+		';' FROM sqlite_master AS m WHERE m.type = 'table' ORDER BY m.name" |
+	sqlite3 $DB
+	rm -rf $DB $CSV
+}
+
+# Test the analysis of a C project loaded into SQLite through the
+# specified method against the specified expected output
+# runtest_sqlite name directory srcpath csfile method expected
+runtest_sqlite()
+{
+	NAME=$1
+	DIR=$2
+	METHOD=$5
+	EXPECTED=$6
+	start_test $DIR "$NAME sqlite $METHOD"
+	if [ -z "$SQLITE3" ]
+	then
+		skip_test "$TEST_NAME" "sqlite3 is not available"
+		return 0
+	fi
+	mkdir -p test/vout test/err/diff
+	sqlitedump_c $NAME $DIR $3 $4 $METHOD >test/vout/$NAME.sqlite.$METHOD
+	if [ "$PRIME" = 1 ]
+	then
+		return 0
+	fi
+	if diff $EXPECTED test/vout/$NAME.sqlite.$METHOD >test/err/diff/$NAME.sqlite.$METHOD
+	then
+		end_test $NAME.sqlite.$METHOD 1
+	else
+		end_test $NAME.sqlite.$METHOD 0
+		show_error test/err/diff/$NAME.sqlite.$METHOD
+	fi
+}
+
 # Test the correct dumping of a file's contents into the SQL tables
 # runtest name directory csfile
 runtest_chunk()
@@ -298,6 +516,38 @@ workspace TestWS {
 perl cswc.pl -d $DOTCSCOUT >makecs.cs 2>/dev/null
 }
 
+# Create a CScout analysis project file that processes the given
+# source code file in two projects with the same definitions,
+# and in a third one with different definitions
+makecs_u()
+{
+	if ! [ -d "$IPATH" ] ; then
+		echo "Bail out! Unable to access $IPATH directory."
+		echo "Working directory is: $(pwd)."
+		exit 1
+	fi
+
+	echo "
+workspace TestWS {
+	ipath \"$IPATH\"
+	directory test/c {
+	project Prj1 {
+		file $*
+	}
+	project Prj2 {
+		file $*
+	}
+	project Prj3 {
+		define PRJ2
+		file $*
+		file prj2.c
+	}
+	}
+}
+" |
+perl cswc.pl -d $DOTCSCOUT >makecs.cs 2>/dev/null
+}
+
 
 # Test the preprocessing of a C project
 # runtest name csfile directory
@@ -342,6 +592,13 @@ set_test()
 	TEST_CPP=$1
 	TEST_C=$1
 	TEST_OBFUSCATION=$1
+	TEST_IMAGE=$1
+	TEST_PARALLEL=$1
+	TEST_UNITCACHE=$1
+	TEST_BULK=$1
+	TEST_SQLITE=$1
+	TEST_GUARD=$1
+	TEST_UNIT=$1
 }
 
 #
@@ -383,6 +640,17 @@ IPATH=$CSCOUT_DIR/include/stdc
 CPPTESTS=$CSCOUT_DIR/src/test/cpp
 DOTCSCOUT=$CSCOUT_DIR/example/.cscout
 
+# The SQLite-based tests need the sqlite3 command-line shell
+if sqlite3 -version >/dev/null 2>&1
+then
+	SQLITE3=sqlite3
+fi
+# The direct SQLite output needs CScout built with SQLITE_DB
+if $CSCOUT -h 2>&1 | grep -q 'sqlite:file'
+then
+	SQLITE_DB=1
+fi
+
 chmod 444 ../include/stdc/* ../example/.cscout/*
 mkdir -p test/nout
 
@@ -447,6 +715,122 @@ then
 	runtest_c awk.c ../example ../src awk.cs
 fi
 
+# Analysis through a saved workspace image
+if [ $TEST_IMAGE = 1 ]
+then
+	TEST_GROUP=image
+	for i in ${CFILES:=$(cd test/c; echo *.c)}
+	do
+		makecs_c $i
+		runtest_c_run $i . . makecs.cs image test/out/$i
+	done
+	runtest_c_run awk.c ../example ../src awk.cs image test/out/awk.c
+fi
+
+# Parallel analysis; the results must equal those of the serial one
+if [ $TEST_PARALLEL = 1 ]
+then
+	TEST_GROUP=parallel
+	mkdir -p test/vout
+	for i in ${CFILES:=$(cd test/c; echo *.c)}
+	do
+		makecs_c $i
+		sqldump_c $i . . makecs.cs serial >test/vout/$i.serial
+		runtest_c_run $i . . makecs.cs parallel test/vout/$i.serial
+	done
+	sqldump_c awk.c ../example ../src awk.cs serial >test/vout/awk.c.serial
+	runtest_c_run awk.c ../example ../src awk.cs parallel test/vout/awk.c.serial
+fi
+
+# Replay of repeated units; the results must equal those of processing them
+if [ $TEST_UNITCACHE = 1 ]
+then
+	TEST_GROUP=unitcache
+	mkdir -p test/vout
+	for i in ${CFILES:=$(cd test/c; echo *.c)}
+	do
+		makecs_u $i
+		sqldump_c $i . . makecs.cs serial >test/vout/$i.serial
+		runtest_c_run $i . . makecs.cs unitcache test/vout/$i.serial
+	done
+fi
+
+# Headers not read again due to their include guard; the results must
+# equal those of reading them again
+if [ $TEST_GUARD = 1 ]
+then
+	TEST_GROUP=guard
+	mkdir -p test/vout
+	i=cpp71-include-guard.c
+	makecs_c ../cpp/$i
+	sqldump_c $i . . makecs.cs reread >test/vout/$i.reread
+	runtest_c_run $i . . makecs.cs serial test/vout/$i.reread
+fi
+
+# Bulk loading methods; the tables must equal those loaded through INSERT
+if [ $TEST_BULK = 1 ]
+then
+	TEST_GROUP=bulk
+	mkdir -p test/vout
+	for i in ${CFILES:=$(cd test/c; echo *.c)}
+	do
+		makecs_c $i
+		runtest_c_run $i . . makecs.cs values test/out/$i
+		if [ "$SQLITE3" ]
+		then
+			sqlitedump_c $i . . makecs.cs insert >test/vout/$i.sqlite.insert
+		fi
+		for m in values copy csv
+		do
+			runtest_sqlite $i . . makecs.cs $m test/vout/$i.sqlite.insert
+		done
+	done
+	runtest_c_run awk.c ../example ../src awk.cs values test/out/awk.c
+fi
+
+# Direct SQLite output; the tables must equal those loaded from SQL text
+if [ $TEST_SQLITE = 1 ]
+then
+	TEST_GROUP=sqlite
+	mkdir -p test/vout
+	for i in ${CFILES:=$(cd test/c; echo *.c)} awk.c
+	do
+		if [ $i = awk.c ]
+		then
+			set -- ../example ../src awk.cs
+		else
+			makecs_c $i
+			set -- . . makecs.cs
+		fi
+		if [ -z "$SQLITE_DB" ]
+		then
+			skip_test "$i sqlite direct" "CScout was built without SQLITE_DB"
+			continue
+		fi
+		if [ "$SQLITE3" ]
+		then
+			sqlitedump_c $i $1 $2 $3 insert >test/vout/$i.sqlite.insert
+		fi
+		runtest_sqlite $i $1 $2 $3 direct test/vout/$i.sqlite.insert
+	done
+fi
+
+# Self-contained unit tests of individual modules
+if [ $TEST_UNIT = 1 ]
+then
+	TEST_GROUP=unit
+	mkdir -p test/err
+	for NAME in nameindex
+	do
+		start_test . $NAME
+		rm -f test/nout/$NAME
+		${CXX:-c++} -std=gnu++11 -I. -DUNIT_TEST -o build/$NAME-test $NAME.cpp \
+			2>test/err/$NAME.cc &&
+		build/$NAME-test >test/nout/$NAME
+		end_compare . $NAME
+	done
+fi
+
 # Finish priming
 if [ "$PRIME" = "1" ]
 then
@@ -0,0 +1,1577 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * For documentation read the corresponding .h file
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <string>
+#include <deque>
+#include <set>
+#include <vector>
+#include <stack>
+#include <list>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <cstdio>		// rename(3)
+
+#if defined(unix) || defined(__unix__) || defined(__MACH__)
+#include <unistd.h>		// access(2)
+#else
+#include <io.h>			// access(2)
+#endif
+
+#include "cpp.h"
+#include "debug.h"
+#include "error.h"
+#include "attr.h"
+#include "metrics.h"
+#include "fileid.h"
+#include "tokid.h"
+#include "token.h"
+#include "parse.tab.h"
+#include "ptoken.h"
+#include "fchar.h"
+#include "pltoken.h"
+#include "macro.h"
+#include "pdtoken.h"
+#include "eclass.h"
+#include "type.h"
+#include "call.h"
+#include "fcall.h"
+#include "mcall.h"
+#include "globobj.h"
+#include "stab.h"
+#include "compiledre.h"
+#include "query.h"
+#include "idquery.h"
+#include "fdep.h"
+#include "os.h"
+#include "md5.h"
+#include "snapshot.h"
+
+// Identifies a workspace image file
+static const char magic[] = "CScout workspace image\n";
+// Increase this on every change of the image's format
+static const unsigned long format_version = 5;
+
+bool Snapshot::recording;
+bool Snapshot::relinking;
+unsigned Snapshot::linkage_unit;
+bool Snapshot::merging_image;
+
+// An identifier that a linkage unit defines with external linkage
+struct LinkedId {
+	Token token;		// Token representing the identifier
+	vector <Tokid> others;	// Members of its class in other files
+	FCall *fcall;		// The identifier's function, if any
+	GlobObj *glob;		// The identifier's global object, if any
+	LinkedId() : fcall(NULL), glob(NULL) {}
+	LinkedId(const Id &id) : token(id.get_token()), fcall(id.get_fcall()), glob(id.get_glob()) {}
+};
+
+// The identifiers of each linkage unit, in the workspace's order
+static vector <vector <LinkedId> > linkage;
+
+// Write the elements of a workspace image
+class SnapshotWriter {
+private:
+	ofstream out;
+public:
+	SnapshotWriter(const string &fname) : out(fname.c_str(), ios::binary) {}
+	bool fail() const { return out.fail(); }
+	void close() { out.close(); }
+	void put_bytes(const void *p, size_t n) { out.write((const char *)p, n); }
+	void put_uint(unsigned long v) {
+		do {
+			unsigned char b = v & 0x7f;
+			if ((v >>= 7))
+				b |= 0x80;
+			out.put(b);
+		} while (v);
+	}
+	// Zig-zag encode v, so that small negative values remain short
+	void put_int(long v) { put_uint(((unsigned long)v << 1) ^ (v < 0 ? ~0UL : 0)); }
+	void put_bool(bool v) { out.put(v); }
+	void put_str(const string &s) {
+		put_uint(s.length());
+		put_bytes(s.data(), s.length());
+	}
+	void put_bits(const vector <bool> &v) {
+		put_uint(v.size());
+		for (vector <bool>::size_type i = 0; i < v.size(); i += 8) {
+			unsigned char b = 0;
+			for (int j = 0; j < 8 && i + j < v.size(); j++)
+				b |= v[i + j] << j;
+			out.put(b);
+		}
+	}
+	void put_hash(const FileHash &h) {
+		put_uint(h.size());
+		for (FileHash::const_iterator i = h.begin(); i != h.end(); i++)
+			out.put(*i);
+	}
+	void put_fileid(Fileid f) { put_uint(f.get_id()); }
+	void put_tokid(Tokid t) {
+		put_fileid(t.get_fileid());
+		put_uint((cs_offset_t)t.get_streampos());
+	}
+	void put_fileset(const set <Fileid> &s) {
+		put_uint(s.size());
+		for (set <Fileid>::const_iterator i = s.begin(); i != s.end(); i++)
+			put_fileid(*i);
+	}
+};
+
+// Read the elements of a memory-mapped workspace image
+class SnapshotReader {
+private:
+	const string fname;
+	const char *p, *end;
+	unsigned long nfiles;	// Number of files in the workspace
+	const vector <Fileid> *fmap;	// Map from the image's file ids to ours, or NULL
+public:
+	SnapshotReader(const string &n, const MappedFile *m) :
+		fname(n), p(m->begin()), end(m->end()), nfiles(0), fmap(NULL) {}
+	void set_nfiles(unsigned long n) { nfiles = n; }
+	// Translate the file ids read through m; the ids must be less than m->size()
+	void set_fileid_map(const vector <Fileid> *m) { fmap = m; }
+	void corrupt() const {
+		/*
+		 * @error
+		 * The workspace image specified with the -L option
+		 * is truncated or damaged
+		 */
+		Error::error(E_FATAL, fname + ": corrupt workspace image", false);
+	}
+	const char *get_bytes(size_t n) {
+		if ((size_t)(end - p) < n)
+			corrupt();
+		const char *r = p;
+		p += n;
+		return r;
+	}
+	unsigned long get_uint() {
+		unsigned long v = 0;
+		for (int shift = 0; ; shift += 7) {
+			if (p == end || shift >= 64)
+				corrupt();
+			unsigned char b = *p++;
+			v |= (unsigned long)(b & 0x7f) << shift;
+			if (!(b & 0x80))
+				return v;
+		}
+	}
+	long get_int() {
+		unsigned long v = get_uint();
+		return (long)(v >> 1) ^ -(long)(v & 1);
+	}
+	bool get_bool() { return *get_bytes(1) != 0; }
+	string get_str() {
+		unsigned long n = get_uint();
+		return string(get_bytes(n), n);
+	}
+	void get_bits(vector <bool> &v) {
+		v.resize(get_uint());
+		for (vector <bool>::size_type i = 0; i < v.size(); i += 8) {
+			unsigned char b = *get_bytes(1);
+			for (int j = 0; j < 8 && i + j < v.size(); j++)
+				v[i + j] = (b >> j) & 1;
+		}
+	}
+	FileHash get_hash() {
+		unsigned long n = get_uint();
+		const char *h = get_bytes(n);
+		return FileHash(h, h + n);
+	}
+	Fileid get_fileid() {
+		unsigned long id = get_uint();
+		if (id >= nfiles)
+			corrupt();
+		return fmap ? (*fmap)[id] : Fileid((int)id);
+	}
+	Tokid get_tokid() {
+		Fileid f(get_fileid());
+		return Tokid(f, (cs_offset_t)get_uint());
+	}
+	void get_fileset(set <Fileid> &s) {
+		for (unsigned long n = get_uint(); n > 0; n--)
+			s.insert(s.end(), get_fileid());
+	}
+	// Return an index into a table of n elements
+	unsigned long get_index(unsigned long n) {
+		unsigned long i = get_uint();
+		if (i >= n)
+			corrupt();
+		return i;
+	}
+	bool at_end() const { return p == end; }
+};
+
+/*
+ * Serialization of the classes whose internals we store.
+ * These are members of Snapshot, which the classes befriend.
+ */
+
+void
+Snapshot::put_attributes(SnapshotWriter &w, const Attributes &a)
+{
+	w.put_bits(a.attr);
+}
+
+void
+Snapshot::get_attributes(SnapshotReader &r, Attributes &a)
+{
+	r.get_bits(a.attr);
+}
+
+void
+Snapshot::put_metrics(SnapshotWriter &w, const Metrics &m)
+{
+	w.put_uint(m.count.size());
+	for (vector <int>::const_iterator i = m.count.begin(); i != m.count.end(); i++)
+		w.put_int(*i);
+	w.put_int(m.currlinelen);
+	w.put_uint(m.cstate);
+	w.put_bool(m.processed);
+}
+
+void
+Snapshot::get_metrics(SnapshotReader &r, Metrics &m)
+{
+	m.count.resize(r.get_uint());
+	for (vector <int>::iterator i = m.count.begin(); i != m.count.end(); i++)
+		*i = r.get_int();
+	m.currlinelen = r.get_int();
+	m.cstate = (enum e_cfile_state)r.get_uint();
+	m.processed = r.get_bool();
+}
+
+void
+Snapshot::put_token(SnapshotWriter &w, const Token &t)
+{
+	w.put_int(t.code);
+	w.put_str(t.val);
+	w.put_uint(t.parts.size());
+	for (dequeTpart::const_iterator i = t.parts.begin(); i != t.parts.end(); i++) {
+		w.put_tokid(i->get_tokid());
+		w.put_uint(i->get_len());
+	}
+}
+
+void
+Snapshot::get_token(SnapshotReader &r, Token &t)
+{
+	t.code = r.get_int();
+	t.val = r.get_str();
+	t.parts.clear();
+	for (unsigned long n = r.get_uint(); n > 0; n--) {
+		Tokid ti(r.get_tokid());
+		t.parts.push_back(Tpart(ti, r.get_uint()));
+	}
+}
+
+static void
+put_context(SnapshotWriter &w, const FcharContext &c)
+{
+	w.put_int(c.get_line_number());
+	if (c.is_valid())
+		w.put_tokid(c.get_tokid());
+}
+
+static FcharContext
+get_context(SnapshotReader &r)
+{
+	int line = r.get_int();
+	if (line == -1)
+		return FcharContext();
+	return FcharContext(line, r.get_tokid());
+}
+
+void
+Snapshot::put_idcount(SnapshotWriter &w, const IdCount &c)
+{
+	// Counts are integral, but totals can exceed an int
+	w.put_uint((unsigned long)c.total);
+	w.put_uint(c.count.size());
+	for (vector <double>::const_iterator i = c.count.begin(); i != c.count.end(); i++)
+		w.put_uint((unsigned long)*i);
+}
+
+void
+Snapshot::get_idcount(SnapshotReader &r, IdCount &c)
+{
+	c.total = r.get_uint();
+	c.count.resize(r.get_uint());
+	for (vector <double>::iterator i = c.count.begin(); i != c.count.end(); i++)
+		*i = r.get_uint();
+}
+
+// Verify that r is a workspace image this version can read
+static void
+check_header(SnapshotReader &r, const string &fname)
+{
+	if (memcmp(r.get_bytes(sizeof(magic) - 1), magic, sizeof(magic) - 1) != 0)
+		Error::error(E_FATAL, fname + ": not a CScout workspace image", false);
+	if (r.get_uint() != format_version)
+		/*
+		 * @error
+		 * The workspace image specified with the -L option
+		 * was created by an incompatible CScout version
+		 */
+		Error::error(E_FATAL, fname + ": incompatible workspace image version", false);
+	(void)r.get_str();
+	(void)r.get_hash();
+}
+
+void
+Snapshot::get_filedetails(SnapshotReader &r, Filedetails &d)
+{
+	d.name = r.get_str();
+	d.m_garbage_collected = r.get_bool();
+	d.m_required = r.get_bool();
+	d.m_compilation_unit = r.get_bool();
+	d.line_ends.resize(r.get_uint());
+	cs_offset_t pos = 0;
+	for (vector <streampos>::iterator j = d.line_ends.begin(); j != d.line_ends.end(); j++)
+		*j = (pos += r.get_int());
+	r.get_bits(d.processed_lines);
+	FileIncMap *maps[] = {&d.includes, &d.includers};
+	for (int m = 0; m < 2; m++)
+		for (unsigned long n = r.get_uint(); n > 0; n--) {
+			Fileid f(r.get_fileid());
+			bool direct = r.get_bool();
+			bool required = r.get_bool();
+			IncDetails id(direct, required);
+			for (unsigned long k = r.get_uint(); k > 0; k--)
+				id.add_line(r.get_int());
+			maps[m]->insert(maps[m]->end(), FileIncMap::value_type(f, id));
+		}
+	d.hash = r.get_hash();
+	d.ipath_offset = r.get_int();
+	d.segment = r.get_int();
+	r.get_fileset(d.runtime_uses);
+	r.get_fileset(d.runtime_used_by);
+	get_attributes(r, d.attr);
+	get_metrics(r, d.m);
+	d.hand_edited = false;
+	d.visited = false;
+}
+
+/*
+ * Save the analyzed workspace rooted at input into fname.
+ * The image is written into a temporary file that replaces fname
+ * only when it has been completely written, so that a failure
+ * leaves any previous image intact.
+ */
+void
+Snapshot::save(const string &fname, Fileid input)
+{
+	string tmpname(fname + ".tmp");
+	SnapshotWriter w(tmpname);
+
+	/*
+	 * The classes are written by walking the tokid map, which must
+	 * therefore point to the class roots and their complete members.
+	 */
+	Tokid::resolve_all();
+
+	cerr << "Saving workspace image " << fname << endl;
+	w.put_bytes(magic, sizeof(magic) - 1);
+	w.put_uint(format_version);
+	// Allow checking the image against the workspace it came from
+	w.put_str(input.get_path());
+	w.put_hash(Fileid::i2d[input.get_id()].hash);
+
+	// Projects and the attributes they occupy
+	w.put_uint(Attributes::size);
+	w.put_int(Project::current_projid);
+	w.put_int(Project::next_projid);
+	w.put_uint(Project::projnames.size());
+	for (vector <string>::const_iterator i = Project::projnames.begin(); i != Project::projnames.end(); i++)
+		w.put_str(*i);
+	w.put_uint(Project::projids.size());
+	for (map <string, int>::const_iterator i = Project::projids.begin(); i != Project::projids.end(); i++) {
+		w.put_str(i->first);
+		w.put_int(i->second);
+	}
+
+	// Files
+	w.put_uint(Fileid::i2d.size());
+	for (FI_id_to_details::const_iterator i = Fileid::i2d.begin(); i != Fileid::i2d.end(); i++) {
+		w.put_str(i->name);
+		w.put_bool(i->m_garbage_collected);
+		w.put_bool(i->m_required);
+		w.put_bool(i->m_compilation_unit);
+		w.put_uint(i->line_ends.size());
+		cs_offset_t prev = 0;
+		for (vector <streampos>::const_iterator j = i->line_ends.begin(); j != i->line_ends.end(); j++) {
+			w.put_int((cs_offset_t)*j - prev);
+			prev = (cs_offset_t)*j;
+		}
+		w.put_bits(i->processed_lines);
+		const FileIncMap *maps[] = {&i->includes, &i->includers};
+		for (int m = 0; m < 2; m++) {
+			w.put_uint(maps[m]->size());
+			for (FileIncMap::const_iterator j = maps[m]->begin(); j != maps[m]->end(); j++) {
+				w.put_fileid(j->first);
+				w.put_bool(j->second.is_directly_included());
+				w.put_bool(j->second.is_required());
+				const set <int> &lines = j->second.include_line_numbers();
+				w.put_uint(lines.size());
+				for (set <int>::const_iterator k = lines.begin(); k != lines.end(); k++)
+					w.put_int(*k);
+			}
+		}
+		w.put_hash(i->hash);
+		w.put_int(i->ipath_offset);
+		w.put_int(i->segment);
+		w.put_fileset(i->runtime_uses);
+		w.put_fileset(i->runtime_used_by);
+		put_attributes(w, i->attr);
+		put_metrics(w, i->m);
+	}
+	w.put_uint(Fileid::counter);
+	w.put_uint(Fileid::u2i.size());
+	for (FI_uname_to_id::const_iterator i = Fileid::u2i.begin(); i != Fileid::u2i.end(); i++) {
+		w.put_str(i->first);
+		w.put_uint(i->second);
+	}
+	w.put_uint(Fileid::identical_files.size());
+	for (FI_hash_to_ids::const_iterator i = Fileid::identical_files.begin(); i != Fileid::identical_files.end(); i++) {
+		w.put_hash(i->first);
+		w.put_fileset(i->second);
+	}
+
+	// Equivalence classes; their members also establish the tokid map
+	map <Eclass *, unsigned long> ecidx;
+	vector <Eclass *> ecs;
+	for (mapTokidEclass::const_iterator i = Tokid::tm.begin(); i != Tokid::tm.end(); i++)
+		for (FileEcIndex::size_type j = 0; j < i->slots(); j++)
+			if (i->ec(j) && ecidx.insert(map <Eclass *, unsigned long>::value_type(i->ec(j), ecs.size())).second)
+				ecs.push_back(i->ec(j));
+	w.put_uint(ecs.size());
+	for (vector <Eclass *>::const_iterator i = ecs.begin(); i != ecs.end(); i++) {
+		w.put_uint((*i)->len);
+		put_attributes(w, (*i)->attr);
+		w.put_uint((*i)->members.size());
+		for (setTokid::const_iterator j = (*i)->members.begin(); j != (*i)->members.end(); j++)
+			w.put_tokid(*j);
+	}
+
+	// Functions and macros in the order of Call::all
+	map <Call *, unsigned long> callidx;
+	unsigned long ncall = 0;
+	w.put_uint(Call::all.size());
+	for (Call::fun_map::const_iterator i = Call::all.begin(); i != Call::all.end(); i++) {
+		Call *c = i->second;
+		callidx[c] = ncall++;
+		w.put_bool(c->is_macro());
+		w.put_str(c->name);
+		put_token(w, c->token);
+		put_context(w, c->begin);
+		put_context(w, c->end);
+		if (!c->is_macro()) {
+			FCall *fc = static_cast<FCall *>(c);
+			w.put_tokid(fc->definition);
+			w.put_uint(fc->type.get_storage_class());
+			w.put_bool(fc->defined);
+			w.put_int(fc->first_defined);
+			w.put_int(fc->last_defined);
+			w.put_int(fc->last_declared);
+		}
+		put_metrics(w, c->m);
+	}
+	// The call graph; callers are the inverse of the calls
+	for (Call::fun_map::const_iterator i = Call::all.begin(); i != Call::all.end(); i++) {
+		Call *c = i->second;
+		w.put_uint(c->call.size());
+		for (Call::fun_container::const_iterator j = c->call.begin(); j != c->call.end(); j++)
+			w.put_uint(callidx[*j]);
+	}
+	// Functions defined in each file
+	for (FI_id_to_details::const_iterator i = Fileid::i2d.begin(); i != Fileid::i2d.end(); i++) {
+		w.put_uint(i->df.size());
+		for (FCallSet::const_iterator j = i->df.begin(); j != i->df.end(); j++)
+			w.put_uint(callidx[*j]);
+	}
+
+	// Global objects
+	map <GlobObj *, unsigned long> globidx;
+	w.put_uint(GlobObj::all.size());
+	for (GlobObj::glob_map::const_iterator i = GlobObj::all.begin(); i != GlobObj::all.end(); i++) {
+		GlobObj *g = i->second;
+		globidx.insert(map <GlobObj *, unsigned long>::value_type(g, globidx.size()));
+		w.put_str(g->name);
+		put_token(w, g->token);
+		w.put_uint(g->type.get_storage_class());
+		w.put_fileset(g->defined);
+		w.put_fileset(g->used);
+	}
+
+	/*
+	 * Identifiers of the linkage units.
+	 * The other files of an identifier's class are also stored,
+	 * so that the identifier can still be represented
+	 * after the file of its token changes.
+	 */
+	w.put_uint(linkage.size());
+	for (vector <vector <LinkedId> >::const_iterator i = linkage.begin(); i != linkage.end(); i++) {
+		w.put_uint(i->size());
+		for (vector <LinkedId>::const_iterator j = i->begin(); j != i->end(); j++) {
+			put_token(w, j->token);
+			vector <Tokid> others;
+			Tokid t(j->token.get_parts_begin()->get_tokid());
+			Eclass *ec = t.check_ec();
+			if (ec && j->token.get_parts_size() == 1) {
+				const setFileid &files = ec->get_files();
+				const setTokid &members = ec->get_members();
+				for (setFileid::const_iterator f = files.begin(); f != files.end(); f++)
+					if (*f != t.get_fileid())
+						others.push_back(*lower_bound(members.begin(), members.end(), Tokid(*f, 0)));
+			}
+			w.put_uint(others.size());
+			for (vector <Tokid>::const_iterator k = others.begin(); k != others.end(); k++)
+				w.put_tokid(*k);
+			map <Call *, unsigned long>::const_iterator c = callidx.find(j->fcall);
+			w.put_uint(c == callidx.end() ? 0 : c->second + 1);
+			map <GlobObj *, unsigned long>::const_iterator g = globidx.find(j->glob);
+			w.put_uint(g == globidx.end() ? 0 : g->second + 1);
+		}
+	}
+
+	// File dependencies whose SQL dump is deferred
+	put_fdeps(w);
+
+	// Identifiers
+	w.put_uint(Identifier::ids.size());
+	for (IdProp::const_iterator i = Identifier::ids.begin(); i != Identifier::ids.end(); i++) {
+		w.put_uint(ecidx[i->first]);
+		w.put_str(i->second.id);
+		w.put_str(i->second.newid);
+		w.put_bool(i->second.xfile);
+		w.put_bool(i->second.replaced);
+		w.put_bool(i->second.active);
+	}
+
+	// Identifier metrics
+	for (int i = 0; i < 2; i++) {
+		const IdMetricsSet &s = id_msum.rw[i];
+		put_idcount(w, s.once);
+		put_idcount(w, s.len);
+		put_idcount(w, s.maxlen);
+		put_idcount(w, s.minlen);
+		put_idcount(w, s.all);
+	}
+
+	w.put_fileid(input);
+	w.put_bytes(magic, sizeof(magic) - 1);
+	w.close();
+#ifdef WIN32
+	// Windows rename(3) does not replace existing files
+	if (!w.fail())
+		remove(fname.c_str());
+#endif
+	if (w.fail() || rename(tmpname.c_str(), fname.c_str()) != 0) {
+		string err(strerror(errno));
+		unlink(tmpname.c_str());
+		/*
+		 * @error
+		 * The workspace image specified with the -S option
+		 * could not be written.
+		 * Any previous image is left unchanged
+		 */
+		Error::error(E_FATAL, fname + ": unable to write workspace image: " + err, false);
+	}
+}
+
+// Save the file dependencies whose SQL dump is deferred
+void
+Snapshot::put_fdeps(SnapshotWriter &w)
+{
+	w.put_uint(Fdep::deferred.size());
+	for (vector <Fdep::UnitState>::const_iterator i = Fdep::deferred.begin(); i != Fdep::deferred.end(); i++) {
+		const Fdep::State &d = i->deps;
+		w.put_int(i->pid);
+		w.put_fileid(i->cu);
+		w.put_uint(d.definers.size());
+		for (Fdep::FSFMap::const_iterator j = d.definers.begin(); j != d.definers.end(); j++) {
+			w.put_fileid(j->first);
+			w.put_fileset(j->second);
+		}
+		w.put_uint(d.includers.size());
+		for (Fdep::FSFMap::const_iterator j = d.includers.begin(); j != d.includers.end(); j++) {
+			w.put_fileid(j->first);
+			w.put_fileset(j->second);
+		}
+		w.put_fileset(d.providers);
+		w.put_uint(d.include_triggers.size());
+		for (Fdep::ITMap::const_iterator j = d.include_triggers.begin(); j != d.include_triggers.end(); j++) {
+			w.put_fileid(j->first.first);
+			w.put_fileid(j->first.second);
+			w.put_uint(j->second.size());
+			for (Fdep::include_trigger_value::const_iterator k = j->second.begin(); k != j->second.end(); k++) {
+				w.put_uint((cs_offset_t)k->first);
+				w.put_int(k->second);
+			}
+		}
+	}
+}
+
+/*
+ * Add the deferred file dependencies stored in an image to those we have.
+ * Their file ids are translated to ours, so they can be dumped as
+ * if we had gathered them.
+ */
+void
+Snapshot::get_fdeps(SnapshotReader &r)
+{
+	for (unsigned long n = r.get_uint(); n > 0; n--) {
+		Fdep::deferred.push_back(Fdep::UnitState());
+		Fdep::UnitState &u = Fdep::deferred.back();
+		u.pid = (int)r.get_int();
+		u.cu = r.get_fileid();
+		for (unsigned long m = r.get_uint(); m > 0; m--) {
+			Fileid f(r.get_fileid());
+			r.get_fileset(u.deps.definers[f]);
+		}
+		for (unsigned long m = r.get_uint(); m > 0; m--) {
+			Fileid f(r.get_fileid());
+			r.get_fileset(u.deps.includers[f]);
+		}
+		r.get_fileset(u.deps.providers);
+		for (unsigned long m = r.get_uint(); m > 0; m--) {
+			Fileid def(r.get_fileid());
+			Fileid ref(r.get_fileid());
+			Fdep::include_trigger_value &v = u.deps.include_triggers[Fdep::include_trigger_domain(def, ref)];
+			for (unsigned long k = r.get_uint(); k > 0; k--) {
+				streampos pos((cs_offset_t)r.get_uint());
+				int len = (int)r.get_int();
+				v.insert(Fdep::include_trigger_value::value_type(pos, len));
+			}
+		}
+	}
+}
+
+// Add the linkage units' identifiers stored in an image to those we have
+void
+Snapshot::get_linkage(SnapshotReader &r, const vector <Call *> &calls, const vector <GlobObj *> &globs)
+{
+	unsigned long nunits = r.get_uint();
+	if (linkage.size() < nunits)
+		linkage.resize(nunits);
+	for (unsigned long u = 0; u < nunits; u++)
+		for (unsigned long n = r.get_uint(); n > 0; n--) {
+			LinkedId l;
+			get_token(r, l.token);
+			if (l.token.get_parts_size() == 0)
+				r.corrupt();
+			for (unsigned long k = r.get_uint(); k > 0; k--)
+				l.others.push_back(r.get_tokid());
+			unsigned long c = r.get_index(calls.size() + 1);
+			if (c) {
+				if (calls[c - 1]->is_macro())
+					r.corrupt();
+				l.fcall = static_cast<FCall *>(calls[c - 1]);
+			}
+			unsigned long g = r.get_index(globs.size() + 1);
+			if (g)
+				l.glob = globs[g - 1];
+			linkage[u].push_back(l);
+		}
+}
+
+// Establish the projects and the attributes they occupy
+void
+Snapshot::get_projects(SnapshotReader &r)
+{
+	Attributes::size = r.get_uint();
+	Project::current_projid = r.get_int();
+	Project::next_projid = r.get_int();
+	Project::projnames.resize(r.get_uint());
+	for (vector <string>::iterator i = Project::projnames.begin(); i != Project::projnames.end(); i++)
+		*i = r.get_str();
+	Project::projids.clear();
+	for (unsigned long n = r.get_uint(); n > 0; n--) {
+		string name(r.get_str());
+		Project::projids[name] = r.get_int();
+	}
+}
+
+// Restore the image saved in fname; return the workspace's root file
+Fileid
+Snapshot::load(const string &fname)
+{
+	const MappedFile *mf = MappedFile::get(fname);
+	if (mf == NULL)
+		Error::error(E_FATAL, fname + ": " + string(strerror(errno)), false);
+	SnapshotReader r(fname, mf);
+
+	cerr << "Loading workspace image " << fname << endl;
+	check_header(r, fname);
+	get_projects(r);
+
+	// Files
+	Fileid::i2d.clear();
+	Fileid::i2d.resize(r.get_uint());
+	r.set_nfiles(Fileid::i2d.size());
+	for (FI_id_to_details::iterator i = Fileid::i2d.begin(); i != Fileid::i2d.end(); i++)
+		get_filedetails(r, *i);
+	Fileid::counter = r.get_uint();
+	Fileid::u2i.clear();
+	for (unsigned long n = r.get_uint(); n > 0; n--) {
+		string uname(r.get_str());
+		Fileid::u2i[uname] = r.get_index(Fileid::i2d.size());
+	}
+	/*
+	 * The unique file names (device and inode) need not survive
+	 * a file system's remounting or a backup restore.
+	 * Refresh those of the files that still exist.
+	 */
+	for (FI_uname_to_id::iterator i = Fileid::u2i.begin(); i != Fileid::u2i.end();) {
+		const string &path = Fileid::i2d[i->second].name;
+		string uname;
+		if (i->second != 0 && access(path.c_str(), F_OK) == 0 &&
+		    (uname = get_uniq_fname_string(path.c_str())) != i->first) {
+			Fileid::u2i[uname] = i->second;
+			Fileid::u2i.erase(i++);
+		} else
+			i++;
+	}
+	Fileid::identical_files.clear();
+	for (unsigned long n = r.get_uint(); n > 0; n--) {
+		FileHash h(r.get_hash());
+		r.get_fileset(Fileid::identical_files[h]);
+	}
+	Fileid::anonymous = Fileid(0);
+
+	// Equivalence classes
+	Tokid::clear();
+	vector <Eclass *> ecs(r.get_uint());
+	for (vector <Eclass *>::iterator i = ecs.begin(); i != ecs.end(); i++) {
+		Eclass *e = *i = new Eclass(r.get_uint());
+		get_attributes(r, e->attr);
+		for (unsigned long n = r.get_uint(); n > 0; n--) {
+			Tokid t(r.get_tokid());
+			e->members.insert(e->members.end(), t);
+			t.set_ec(e);
+		}
+		e->size = e->members.size();
+	}
+
+	// Functions and macros
+	vector <Call *> calls(r.get_uint());
+	for (vector <Call *>::iterator i = calls.begin(); i != calls.end(); i++) {
+		bool is_macro = r.get_bool();
+		string name(r.get_str());
+		Token t;
+		get_token(r, t);
+		FcharContext begin(get_context(r));
+		FcharContext end(get_context(r));
+		if (t.get_parts_size() == 0)
+			r.corrupt();
+		Call *c;
+		if (is_macro)
+			c = new MCall(t, name);
+		else {
+			Tokid def(r.get_tokid());
+			enum e_storage_class sc = (enum e_storage_class)r.get_uint();
+			FCall *fc = new FCall(t, basic(b_abstract, s_none, sc), name);
+			fc->definition = def;
+			fc->defined = r.get_bool();
+			fc->first_defined = r.get_int();
+			fc->last_defined = r.get_int();
+			fc->last_declared = r.get_int();
+			c = fc;
+		}
+		c->begin = begin;
+		c->end = end;
+		get_metrics(r, c->m);
+		*i = c;
+	}
+	for (vector <Call *>::iterator i = calls.begin(); i != calls.end(); i++)
+		for (unsigned long n = r.get_uint(); n > 0; n--)
+			Call::register_call(*i, calls[r.get_index(calls.size())]);
+	for (FI_id_to_details::iterator i = Fileid::i2d.begin(); i != Fileid::i2d.end(); i++)
+		for (unsigned long n = r.get_uint(); n > 0; n--)
+			i->df.insert(calls[r.get_index(calls.size())]);
+
+	// Global objects
+	vector <GlobObj *> globs(r.get_uint());
+	for (vector <GlobObj *>::iterator i = globs.begin(); i != globs.end(); i++) {
+		string name(r.get_str());
+		Token t;
+		get_token(r, t);
+		if (t.get_parts_size() == 0)
+			r.corrupt();
+		enum e_storage_class sc = (enum e_storage_class)r.get_uint();
+		GlobObj *g = new GlobObj(t, basic(b_abstract, s_none, sc), name);
+		r.get_fileset(g->defined);
+		r.get_fileset(g->used);
+		*i = g;
+	}
+
+	// Identifiers of the linkage units
+	linkage.clear();
+	get_linkage(r, calls, globs);
+
+	// File dependencies whose SQL dump is deferred
+	Fdep::deferred.clear();
+	get_fdeps(r);
+
+	// Identifiers
+	Identifier::ids.clear();
+	for (unsigned long n = r.get_uint(); n > 0; n--) {
+		Eclass *e = ecs[r.get_index(ecs.size())];
+		Identifier id;
+		id.id = r.get_str();
+		id.newid = r.get_str();
+		id.xfile = r.get_bool();
+		id.replaced = r.get_bool();
+		id.active = r.get_bool();
+		Identifier::ids.insert(Identifier::ids.end(), IdProp::value_type(e, id));
+	}
+
+	// Identifier metrics
+	for (int i = 0; i < 2; i++) {
+		IdMetricsSet &s = id_msum.rw[i];
+		get_idcount(r, s.once);
+		get_idcount(r, s.len);
+		get_idcount(r, s.maxlen);
+		get_idcount(r, s.minlen);
+		get_idcount(r, s.all);
+	}
+
+	Fileid input(r.get_fileid());
+	if (memcmp(r.get_bytes(sizeof(magic) - 1), magic, sizeof(magic) - 1) != 0 || !r.at_end())
+		r.corrupt();
+	MappedFile::forget(fname);
+	return input;
+}
+
+// Add to the include map to the entries of from, whose file ids map through fmap
+static void
+merge_incmap(FileIncMap &to, const FileIncMap &from, const vector <Fileid> &fmap)
+{
+	for (FileIncMap::const_iterator i = from.begin(); i != from.end(); i++) {
+		Fileid f(fmap[i->first.get_id()]);
+		FileIncMap::iterator t = to.find(f);
+		if (t == to.end())
+			t = to.insert(FileIncMap::value_type(f, IncDetails(false, false))).first;
+		t->second.update(i->second.is_directly_included(), i->second.is_required());
+		const set <int> &lines = i->second.include_line_numbers();
+		for (set <int>::const_iterator j = lines.begin(); j != lines.end(); j++)
+			t->second.add_line(*j);
+	}
+}
+
+// Add to the file set the files of from, whose ids map through fmap
+static void
+merge_fileset(Fileidset &to, const Fileidset &from, const vector <Fileid> &fmap)
+{
+	for (Fileidset::const_iterator i = from.begin(); i != from.end(); i++)
+		to.insert(fmap[i->get_id()]);
+}
+
+// Return true if no equivalence class covers any of the len characters starting at t
+bool
+Snapshot::ec_free(Tokid t, int len)
+{
+	if (t.fi.get_id() >= (int)Tokid::tm.size())
+		return true;
+	const FileEcIndex &fidx = Tokid::tm[t.fi.get_id()];
+	FileEcIndex::size_type pos = fidx.position(t.offs);
+	for (FileEcIndex::size_type i = pos; i < fidx.slots() && fidx.offset(i) < t.offs + len; i++)
+		if (fidx.ec(i))
+			return false;
+	// A class starting before t may extend into it
+	while (pos > 0)
+		if (fidx.ec(--pos)) {
+			Tokid s(t.fi, fidx.offset(pos));
+			return s.check_ec()->len <= t - s;
+		}
+	return true;
+}
+
+/*
+ * Return the equivalence classes covering exactly the len characters
+ * starting at t.
+ * Classes extending beyond the range are split, and new classes are
+ * created for the characters no class covers.
+ */
+dequeTpart
+Snapshot::ec_cover(Tokid t, int len)
+{
+	dequeTpart r;
+
+	if (t.check_ec() == NULL && t.fi.get_id() < (int)Tokid::tm.size()) {
+		// Split a class starting before t that extends into it
+		const FileEcIndex &fidx = Tokid::tm[t.fi.get_id()];
+		for (FileEcIndex::size_type pos = fidx.position(t.offs); pos > 0;)
+			if (fidx.ec(--pos)) {
+				Tokid s(t.fi, fidx.offset(pos));
+				Eclass *e = s.check_ec();
+				if (e->len > t - s)
+					e->split(t - s - 1);
+				break;
+			}
+	}
+	for (int covered = 0; covered < len;) {
+		Tokid p(t + covered);
+		Eclass *e = p.check_ec();
+		if (e == NULL) {
+			// Cover the characters up to the next class
+			int gap = len - covered;
+			if (p.fi.get_id() < (int)Tokid::tm.size()) {
+				const FileEcIndex &fidx = Tokid::tm[p.fi.get_id()];
+				for (FileEcIndex::size_type i = fidx.position(p.offs); i < fidx.slots() && fidx.offset(i) < p.offs + gap; i++)
+					if (fidx.ec(i)) {
+						gap = fidx.offset(i) - p.offs;
+						break;
+					}
+			}
+			e = new Eclass(p, gap);
+		} else if (e->len > len - covered)
+			e->split(len - covered - 1);
+		r.push_back(Tpart(p, e->len));
+		covered += e->len;
+	}
+	return r;
+}
+
+// Add to the workspace the file uname with the details d an image has for it
+Fileid
+Snapshot::add_file(const string &uname, const Filedetails &d)
+{
+	Fileid f((int)Fileid::i2d.size());
+	Fileid::u2i[uname] = f.get_id();
+	Fileid::i2d.push_back(Filedetails(d.name, false, d.hash));
+	Fileid::i2d.back().ipath_offset = d.ipath_offset;
+	Fileid::counter = Fileid::i2d.size();
+	return f;
+}
+
+/*
+ * Prepare an empty workspace for merging the images that parallel
+ * workers saved in fnames.
+ * Establish the workspace's projects, and number its files in the
+ * order sequential processing would open them: by the workspace
+ * segment where they were first opened, and then by their order
+ * in the image of the worker that processed this segment.
+ */
+void
+Snapshot::prepare_merge(const vector <string> &fnames)
+{
+	typedef pair <long, unsigned long> FileKey;	// Segment, id in the image
+	typedef map <string, pair <FileKey, Filedetails> > FileFirst;
+	FileFirst first;		// Each file's first opening, by unique name
+
+	for (vector <string>::const_iterator f = fnames.begin(); f != fnames.end(); f++) {
+		const MappedFile *mf = MappedFile::get(*f);
+		if (mf == NULL)
+			Error::error(E_FATAL, *f + ": " + string(strerror(errno)), false);
+		SnapshotReader r(*f, mf);
+
+		check_header(r, *f);
+		// Merging verifies that all images have the same projects
+		get_projects(r);
+		vector <Filedetails> files(r.get_uint());
+		r.set_nfiles(files.size());
+		for (vector <Filedetails>::iterator i = files.begin(); i != files.end(); i++)
+			get_filedetails(r, *i);
+		(void)r.get_uint();
+		for (unsigned long n = r.get_uint(); n > 0; n--) {
+			string uname(r.get_str());
+			unsigned long id = r.get_index(files.size());
+			if (id == 0 || Fileid::u2i.find(uname) != Fileid::u2i.end())
+				continue;
+			const Filedetails &d = files[id];
+			FileKey key(d.segment == -1 ? LONG_MAX : d.segment, id);
+			FileFirst::iterator i = first.find(uname);
+			if (i == first.end())
+				first.insert(make_pair(uname, make_pair(key, d)));
+			else if (key < i->second.first)
+				i->second = make_pair(key, d);
+		}
+		MappedFile::forget(*f);
+	}
+
+	multimap <FileKey, FileFirst::const_iterator> order;
+	for (FileFirst::const_iterator i = first.begin(); i != first.end(); i++)
+		order.insert(make_pair(i->second.first, i));
+	for (multimap <FileKey, FileFirst::const_iterator>::const_iterator i = order.begin(); i != order.end(); i++)
+		add_file(i->second->first, i->second->second.second);
+}
+
+/*
+ * Merge into the workspace the image saved in fname by processing
+ * other compilation units of the same workspace.
+ * Only the results of processing are merged; the image must not have
+ * been post-processed.
+ */
+void
+Snapshot::merge(const string &fname)
+{
+	const MappedFile *mf = MappedFile::get(fname);
+	if (mf == NULL)
+		Error::error(E_FATAL, fname + ": " + string(strerror(errno)), false);
+	SnapshotReader r(fname, mf);
+
+	cerr << "Merging workspace image " << fname << endl;
+	check_header(r, fname);
+	// The merged classes belong to the projects recorded in the image
+	merging_image = true;
+
+	// Projects
+	(void)r.get_uint();
+	(void)r.get_int();
+	(void)r.get_int();
+	vector <string> projnames(r.get_uint());
+	for (vector <string>::iterator i = projnames.begin(); i != projnames.end(); i++)
+		*i = r.get_str();
+	for (unsigned long n = r.get_uint(); n > 0; n--) {
+		(void)r.get_str();
+		(void)r.get_int();
+	}
+	if (projnames != Project::projnames)
+		/*
+		 * @error
+		 * A workspace image produced by a worker process
+		 * defines different projects than the others.
+		 * This can happen if the workspace changed
+		 * while it was being processed
+		 */
+		Error::error(E_FATAL, fname + ": workspace image from a different workspace", false);
+
+	// Files; their ids are mapped to ours through their unique names
+	vector <Filedetails> files(r.get_uint());
+	r.set_nfiles(files.size());
+	for (vector <Filedetails>::iterator i = files.begin(); i != files.end(); i++)
+		get_filedetails(r, *i);
+	(void)r.get_uint();
+	vector <Fileid> fmap(files.size(), Fileid::anonymous);
+	for (unsigned long n = r.get_uint(); n > 0; n--) {
+		string uname(r.get_str());
+		unsigned long id = r.get_index(files.size());
+		if (id == 0)
+			continue;
+		FI_uname_to_id::const_iterator i = Fileid::u2i.find(uname);
+		if (i != Fileid::u2i.end())
+			fmap[id] = Fileid(i->second);
+		else
+			fmap[id] = add_file(uname, files[id]);
+	}
+	Fileid::counter = Fileid::i2d.size();
+	for (vector <Filedetails>::size_type id = 1; id < files.size(); id++) {
+		const Filedetails &from = files[id];
+		Filedetails &to = Fileid::i2d[fmap[id].get_id()];
+		to.m_garbage_collected = to.m_garbage_collected || from.m_garbage_collected;
+		to.m_required = to.m_required || from.m_required;
+		to.m_compilation_unit = to.m_compilation_unit || from.m_compilation_unit;
+		if (from.line_ends.size() > to.line_ends.size())
+			to.line_ends = from.line_ends;
+		if (from.processed_lines.size() > to.processed_lines.size())
+			to.processed_lines.resize(from.processed_lines.size());
+		for (vector <bool>::size_type j = 0; j < from.processed_lines.size(); j++)
+			if (from.processed_lines[j])
+				to.processed_lines[j] = true;
+		merge_incmap(to.includes, from.includes, fmap);
+		merge_incmap(to.includers, from.includers, fmap);
+		merge_fileset(to.runtime_uses, from.runtime_uses, fmap);
+		merge_fileset(to.runtime_used_by, from.runtime_used_by, fmap);
+		to.attr.merge_with(files[id].attr);
+		/*
+		 * As in sequential processing, the first unit processing
+		 * a file establishes its metrics.
+		 */
+		bool earlier = from.segment != -1 &&
+		    (to.segment == -1 || from.segment < to.segment);
+		if (from.m.processed && (!to.m.processed || earlier))
+			to.m = from.m;
+		if (earlier)
+			to.segment = from.segment;
+	}
+	r.set_fileid_map(&fmap);
+	for (unsigned long n = r.get_uint(); n > 0; n--) {
+		FileHash h(r.get_hash());
+		r.get_fileset(Fileid::identical_files[h]);
+	}
+
+	/*
+	 * Equivalence classes.
+	 * Classes of tokids we have not seen are added as they are;
+	 * the others are split to the boundaries of the merged ones
+	 * and unified with the classes of their other members.
+	 */
+	unsigned long necs = r.get_uint();
+	for (unsigned long n = necs; n > 0; n--) {
+		int len = r.get_uint();
+		Attributes attr;
+		get_attributes(r, attr);
+		vector <Tokid> members(r.get_uint());
+		bool seen = false;
+		for (vector <Tokid>::iterator i = members.begin(); i != members.end(); i++) {
+			*i = r.get_tokid();
+			if (!seen && !ec_free(*i, len))
+				seen = true;
+		}
+		if (members.empty())
+			r.corrupt();
+		if (!seen) {
+			Eclass *e = new Eclass(len);
+			e->attr = attr;
+			for (vector <Tokid>::const_iterator i = members.begin(); i != members.end(); i++) {
+				e->members.insert(e->members.end(), *i);
+				i->set_ec(e);
+			}
+			e->size = e->members.size();
+			continue;
+		}
+		for (vector <Tokid>::size_type i = 1; i < members.size(); i++) {
+			Tpart::homogenize(ec_cover(members[0], len), ec_cover(members[i], len));
+			dequeTpart a(ec_cover(members[0], len));
+			dequeTpart b(ec_cover(members[i], len));
+			for (dequeTpart::const_iterator ai = a.begin(), bi = b.begin(); ai != a.end(); ai++, bi++)
+				::merge(ai->get_tokid().get_ec(), bi->get_tokid().get_ec());
+		}
+		dequeTpart parts(ec_cover(members[0], len));
+		for (dequeTpart::const_iterator i = parts.begin(); i != parts.end(); i++)
+			i->get_tokid().get_ec()->attr.merge_with(attr);
+	}
+
+	// Functions and macros, matched through their tokens
+	vector <Call *> calls(r.get_uint());
+	for (vector <Call *>::iterator i = calls.begin(); i != calls.end(); i++) {
+		bool is_macro = r.get_bool();
+		string name(r.get_str());
+		Token t;
+		get_token(r, t);
+		FcharContext begin(get_context(r));
+		FcharContext end(get_context(r));
+		if (t.get_parts_size() == 0)
+			r.corrupt();
+		Tokid def;
+		enum e_storage_class sc = c_unspecified;
+		bool defined = false;
+		long first_defined = -1, last_defined = -1, last_declared = -1;
+		if (!is_macro) {
+			def = r.get_tokid();
+			sc = (enum e_storage_class)r.get_uint();
+			defined = r.get_bool();
+			first_defined = r.get_int();
+			last_defined = r.get_int();
+			last_declared = r.get_int();
+		}
+		Metrics m;
+		get_metrics(r, m);
+		Call *c = Call::get_call(t);
+		if (c == NULL) {
+			if (is_macro)
+				c = new MCall(t, name);
+			else
+				c = new FCall(t, basic(b_abstract, s_none, sc), name);
+		}
+		if (c->is_macro()) {
+			// The first unit processing a macro establishes its span and metrics
+			if (!c->begin.is_valid() && begin.is_valid()) {
+				c->begin = begin;
+				c->end = end;
+			}
+			if (!c->m.processed && m.processed)
+				static_cast<Metrics &>(c->m) = m;
+			*i = c;
+			continue;
+		}
+		/*
+		 * As in sequential processing, the function's first
+		 * definition establishes its span and metrics, while its
+		 * last definition and declaration establish the rest.
+		 */
+		FCall *fc = static_cast<FCall *>(c);
+		Metrics before(c->m);
+		if (first_defined != -1 &&
+		    (fc->first_defined == -1 || first_defined < fc->first_defined)) {
+			if (c->is_span_valid())
+				Fileid::i2d[c->end.get_tokid().get_fileid().get_id()].df.erase(c);
+			fc->first_defined = first_defined;
+			c->begin = begin;
+			c->end = end;
+			static_cast<Metrics &>(c->m) = m;
+		}
+		c->m.set_metric(FunMetrics::em_ngnsoc,
+		    (int)(last_defined > fc->last_defined ? m : before).get_metric(FunMetrics::em_ngnsoc));
+		c->m.set_metric(FunMetrics::em_nparam,
+		    (int)(last_declared > fc->last_declared ? m : before).get_metric(FunMetrics::em_nparam));
+		if (last_defined > fc->last_defined) {
+			fc->last_defined = last_defined;
+			fc->definition = def;
+		}
+		if (last_declared > fc->last_declared)
+			fc->last_declared = last_declared;
+		fc->defined = fc->defined || defined;
+		*i = c;
+	}
+	for (vector <Call *>::iterator i = calls.begin(); i != calls.end(); i++)
+		for (unsigned long n = r.get_uint(); n > 0; n--)
+			Call::register_call(*i, calls[r.get_index(calls.size())]);
+	// A function belongs to the file where its first definition ends
+	for (vector <Fileid>::const_iterator i = fmap.begin(); i != fmap.end(); i++)
+		for (unsigned long n = r.get_uint(); n > 0; n--) {
+			Call *c = calls[r.get_index(calls.size())];
+			if (c->is_macro() || c->end.get_tokid().get_fileid() == *i)
+				Fileid::i2d[i->get_id()].df.insert(c);
+		}
+
+	// Global objects
+	vector <GlobObj *> globs(r.get_uint());
+	for (vector <GlobObj *>::iterator i = globs.begin(); i != globs.end(); i++) {
+		string name(r.get_str());
+		Token t;
+		get_token(r, t);
+		if (t.get_parts_size() == 0)
+			r.corrupt();
+		enum e_storage_class sc = (enum e_storage_class)r.get_uint();
+		GlobObj *g = GlobObj::get_glob(t);
+		if (g == NULL)
+			g = new GlobObj(t, basic(b_abstract, s_none, sc), name);
+		r.get_fileset(g->defined);
+		r.get_fileset(g->used);
+		*i = g;
+	}
+
+	// Identifiers of the linkage units; each is defined by a single worker
+	get_linkage(r, calls, globs);
+
+	// File dependencies whose SQL dump is deferred
+	get_fdeps(r);
+
+	// Identifiers and their metrics are established by post-processing
+	for (unsigned long n = r.get_uint(); n > 0; n--) {
+		(void)r.get_index(necs);
+		(void)r.get_str();
+		(void)r.get_str();
+		for (int i = 0; i < 3; i++)
+			(void)r.get_bool();
+	}
+	IdMetricsSummary ims;
+	for (int i = 0; i < 2; i++) {
+		IdMetricsSet &s = ims.rw[i];
+		get_idcount(r, s.once);
+		get_idcount(r, s.len);
+		get_idcount(r, s.maxlen);
+		get_idcount(r, s.minlen);
+		get_idcount(r, s.all);
+	}
+
+	(void)r.get_fileid();
+	if (memcmp(r.get_bytes(sizeof(magic) - 1), magic, sizeof(magic) - 1) != 0 || !r.at_end())
+		r.corrupt();
+	merging_image = false;
+	MappedFile::forget(fname);
+}
+
+// Return true if fname is an image of the current contents of the workspace path
+bool
+Snapshot::is_image_of(const string &fname, const string &path)
+{
+	const MappedFile *mf = MappedFile::get(fname);
+	if (mf == NULL)
+		return false;
+	SnapshotReader r(fname, mf);
+	bool match = false;
+	if (mf->size() > sizeof(magic) &&
+	    memcmp(r.get_bytes(sizeof(magic) - 1), magic, sizeof(magic) - 1) == 0 &&
+	    r.get_uint() == format_version &&
+	    r.get_str() == get_full_path(path.c_str())) {
+		unsigned char *h = MD5File(path.c_str());
+		match = (r.get_hash() == FileHash(h, h + 16));
+	}
+	if (!match)
+		MappedFile::forget(fname);
+	return match;
+}
+
+// Add to s f and the files it includes, directly or indirectly
+static void
+include_closure(Fileid f, Fileidset &s)
+{
+	if (!s.insert(f).second)
+		return;
+	const FileIncMap &m = f.get_includes();
+	for (FileIncMap::const_iterator i = m.begin(); i != m.end(); i++)
+		include_closure(i->first, s);
+}
+
+/*
+ * Retract from a restored workspace the results of the files that
+ * changed since its image was saved, and of the files used only by
+ * the compilation units that include them.
+ * Set stale to the compilation units that must be processed again.
+ * Return true if any file changed.
+ */
+bool
+Snapshot::retract_changed(Fileidset &stale)
+{
+	Fileidset changed;
+
+	// Id 0 is the anonymous file
+	for (FI_id_to_details::size_type id = 1; id < Fileid::i2d.size(); id++) {
+		Filedetails &d = Fileid::i2d[id];
+		Fileid f((int)id);
+		if (access(d.name.c_str(), R_OK) != 0) {
+			changed.insert(f);
+			continue;
+		}
+		unsigned char *h = MD5File(d.name.c_str());
+		FileHash hash(h, h + 16);
+		if (hash == d.hash)
+			continue;
+		changed.insert(f);
+		// Keep the sets of identical files current
+		FI_hash_to_ids::iterator old = Fileid::identical_files.find(d.hash);
+		if (old != Fileid::identical_files.end()) {
+			old->second.erase(f);
+			if (old->second.empty())
+				Fileid::identical_files.erase(old);
+		}
+		d.hash = hash;
+		Fileid::identical_files[hash].insert(f);
+	}
+	if (changed.empty())
+		return false;
+
+	// Find the affected units and the files that only they use
+	Fileidset stale_files, live_files;
+	for (FI_id_to_details::size_type id = 1; id < Fileid::i2d.size(); id++) {
+		Fileid f((int)id);
+		if (!f.compilation_unit())
+			continue;
+		Fileidset inc;
+		include_closure(f, inc);
+		bool is_stale = false;
+		for (Fileidset::const_iterator i = inc.begin(); i != inc.end(); i++)
+			if (changed.find(*i) != changed.end()) {
+				is_stale = true;
+				break;
+			}
+		if (is_stale) {
+			stale.insert(f);
+			stale_files.insert(inc.begin(), inc.end());
+		} else
+			live_files.insert(inc.begin(), inc.end());
+	}
+	Fileidset retracted(changed);
+	for (Fileidset::const_iterator i = stale_files.begin(); i != stale_files.end(); i++)
+		if (live_files.find(*i) == live_files.end())
+			retracted.insert(*i);
+	cerr << "Reprocessing " << stale.size() << " compilation unit(s) affected by " <<
+		changed.size() << " changed file(s)" << endl;
+	retract(retracted);
+	return true;
+}
+
+/*
+ * Remove the results of processing the files in r, and clear the
+ * post-processing results of all files, which must then be
+ * post-processed again.
+ * Entities first seen in r, but also referenced elsewhere are kept,
+ * because the files referring to them will not be processed again.
+ */
+void
+Snapshot::retract(const Fileidset &r)
+{
+	// The identifiers are recreated by post-processing
+	Identifier::ids.clear();
+	id_msum = IdMetricsSummary();
+
+	// Equivalence classes; a restored map points to the class roots
+	csassert(Tokid::nmerged == 0);
+	for (Fileidset::const_iterator f = r.begin(); f != r.end(); f++) {
+		if (f->get_id() >= (int)Tokid::tm.size())
+			continue;
+		FileEcIndex &fidx = Tokid::tm[f->get_id()];
+		for (FileEcIndex::size_type i = 0; i < fidx.slots(); i++) {
+			Eclass *ec = fidx.ec(i);
+			if (ec == NULL)
+				continue;
+			ec->size -= ec->members.erase(Tokid(*f, fidx.offset(i)));
+			ec->files.clear();
+			// Tokids in other files no longer refer to ec
+			if (ec->members.empty())
+				delete ec;
+		}
+		fidx = FileEcIndex();
+	}
+
+	// File details
+	for (Fileidset::const_iterator f = r.begin(); f != r.end(); f++) {
+		Filedetails &d = Fileid::i2d[f->get_id()];
+		for (FileIncMap::const_iterator i = d.includes.begin(); i != d.includes.end(); i++)
+			Fileid::i2d[i->first.get_id()].includers.erase(*f);
+		for (FileIncMap::const_iterator i = d.includers.begin(); i != d.includers.end(); i++)
+			Fileid::i2d[i->first.get_id()].includes.erase(*f);
+		d.includes.clear();
+		d.includers.clear();
+		d.processed_lines.clear();
+		d.forget_include_guard();
+		d.df.clear();
+		d.m = FileMetrics();
+		d.m_required = false;
+		d.m_compilation_unit = false;
+	}
+	for (FI_id_to_details::iterator i = Fileid::i2d.begin(); i != Fileid::i2d.end(); i++) {
+		i->line_ends.clear();
+		i->runtime_uses.clear();
+		i->runtime_used_by.clear();
+		i->m.clear_postprocessing();
+	}
+
+	// Functions and macros
+	set <Call *> removed;
+	for (Call::fun_map::iterator i = Call::all.begin(); i != Call::all.end(); i++) {
+		Call *c = i->second;
+		if (r.find(c->get_fileid()) == r.end())
+			continue;
+		FCall *fc = c->is_macro() ? NULL : static_cast<FCall *>(c);
+		if (fc && fc->defined && r.find(fc->definition.get_fileid()) == r.end())
+			continue;
+		bool called_elsewhere = false;
+		for (Call::fun_container::const_iterator j = c->caller.begin(); j != c->caller.end(); j++)
+			if (r.find((*j)->get_fileid()) == r.end()) {
+				called_elsewhere = true;
+				break;
+			}
+		if (!called_elsewhere)
+			removed.insert(c);
+	}
+	for (Call::fun_map::iterator i = Call::all.begin(); i != Call::all.end();) {
+		Call *c = i->second;
+		if (removed.find(c) != removed.end()) {
+			Call::all.erase(i++);
+			continue;
+		}
+		i++;
+		FCall *fc = c->is_macro() ? NULL : static_cast<FCall *>(c);
+		if (fc && fc->defined && r.find(fc->definition.get_fileid()) != r.end()) {
+			// The function's definition will be processed again
+			for (Call::fun_container::const_iterator j = c->call.begin(); j != c->call.end(); j++)
+				(*j)->caller.erase(c);
+			c->call.clear();
+			fc->defined = false;
+			c->begin = c->end = FcharContext();
+			c->m = FunMetrics(c);
+		}
+		c->m.clear_postprocessing();
+	}
+	for (Call::fun_map::iterator i = Call::all.begin(); i != Call::all.end(); i++) {
+		Call *c = i->second;
+		for (set <Call *>::const_iterator j = removed.begin(); j != removed.end(); j++) {
+			c->call.erase(*j);
+			c->caller.erase(*j);
+		}
+	}
+	for (FI_id_to_details::iterator i = Fileid::i2d.begin(); i != Fileid::i2d.end(); i++)
+		for (set <Call *>::const_iterator j = removed.begin(); j != removed.end(); j++)
+			i->df.erase(*j);
+	for (set <Call *>::const_iterator i = removed.begin(); i != removed.end(); i++)
+		delete *i;
+
+	// Global objects
+	set <GlobObj *> deleted;
+	for (GlobObj::glob_map::iterator i = GlobObj::all.begin(); i != GlobObj::all.end();) {
+		GlobObj *g = i->second;
+		for (Fileidset::const_iterator f = r.begin(); f != r.end(); f++) {
+			g->defined.erase(*f);
+			g->used.erase(*f);
+		}
+		if (r.find(g->token.get_parts_begin()->get_tokid().get_fileid()) != r.end() &&
+		    g->defined.empty() && g->used.empty()) {
+			GlobObj::all.erase(i++);
+			deleted.insert(g);
+			delete g;
+		} else
+			i++;
+	}
+
+	/*
+	 * Identifiers of the linkage units.
+	 * Represent those whose token was retracted by a member of their
+	 * class in another file, and drop those no file refers to any more.
+	 */
+	for (vector <vector <LinkedId> >::iterator i = linkage.begin(); i != linkage.end(); i++) {
+		vector <LinkedId> live;
+		for (vector <LinkedId>::iterator j = i->begin(); j != i->end(); j++) {
+			bool retracted = false;
+			for (dequeTpart::const_iterator k = j->token.get_parts_begin(); k != j->token.get_parts_end(); k++)
+				if (!k->get_tokid().check_ec())
+					retracted = true;
+			if (retracted) {
+				vector <Tokid>::const_iterator k;
+				for (k = j->others.begin(); k != j->others.end(); k++)
+					if (k->check_ec())
+						break;
+				if (k == j->others.end())
+					continue;
+				j->token = Token(j->token.code, j->token.val, *k);
+			}
+			if (removed.find(j->fcall) != removed.end())
+				j->fcall = NULL;
+			if (deleted.find(j->glob) != deleted.end())
+				j->glob = NULL;
+			j->others.clear();
+			live.push_back(*j);
+		}
+		i->swap(live);
+	}
+	relinking = true;
+
+	// The units processed again record their file dependencies anew
+	Fdep::forget_deferred(r);
+}
+
+// Called when a linkage unit starts
+void
+Snapshot::enter_linkage_unit()
+{
+	linkage_unit++;
+	if (!relinking || linkage_unit > linkage.size())
+		return;
+	// Link the units processed again with the unchanged ones
+	const vector <LinkedId> &lu = linkage[linkage_unit - 1];
+	for (vector <LinkedId>::const_iterator i = lu.begin(); i != lu.end(); i++)
+		Block::link(Id(i->token, basic(b_abstract, s_none, c_extern), i->fcall, i->glob));
+}
+
+// Called when a linkage unit that defined the identifiers in s ends
+void
+Snapshot::exit_linkage_unit(const Stab &s)
+{
+	if (!recording || linkage_unit == 0)
+		return;
+	if (linkage.size() < linkage_unit)
+		linkage.resize(linkage_unit);
+	vector <LinkedId> &lu = linkage[linkage_unit - 1];
+	lu.clear();
+	for (Stab_element::const_iterator i = s.begin(); i != s.end(); i++)
+		lu.push_back(LinkedId(Stab::get_id(i)));
+}
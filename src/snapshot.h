@@ -0,0 +1,149 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * A persistent binary image of an analyzed workspace.
+ * The image contains the state established by processing and
+ * post-processing the workspace: projects, files and their details,
+ * equivalence classes with their members and attributes (and thereby
+ * the tokid map), functions and macros with their call graph,
+ * global objects, identifiers, and identifier metrics.
+ * Integers are stored as variable-length (LEB128) quantities,
+ * so images are compact and independent of the host's word size
+ * and byte order.
+ *
+ * Types of functions and global objects are only stored in
+ * terms of their storage class; nothing more is needed for
+ * browsing and refactoring a restored workspace.
+ *
+ * A restored workspace can also be brought up to date by retracting
+ * the results of the changed files and of the files used only by the
+ * compilation units including them, and processing these units again.
+ * The retraction is conservative: equivalence classes that a stale unit
+ * joined through unchanged files are not split again, and entities
+ * that unchanged units also refer to are kept.
+ *
+ * The image also records the identifiers that each linkage unit (project)
+ * defines with external linkage.  When units are processed again, these
+ * are restored into their linkage unit, so that the units are linked
+ * with the unchanged ones.
+ *
+ * Images of workspaces whose compilation units were processed
+ * separately can also be merged, joining the equivalence classes,
+ * files, functions, and global objects they share.
+ *
+ */
+
+#ifndef SNAPSHOT_
+#define SNAPSHOT_
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#include "fileid.h"
+#include "tokid.h"
+
+class SnapshotWriter;
+class SnapshotReader;
+class Attributes;
+class Metrics;
+class Token;
+class IdCount;
+class Filedetails;
+class Stab;
+class Call;
+class GlobObj;
+
+class Snapshot {
+private:
+	static bool recording;		// Record the linkage units' identifiers
+	static bool relinking;		// Restore them into the linkage units
+	static unsigned linkage_unit;	// Ordinal of the current linkage unit
+	static bool merging_image;	// An image's results are being merged
+
+	// Save and restore the private state of the workspace's classes
+	static void put_attributes(SnapshotWriter &w, const Attributes &a);
+	static void get_attributes(SnapshotReader &r, Attributes &a);
+	static void put_metrics(SnapshotWriter &w, const Metrics &m);
+	static void get_metrics(SnapshotReader &r, Metrics &m);
+	static void put_token(SnapshotWriter &w, const Token &t);
+	static void get_token(SnapshotReader &r, Token &t);
+	static void put_idcount(SnapshotWriter &w, const IdCount &c);
+	static void get_idcount(SnapshotReader &r, IdCount &c);
+	static void get_filedetails(SnapshotReader &r, Filedetails &d);
+	static void get_projects(SnapshotReader &r);
+	// Add to the workspace the file uname with the details d an image has for it
+	static Fileid add_file(const string &uname, const Filedetails &d);
+	// Return true if no equivalence class covers any of the len characters starting at t
+	static bool ec_free(Tokid t, int len);
+	// Return the equivalence classes covering exactly the len characters starting at t
+	static dequeTpart ec_cover(Tokid t, int len);
+	// Add the linkage units' identifiers stored in an image to those we have
+	static void get_linkage(SnapshotReader &r, const vector <Call *> &calls, const vector <GlobObj *> &globs);
+	// Save and restore the file dependencies whose SQL dump is deferred
+	static void put_fdeps(SnapshotWriter &w);
+	static void get_fdeps(SnapshotReader &r);
+	// Remove the results of processing the files in r
+	static void retract(const Fileidset &r);
+public:
+	// Save the analyzed workspace rooted at input into fname
+	static void save(const string &fname, Fileid input);
+	/*
+	 * Restore into an empty workspace the image saved in fname.
+	 * Return the root file of the workspace.
+	 * Errors in the image are fatal.
+	 */
+	static Fileid load(const string &fname);
+	/*
+	 * Merge into the workspace the processing results saved in fname
+	 * from other compilation units of the same workspace.
+	 * The image must not have been post-processed.
+	 */
+	static void merge(const string &fname);
+	/*
+	 * Return true while an image is being merged; its classes already
+	 * belong to the projects recorded in it, not to the current one
+	 */
+	static bool merging() { return merging_image; }
+	/*
+	 * Prepare an empty workspace for merging the images that parallel
+	 * workers saved in fnames, numbering the files in the order
+	 * sequential processing would open them.
+	 */
+	static void prepare_merge(const vector <string> &fnames);
+	// Return true if fname is an image of the current contents of the workspace path
+	static bool is_image_of(const string &fname, const string &path);
+	/*
+	 * Retract from a restored workspace the results of the files that
+	 * changed since its image was saved.
+	 * Set stale to the compilation units that must be processed again.
+	 * The post-processing of all files must then be performed again.
+	 * Return true if any file changed.
+	 */
+	static bool retract_changed(Fileidset &stale);
+	// Record the identifiers of the linkage units, so that they can be saved
+	static void record_linkage() { recording = true; }
+	// Called when a linkage unit starts
+	static void enter_linkage_unit();
+	// Called when a linkage unit that defined the identifiers in s ends
+	static void exit_linkage_unit(const Stab &s);
+};
+
+#endif /* SNAPSHOT_ */
@@ -22,13 +22,25 @@
  */
 
 #include <cstring>
+#include <cstdio>		// perror, snprintf
+#include <cstdlib>		// exit
+#include <cmath>		// floor
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <map>
+#include <vector>
 
 #include "cpp.h"
 #include "sql.h"
+#ifdef SQLITE_DB
+#include "sqlitedb.h"
+#endif
 
 // An instance of the database interface
 Sql *Sql::instance;
+Sql::e_bulk_mode Sql::bulk_mode = Sql::bm_insert;
+string Sql::csv_dir;
 
 // Return SQL equivalent of character c
 const char *
@@ -72,6 +84,11 @@ Sql::escape(string s)
 bool
 Sql::setEngine(const char *dbengine)
 {
+#ifdef SQLITE_DB
+	if (strncmp(dbengine, "sqlite:", 7) == 0 && dbengine[7])
+		instance = new Sqlite(dbengine + 7);
+	else
+#endif
 	if (strcmp(dbengine, "mysql") == 0)
 		instance = new Mysql();
 	else if (strcmp(dbengine, "hsqldb") == 0)
@@ -80,8 +97,285 @@ Sql::setEngine(const char *dbengine)
 		instance = new Postgres();
 	else {
 		cerr << "Unknown database engine " << dbengine << "\n";
-		cerr << "Supported database engine types are: mysql postgres hsqldb\n";
+		cerr << "Supported database engine types are: mysql postgres hsqldb"
+#ifdef SQLITE_DB
+			" sqlite:file"
+#endif
+			"\n";
+		return false;
+	}
+	if (!instance->supports(bulk_mode)) {
+		cerr << "The specified bulk loading method is not supported by " << dbengine << "\n";
+		return false;
+	}
+	return true;
+}
+
+bool
+Sql::setBulkMode(const char *spec)
+{
+	if (strcmp(spec, "insert") == 0)
+		bulk_mode = bm_insert;
+	else if (strcmp(spec, "values") == 0)
+		bulk_mode = bm_values;
+	else if (strcmp(spec, "copy") == 0)
+		bulk_mode = bm_copy;
+	else if (strncmp(spec, "csv:", 4) == 0 && spec[4]) {
+		bulk_mode = bm_csv;
+		csv_dir = spec + 4;
+	} else {
+		cerr << "Unknown bulk loading method " << spec << "\n";
+		cerr << "Supported methods are: insert values copy csv:dir\n";
 		return false;
 	}
 	return true;
 }
+
+string
+Mysql::load_csv(const string &table, const string &path)
+{
+	return "LOAD DATA LOCAL INFILE '" + escape(path) + "' INTO TABLE " +
+		table + " FIELDS TERMINATED BY ',' OPTIONALLY ENCLOSED BY '\"'"
+		" ESCAPED BY '';\n";
+}
+
+// A psql command, so that the server needs no access to the file
+string
+Postgres::load_csv(const string &table, const string &path)
+{
+	return "\\copy " + table + " FROM '" + escape(path) + "' WITH (FORMAT csv)\n";
+}
+
+SqlTable &
+Sql::table(ostream &of, const char *name)
+{
+	map <string, SqlTable *>::const_iterator i = tables.find(name);
+	if (i != tables.end())
+		return *i->second;
+	SqlTable *t = new SqlTable(this, of, name);
+	tables.insert(make_pair(string(name), t));
+	return *t;
+}
+
+void
+Sql::flush_tables(bool final)
+{
+	for (vector <SqlTable *>::const_iterator i = used.begin(); i != used.end(); i++)
+		if (final)
+			(*i)->finish();
+		else
+			(*i)->flush();
+}
+
+SqlTable::SqlTable(Sql *d, ostream &o, const string &n) :
+	db(d), of(o), name(n), nrows(0), row_start(true), has_rows(false),
+	direct(d->inserter(n))
+{
+	if (direct || Sql::bulk_mode != Sql::bm_csv)
+		return;
+	csv_path = Sql::csv_dir + "/" + name + ".csv";
+	csv.open(csv_path.c_str(), ios::binary);
+	if (csv.fail()) {
+		perror(csv_path.c_str());
+		exit(1);
+	}
+}
+
+void
+SqlTable::field()
+{
+	if (!row_start) {
+		rows += Sql::bulk_mode == Sql::bm_copy ? '\t' : ',';
+		return;
+	}
+	row_start = false;
+	if (!has_rows) {
+		has_rows = true;
+		db->used.push_back(this);
+	}
+	switch (Sql::bulk_mode) {
+	case Sql::bm_insert:
+		rows += "INSERT INTO " + name + " VALUES(";
+		break;
+	case Sql::bm_values:
+		if (nrows)
+			rows += ",\n(";
+		else
+			rows += "INSERT INTO " + name + " VALUES\n(";
+		break;
+	case Sql::bm_copy:
+	case Sql::bm_csv:
+		break;
+	}
+}
+
+// Append to s the decimal representation of v
+static void
+append_number(string &s, unsigned long long v)
+{
+	char buff[24];
+	char *p = buff + sizeof(buff);
+
+	do {
+		*--p = '0' + v % 10;
+		v /= 10;
+	} while (v);
+	s.append(p, buff + sizeof(buff) - p);
+}
+
+SqlTable &
+SqlTable::operator <<(unsigned long long v)
+{
+	if (direct) {
+		direct->bind((long long)v);
+		return *this;
+	}
+	field();
+	append_number(rows, v);
+	return *this;
+}
+
+SqlTable &
+SqlTable::operator <<(long long v)
+{
+	if (direct) {
+		direct->bind(v);
+		return *this;
+	}
+	field();
+	if (v < 0) {
+		rows += '-';
+		append_number(rows, -(unsigned long long)v);
+	} else
+		append_number(rows, v);
+	return *this;
+}
+
+// Written as integers when possible; our metrics are counts
+SqlTable &
+SqlTable::operator <<(double v)
+{
+	if (v == floor(v) && v >= -1e18 && v <= 1e18)
+		return *this << (long long)v;
+	if (direct) {
+		direct->bind(v);
+		return *this;
+	}
+	char buff[32];
+	snprintf(buff, sizeof(buff), "%g", v);
+	field();
+	rows += buff;
+	return *this;
+}
+
+SqlTable &
+SqlTable::operator <<(bool v)
+{
+	if (direct) {
+		direct->bind((long long)v);
+		return *this;
+	}
+	field();
+	rows += db->boolval(v);
+	return *this;
+}
+
+SqlTable &
+SqlTable::operator <<(const string &s)
+{
+	if (direct) {
+		direct->bind(s);
+		return *this;
+	}
+	field();
+	switch (Sql::bulk_mode) {
+	case Sql::bm_insert:
+	case Sql::bm_values:
+		rows += '\'';
+		for (string::const_iterator i = s.begin(); i != s.end(); i++)
+			rows += db->escape(*i);
+		rows += '\'';
+		break;
+	case Sql::bm_copy:
+		for (string::const_iterator i = s.begin(); i != s.end(); i++)
+			switch (*i) {
+			case '\\': rows += "\\\\"; break;
+			case '\t': rows += "\\t"; break;
+			case '\n': rows += "\\n"; break;
+			case '\r': rows += "\\r"; break;
+			default: rows += *i; break;
+			}
+		break;
+	case Sql::bm_csv:
+		rows += '"';
+		for (string::const_iterator i = s.begin(); i != s.end(); i++)
+			if (*i == '"')
+				rows += "\"\"";
+			else
+				rows += *i;
+		rows += '"';
+		break;
+	}
+	return *this;
+}
+
+void
+SqlTable::end_row()
+{
+	if (direct) {
+		direct->end_row();
+		return;
+	}
+	switch (Sql::bulk_mode) {
+	case Sql::bm_insert:
+		rows += ");\n";
+		break;
+	case Sql::bm_values:
+		rows += ')';
+		break;
+	case Sql::bm_copy:
+	case Sql::bm_csv:
+		rows += '\n';
+		break;
+	}
+	row_start = true;
+	if ((++nrows >= max_values && Sql::bulk_mode == Sql::bm_values) ||
+	    rows.size() >= max_buffered)
+		db->flush_tables();
+}
+
+void
+SqlTable::flush()
+{
+	if (nrows == 0)
+		return;
+	switch (Sql::bulk_mode) {
+	case Sql::bm_insert:
+		of.write(rows.data(), rows.size());
+		break;
+	case Sql::bm_values:
+		of.write(rows.data(), rows.size());
+		of << ";\n";
+		break;
+	case Sql::bm_copy:
+		of << "COPY " << name << " FROM STDIN;\n";
+		of.write(rows.data(), rows.size());
+		of << "\\.\n";
+		break;
+	case Sql::bm_csv:
+		csv.write(rows.data(), rows.size());
+		break;
+	}
+	rows.clear();
+	nrows = 0;
+}
+
+void
+SqlTable::finish()
+{
+	flush();
+	if (Sql::bulk_mode != Sql::bm_csv || !csv.is_open())
+		return;
+	csv.close();
+	of << db->load_csv(name, csv_path);
+}
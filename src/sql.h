@@ -25,15 +25,75 @@
 #ifndef SQL_
 #define SQL_
 
+#include <iostream>
+#include <string>
+#include <map>
+#include <vector>
+#include <fstream>
+
+using namespace std;
+
+class SqlTable;
+
+// Prepared insertion of rows into a table of a directly written database
+class SqlInserter {
+public:
+	virtual ~SqlInserter() {}
+	// Set the value of the row's next field
+	virtual void bind(long long v) = 0;
+	virtual void bind(double v) = 0;
+	virtual void bind(const string &s) = 0;
+	// Insert the row
+	virtual void end_row() = 0;
+};
+
 class Sql {
+public:
+	// How table rows are written
+	enum e_bulk_mode {
+		bm_insert,		// One INSERT statement per row
+		bm_values,		// Multi-row INSERT statements
+		bm_copy,		// PostgreSQL COPY FROM STDIN blocks
+		bm_csv			// Per-table CSV files and load statements
+	};
+private:
 	// Instance of current engine
 	static Sql *instance;
+	static e_bulk_mode bulk_mode;
+	static string csv_dir;		// Directory of the CSV files
+	map <string, SqlTable *> tables;	// Tables obtained through table()
+	vector <SqlTable *> used;	// Tables in the order of their first row
+	friend class SqlTable;
 public:
 	virtual ~Sql() {}
 	// Set the database to the specified engine
 	// Return true if OK
 	static bool setEngine(const char *dbengine);
 	static Sql *getInterface() { return instance; }
+	// Set the way table rows are written: insert, values, copy, csv:dir
+	// Return true if OK
+	static bool setBulkMode(const char *spec);
+	static e_bulk_mode getBulkMode() { return bulk_mode; }
+	// Return true if the engine can load rows in the specified way
+	virtual bool supports(e_bulk_mode m) { return m == bm_insert || m == bm_values; }
+	// Return the statement loading table from the CSV file at path
+	virtual string load_csv(const string &table, const string &path) { return ""; }
+	// Execute the specified SQL commands; text engines write them out
+	virtual void execute(const string &commands) { cout << commands; }
+	// Return an inserter for the named table's rows, if the engine
+	// writes the database directly, or NULL if it outputs SQL text
+	virtual SqlInserter *inserter(const string &table) { return NULL; }
+	// Return true if the engine writes the database, rather than SQL text
+	virtual bool writes_database() { return false; }
+	// Complete the unit of work comprising the rows written so far
+	virtual void commit() {}
+	// Complete the database after the end commands
+	virtual void close() {}
+	// Return the row writer for the named table
+	SqlTable &table(ostream &of, const char *name);
+	// Write out all buffered rows, in an order satisfying the
+	// integrity constraints; when final also load any CSV files
+	void flush_tables(bool final = false);
 	virtual const char * begin_commands() { return ""; };
 	virtual const char * end_commands() { return ""; };
 	virtual string escape(string s);
@@ -54,6 +114,8 @@ public:
 	const char *booltype() { return "bool"; }
 	const char *varchar() { return "TEXT"; }
 	const char *boolval(bool v);
+	bool supports(e_bulk_mode m) { return m != bm_copy; }
+	string load_csv(const string &table, const string &path);
 };
 
 class Hsqldb: public Sql {
@@ -64,6 +126,61 @@ public:
 
 class Postgres: public Sql {
 public:
+	bool supports(e_bulk_mode m) { return true; }
+	string load_csv(const string &table, const string &path);
+};
+
+/*
+ * A buffered writer for the rows of a database table.
+ * Fields are added with <<; strings are quoted and escaped
+ * as required by the bulk mode, and booleans are written
+ * in the engine's notation.
+ * Rows are formatted into a buffer, which is written out
+ * together with those of all other tables when it fills up.
+ * Tables are written in the order they received their first row.
+ * Provided that parent rows are always added before the rows
+ * referencing them, this order satisfies the integrity constraints.
+ * Engines that write the database directly receive the rows
+ * field by field through an SqlInserter instead.
+ */
+class SqlTable {
+private:
+	Sql *db;		// Database interface
+	ostream &of;		// Stream for writing SQL statements
+	string name;		// Table name
+	string rows;		// Formatted rows that have not been written
+	int nrows;		// Number of rows in rows
+	bool row_start;		// True before a row's first field
+	bool has_rows;		// True after the table received a row
+	string csv_path;	// CSV file path, for bm_csv
+	ofstream csv;		// CSV file stream, for bm_csv
+	SqlInserter *direct;	// Direct database inserter or NULL
+
+	// Maximum number of rows in a multi-row INSERT statement
+	static const int max_values = 1000;
+	// Buffered bytes causing the tables to be written out
+	static const size_t max_buffered = 1024 * 1024;
+
+	// Begin adding a new field
+	void field();
+public:
+	SqlTable(Sql *d, ostream &o, const string &n);
+	SqlTable &operator <<(int v) { return *this << (long long)v; }
+	SqlTable &operator <<(unsigned v) { return *this << (unsigned long long)v; }
+	SqlTable &operator <<(long v) { return *this << (long long)v; }
+	SqlTable &operator <<(unsigned long v) { return *this << (unsigned long long)v; }
+	SqlTable &operator <<(long long v);
+	SqlTable &operator <<(unsigned long long v);
+	SqlTable &operator <<(double v);
+	SqlTable &operator <<(bool v);
+	SqlTable &operator <<(const string &s);
+	SqlTable &operator <<(const char *s) { return *this << string(s); }
+	// Complete the current row
+	void end_row();
+	// Write out the buffered rows
+	void flush();
+	// Write out the buffered rows and load the table's CSV file
+	void finish();
 };
 
 
@@ -0,0 +1,174 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * Direct SQLite database output
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>		// remove
+
+#include <sqlite3.h>
+
+#include "cpp.h"
+#include "error.h"
+#include "sql.h"
+#include "sqlitedb.h"
+
+// Inserter of a table's rows through a prepared statement
+class SqliteInserter: public SqlInserter {
+private:
+	sqlite3 *db;		// Database handle
+	sqlite3_stmt *stmt;	// Prepared INSERT statement
+	int col;		// Index of the last bound column
+public:
+	SqliteInserter(sqlite3 *d, const string &table);
+	~SqliteInserter() { sqlite3_finalize(stmt); }
+	void bind(long long v) { sqlite3_bind_int64(stmt, ++col, v); }
+	void bind(double v) { sqlite3_bind_double(stmt, ++col, v); }
+	void bind(const string &s) {
+		sqlite3_bind_text(stmt, ++col, s.data(), s.length(), SQLITE_TRANSIENT);
+	}
+	void end_row();
+};
+
+SqliteInserter::SqliteInserter(sqlite3 *d, const string &table) :
+	db(d), stmt(NULL), col(0)
+{
+	// Obtain the number of the table's columns
+	string sql("SELECT * FROM " + table);
+	if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK)
+		Sqlite::fatal(db, sql);
+	int ncol = sqlite3_column_count(stmt);
+	sqlite3_finalize(stmt);
+
+	sql = "INSERT INTO " + table + " VALUES(";
+	for (int i = 0; i < ncol; i++)
+		sql += i ? ",?" : "?";
+	sql += ')';
+	if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK)
+		Sqlite::fatal(db, sql);
+}
+
+void
+SqliteInserter::end_row()
+{
+	if (sqlite3_step(stmt) != SQLITE_DONE)
+		Sqlite::fatal(db, sqlite3_sql(stmt));
+	sqlite3_reset(stmt);
+	col = 0;
+}
+
+Sqlite::Sqlite(const char *fname) : path(fname)
+{
+	(void)remove(fname);
+	if (sqlite3_open(fname, &db) != SQLITE_OK)
+		fatal(db, "open");
+	// The database is rebuilt from scratch after a failure
+	exec("PRAGMA synchronous=OFF;"
+		"PRAGMA journal_mode=MEMORY;"
+		"BEGIN;");
+}
+
+void
+Sqlite::fatal(sqlite3 *db, const string &msg)
+{
+	/*
+	 * @error
+	 * The SQLite database specified with the -s option
+	 * could not be created or written
+	 */
+	Error::error(E_FATAL, "SQLite " + msg + ": " + sqlite3_errmsg(db), false);
+}
+
+void
+Sqlite::exec(const string &sql)
+{
+	if (sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL) != SQLITE_OK)
+		fatal(db, path);
+}
+
+string
+Sqlite::defer_keys(const string &sql)
+{
+	static const string pk("PRIMARY KEY(");
+	string r;
+	string::size_type pos = 0, k;
+
+	while ((k = sql.find(pk, pos)) != string::npos) {
+		string::size_type cols = k + pk.length();
+		string::size_type end = sql.find(')', cols);
+		string::size_type tstart = sql.rfind("CREATE TABLE ", k);
+		if (end == string::npos || tstart == string::npos)
+			break;
+		tstart += 13;
+		string table(sql, tstart, sql.find('(', tstart) - tstart);
+		indexes.push_back("CREATE UNIQUE INDEX " + table + "_PK ON " +
+			table + "(" + sql.substr(cols, end - cols) + ");");
+		r.append(sql, pos, k - pos);
+		// Remove the constraint's separator
+		end = sql.find_first_not_of(" \n", end + 1);
+		if (end != string::npos && sql[end] == ',')
+			end = sql.find_first_not_of(" \n", end + 1);
+		else {
+			string::size_type comma = r.find_last_not_of(" \n");
+			if (comma != string::npos && r[comma] == ',')
+				r.erase(comma);
+		}
+		pos = end;
+	}
+	if (pos != string::npos)
+		r.append(sql, pos, string::npos);
+	return r;
+}
+
+void
+Sqlite::execute(const string &commands)
+{
+	exec(defer_keys(commands));
+}
+
+SqlInserter *
+Sqlite::inserter(const string &table)
+{
+	SqlInserter *i = new SqliteInserter(db, table);
+	inserters.push_back(i);
+	return i;
+}
+
+void
+Sqlite::commit()
+{
+	exec("COMMIT;BEGIN;");
+}
+
+void
+Sqlite::close()
+{
+	for (vector <SqlInserter *>::iterator i = inserters.begin(); i != inserters.end(); i++)
+		delete *i;
+	inserters.clear();
+	for (vector <string>::const_iterator i = indexes.begin(); i != indexes.end(); i++)
+		exec(*i);
+	exec("COMMIT;");
+	if (sqlite3_close(db) != SQLITE_OK)
+		fatal(db, path);
+}
@@ -0,0 +1,66 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * An SQLite engine that writes the database directly.
+ * Rows are inserted through prepared statements, one transaction
+ * per file.  The composite primary keys are created as unique indexes
+ * after all rows have been inserted, which is faster than maintaining
+ * them during the insertions.
+ * Compiled when SQLITE_DB is defined.
+ *
+ */
+
+#ifndef SQLITEDB_
+#define SQLITEDB_
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#include <sqlite3.h>
+
+#include "sql.h"
+
+class Sqlite: public Sql {
+private:
+	sqlite3 *db;			// Database handle
+	string path;			// Database file
+	vector <string> indexes;	// Deferred index creation statements
+	vector <SqlInserter *> inserters;	// Prepared table inserters
+
+	// Execute the statements in sql, exiting on error
+	void exec(const string &sql);
+	// Remove the composite primary keys from the CREATE TABLE
+	// statements in sql, deferring the creation of equivalent indexes
+	string defer_keys(const string &sql);
+public:
+	// Create the database in the specified file, replacing it
+	Sqlite(const char *fname);
+	bool supports(e_bulk_mode m) { return m == bm_insert; }
+	void execute(const string &commands);
+	SqlInserter *inserter(const string &table);
+	bool writes_database() { return true; }
+	void commit();
+	void close();
+	// Exit reporting the database's last error
+	static void fatal(sqlite3 *db, const string &msg);
+};
+
+#endif // SQLITEDB_
@@ -55,6 +55,8 @@
 #include "mcall.h"
 #include "globobj.h"
 #include "ctag.h"
+#include "unitcache.h"
+#include "snapshot.h"
 
 
 int Block::current_block = -1;
@@ -74,6 +76,8 @@ Block::enter()
 {
 	scope_block.push_back(Block());
 	current_block++;
+	if (current_block == lu_block)
+		Snapshot::enter_linkage_unit();
 }
 
 // Called when entering a function block statement
@@ -90,6 +94,8 @@ Block::param_enter()
 void
 Block::exit()
 {
+	if (current_block == lu_block)
+		Snapshot::exit_linkage_unit(scope_block[lu_block].obj);
 	scope_block.pop_back();
 	current_block--;
 }
@@ -133,6 +139,21 @@ Block::clear()
 	current_block = -1;
 }
 
+/*
+ * Enter id into the linkage unit, unifying it with an existing definition
+ * (Used for replaying cached compilation units)
+ */
+void
+Block::link(const Id& id)
+{
+	Id const *prev;
+
+	if ((prev = scope_block[lu_block].obj.lookup(id.get_name())) != NULL)
+		Token::unify(prev->get_token(), id.get_token());
+	else
+		scope_block[lu_block].obj.define(id.get_token(), id.get_type(), id.get_fcall(), id.get_glob());
+}
+
 /*
  * Define the tok object to be of type typ
  */
@@ -264,7 +285,7 @@ obj_define(const Token& tok, Type typ)
 				fc = new FCall(utok, typ, tok.get_name());
 			}
 		}
-		fc->metrics().set_metric(FunMetrics::em_nparam, typ.get_nparam());
+		fc->set_nparam(typ.get_nparam());
 	}
 
 	static Stab Block::*objptr = &Block::obj;
@@ -278,6 +299,7 @@ obj_define(const Token& tok, Type typ)
 		GlobObj *go = NULL;
 		if ((id = Block::scope_block[Block::lu_block].obj.lookup(tok.get_name())) != NULL) {
 			Token::unify(id->get_token(), tok);
+			UnitCache::link(tok, id);
 			go = id->get_glob();
 		} else {
 			/*
@@ -298,6 +320,7 @@ obj_define(const Token& tok, Type typ)
 				}
 			}
 			id = Block::scope_block[Block::lu_block].obj.define(tok, typ, fc, go);
+			UnitCache::link(id);
 		}
 		/*
 		 * We test go, because it might be null if the object is defined as a function in one
@@ -192,6 +192,19 @@ public:
 
 	static int get_cur_block() { return current_block; }
 
+	// Return true if the compilation unit scope is current and empty
+	static bool cu_scope_clean() {
+		return current_block == cu_block &&
+		    scope_block[cu_block].obj.size() == 0 &&
+		    scope_block[cu_block].tag.size() == 0;
+	}
+	// Return the linkage unit definition of name or NULL
+	static Id const *lu_lookup(const string& name) {
+		return current_block < lu_block ? NULL : scope_block[lu_block].obj.lookup(name);
+	}
+	// Enter id into the linkage unit, as obj_define does for extern identifiers
+	static void link(const Id& id);
+
 	// Lookup and define of objects and struct/union/enum tags
 	friend Id const * obj_lookup(const string& name);
 	friend void obj_define(const Token& tok, Type t);
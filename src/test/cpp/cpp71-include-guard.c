@@ -0,0 +1,24 @@
+#include "guard-ifndef.h"
+#include "guard-ifndef.h"
+#include "guard-nested.h"
+#include "guard-nested.h"
+#include "guard-defined.h"
+#include "guard-defined.h"
+#include "guard-trail.h"
+#include "guard-trail.h"
+#include "guard-else.h"
+#include "guard-else.h"
+#include "guard-undef.h"
+#undef GUARD_UNDEF_H
+#include "guard-undef.h"
+#include "guard-undef.h"
+#include "guard-once.h"
+#include "guard-once.h"
+#ifdef PRJ2
+#define GUARD_PREDEF_H
+#else
+#define GUARD_PREDEF_H
+#endif
+#include "guard-predef.h"
+
+int array[IFNDEF_SIZE];
@@ -0,0 +1,5 @@
+// Include guard through #if !defined
+#if !defined( GUARD_DEFINED_H )
+#define GUARD_DEFINED_H
+extern int defined_var;
+#endif
@@ -0,0 +1,7 @@
+/* Not a guard: the #ifndef has an #else */
+#ifndef GUARD_ELSE_H
+#define GUARD_ELSE_H
+extern int else_first;
+#else
+extern int else_again;
+#endif
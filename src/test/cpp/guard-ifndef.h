@@ -0,0 +1,8 @@
+/* Classic include guard */
+#ifndef GUARD_IFNDEF_H
+#define GUARD_IFNDEF_H
+
+#define IFNDEF_SIZE 10
+extern int ifndef_var;
+
+#endif /* GUARD_IFNDEF_H */
@@ -0,0 +1,6 @@
+/* Include a header that has already been read */
+#ifndef GUARD_NESTED_H
+#define GUARD_NESTED_H
+#include "guard-ifndef.h"
+extern int nested_var[IFNDEF_SIZE];
+#endif
@@ -0,0 +1,5 @@
+/* Include guard that the includer has already defined */
+#ifndef GUARD_PREDEF_H
+#define GUARD_PREDEF_H
+extern int predef_var;
+#endif
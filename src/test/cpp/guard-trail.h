@@ -0,0 +1,6 @@
+/* Not a guard: code follows the #endif */
+#ifndef GUARD_TRAIL_H
+#define GUARD_TRAIL_H
+extern int trail_var;
+#endif
+extern int trail_after;
@@ -0,0 +1,5 @@
+/* Include guard that the includer undefines */
+#ifndef GUARD_UNDEF_H
+#define GUARD_UNDEF_H
+extern int undef_var;
+#endif
@@ -46,6 +46,7 @@
 #include "fdep.h"
 #include "idquery.h"
 #include "fchar.h"
+#include "profile.h"
 
 bool Token::check_clashes;
 bool Token::found_clashes;
@@ -214,6 +215,7 @@ Tpart::homogenize(const dequeTpart &a, const dequeTpart &b)
 void
 Token::unify(const Token &a /* definition */, const Token &b /* reference */)
 {
+	PhaseTimer timer(Profile::ph_unify);
 	if (DP()) cout << "Unify " << a << " and " << b << "\n";
 	// Get the constituent Tokids; they may have grown more than the parts
 	dequeTpart ac = a.constituents();
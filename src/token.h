@@ -55,6 +55,7 @@ typedef deque<Tpart> dequeTpart;
 ostream& operator<<(ostream& o,const dequeTpart& dt);
 
 class Token {
+	friend class Snapshot;
 protected:
 	int code;			// Token type code
 	dequeTpart parts;		// Identifiers for constituent parts
@@ -76,6 +77,12 @@ public:
 	{
 		parts.push_front(Tpart(Tokid(0, 0), v.length()));
 	}
+	// Construct it from a name located at the specified Tokid
+	Token(int icode, const string& v, Tokid t)
+		: code(icode), val(v)
+	{
+		parts.push_front(Tpart(t, v.length()));
+	}
 	Token() {};
 	// Accessor method
 	int get_code() const { return (code); }
@@ -46,8 +46,11 @@
 #include "macro.h"
 #include "pdtoken.h"
 #include "eclass.h"
+#include "unitcache.h"
+#include "snapshot.h"
 
 
+unsigned long Tokid::nmerged;		// Merged classes map entries may refer to
 mapTokidEclass Tokid::tm;		// Map from tokens to their equivalence
 
 mapTokidEclass tokid_map;		// Dummy; used for printing
@@ -62,30 +65,91 @@ operator<<(ostream& o,const Tokid t)
 ostream&
 operator<<(ostream& o,const mapTokidEclass& t)
 {
-	mapTokidEclass::const_iterator i;
-
-	for (i = Tokid::tm.begin(); i != Tokid::tm.end(); i++) {
-		// Convert Tokids into Tparts to also display their content
-		Tokid t = (*i).first;
-		Eclass e = *((*i).second);
-		Tpart p(t, e.get_len());
-		o << p << ":\n";
-		o << e << "\n\n";
+	// Show the class roots, which hold the complete members
+	Tokid::resolve_all();
+	for (mapTokidEclass::size_type fid = 0; fid < Tokid::tm.size(); fid++) {
+		const FileEcIndex &fidx = Tokid::tm[fid];
+		for (FileEcIndex::size_type i = 0; i < fidx.slots(); i++) {
+			if (fidx.ec(i) == NULL)
+				continue;
+			// Convert Tokids into Tparts to also display their content
+			Tokid t(Fileid((int)fid), fidx.offset(i));
+			Eclass e = *fidx.ec(i);
+			Tpart p(t, e.get_len());
+			o << p << ":\n";
+			o << e << "\n\n";
+		}
 	}
 	return o;
 }
 
+// Remove the holes from the index
+void
+FileEcIndex::compact()
+{
+	size_type to = 0;
+	for (size_type from = 0; from < offs.size(); from++)
+		if (ecs[from]) {
+			offs[to] = offs[from];
+			ecs[to] = ecs[from];
+			to++;
+		}
+	offs.resize(to);
+	ecs.resize(to);
+	nholes = 0;
+}
+
+// Return the number of tokids mapped to an EC
+FileEcIndex::size_type
+Tokid::map_size()
+{
+	FileEcIndex::size_type n = 0;
+	for (mapTokidEclass::const_iterator i = tm.begin(); i != tm.end(); i++)
+		n += i->size();
+	return n;
+}
+
+#ifdef PICO_QL
+// Copy the contents of the class map into an ordered map
+void
+Tokid::copy_map(map <Tokid, Eclass *> &m)
+{
+	resolve_all();
+	for (mapTokidEclass::size_type fid = 0; fid < tm.size(); fid++)
+		for (FileEcIndex::size_type i = 0; i < tm[fid].slots(); i++)
+			if (tm[fid].ec(i))
+				m.insert(m.end(), map <Tokid, Eclass *>::value_type(
+				    Tokid(Fileid((int)fid), tm[fid].offset(i)), tm[fid].ec(i)));
+}
+#endif
+
+// Point all map entries to their class roots and materialize the classes
+void
+Tokid::resolve_all()
+{
+	if (nmerged == 0)
+		return;
+	for (mapTokidEclass::iterator i = tm.begin(); i != tm.end(); i++)
+		for (FileEcIndex::size_type j = 0; j < i->slots(); j++)
+			if (i->ec(j))
+				resolve(i->ec_slot(j))->materialize();
+	csassert(nmerged == 0);
+}
+
 // Clear the map of tokid equivalence classes
 void
 Tokid::clear()
 {
-	mapTokidEclass::const_iterator i;
 	set <Eclass *> es;
 
-	if (DP()) cout << "Have " << Tokid::tm.size() << " tokids\n";
+	resolve_all();
+
+	if (DP()) cout << "Have " << Tokid::map_size() << " tokids\n";
 	// First create a set of all ecs
-	for (i = Tokid::tm.begin(); i != Tokid::tm.end(); i++)
-		es.insert((*i).second);
+	for (mapTokidEclass::const_iterator i = tm.begin(); i != tm.end(); i++)
+		for (FileEcIndex::size_type j = 0; j < i->slots(); j++)
+			if (i->ec(j))
+				es.insert(i->ec(j));
 	// Then free them
 	if (DP()) cout << "Deleting " << es.size() << " classes\n";
 	set <Eclass *>::const_iterator si;
@@ -102,9 +166,9 @@ Tokid::constituents(int l)
 {
 	Tokid t = *this;
 	dequeTpart r;
-	mapTokidEclass::const_iterator e = tm.find(t);
+	Eclass *e = t.check_ec();
 
-	if (e == Tokid::tm.end()) {
+	if (e == NULL) {
 		// No EC defined, create a new one
 		new Eclass(t, l);
 		Tpart tp(t, l);
@@ -114,11 +178,12 @@ Tokid::constituents(int l)
 	// Make r be the Tparts of the ECs covering our tokid t
 	for (;;) {
 		if (DP())
-			cout << "Tokid = " << (e->first) << " Eclass = " << e->second << "\n" << (*(e->second)) << "\n";
-		int covered = (e->second)->get_len();
-		if (!Pdtoken::skipping()) {
+			cout << "Tokid = " << t << " Eclass = " << e << "\n" << (*e) << "\n";
+		int covered = e->get_len();
+		if (!Pdtoken::skipping() && !Snapshot::merging()) {
 			// Add the existing classes to our current project
-			(e->second)->set_attribute(Project::get_current_projid());
+			e->set_attribute(Project::get_current_projid());
+			UnitCache::touch(t, covered);
 			if (DP())
 				cout << "Set projid to " << Project::get_current_projid() << "\n";
 		}
@@ -131,10 +196,10 @@ Tokid::constituents(int l)
 		if (l == 0)
 			return (r);
 		t += covered;
-		e = tm.find(t);
-		// csassert(e != Tokid::tm.end());
+		e = t.check_ec();
+		// csassert(e != NULL);
 		// Can only happen if we are deleting ECs with -m
-		if (e == Tokid::tm.end()) {
+		if (e == NULL) {
 			// No EC defined, create a new one covering the rest
 			new Eclass(t, l);
 			Tpart tp(t, l);
@@ -149,26 +214,25 @@ void
 Tokid::set_ec_attribute(enum e_attribute a, int l) const
 {
 	Tokid t = *this;
-	dequeTpart r;
-	mapTokidEclass::const_iterator e = tm.find(t);
+	Eclass *e = t.check_ec();
 
-	if (e == Tokid::tm.end()) {
+	if (e == NULL) {
 		// No EC defined, create a new one
-		Eclass *e = new Eclass(t, l);
+		e = new Eclass(t, l);
 		e->set_attribute(a);
 		return;
 	}
 	// Set the ECs covering our tokid t
 	for (;;) {
-		int covered = (e->second)->get_len();
-		(e->second)->set_attribute(a);
+		int covered = e->get_len();
+		e->set_attribute(a);
 		l -= covered;
 		csassert(l >= 0);
 		if (l == 0)
 			return;
 		t += covered;
-		e = tm.find(t);
-		csassert(e != Tokid::tm.end());
+		e = t.check_ec();
+		csassert(e != NULL);
 	}
 }
 
@@ -177,24 +241,23 @@ bool
 Tokid::has_ec_attribute(enum e_attribute a, int l) const
 {
 	Tokid t = *this;
-	dequeTpart r;
-	mapTokidEclass::const_iterator e = tm.find(t);
+	Eclass *e = t.check_ec();
 
-	if (e == Tokid::tm.end())
-		// No EC defined, create a new one
+	if (e == NULL)
+		// No EC defined
 		return false;
 	// Check the ECs covering our tokid t
 	for (;;) {
-		int covered = (e->second)->get_len();
-		if ((e->second)->get_attribute(a))
+		int covered = e->get_len();
+		if (e->get_attribute(a))
 			return true;
 		l -= covered;
 		csassert(l >= 0);
 		if (l == 0)
 			return false;
 		t += covered;
-		e = tm.find(t);
-		csassert(e != Tokid::tm.end());
+		e = t.check_ec();
+		csassert(e != NULL);
 	}
 }
 
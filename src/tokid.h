@@ -39,6 +39,9 @@
 
 #include <deque>
 #include <map>
+#include <vector>
+#include <algorithm>
+#include <climits>
 
 using namespace std;
 
@@ -52,10 +55,55 @@ class Tpart;
 typedef deque <Tokid> dequeTokid;
 typedef deque <Tpart> dequeTpart;
 
-class Tokid;
-typedef map <Tokid, Eclass *> mapTokidEclass;
+/*
+ * The equivalence classes of a single file's tokids, keyed by offset.
+ * Tokids are mostly added in increasing offset order as a file is
+ * read, so a pair of sorted vectors gives a compact index that is
+ * cheap to append to and binary search.
+ * Erased entries are kept as NULL holes, which are reused when the
+ * same offset is set again and squeezed out when they dominate the index.
+ */
+class FileEcIndex {
+	friend class MemStat;
+public:
+	typedef vector <unsigned>::size_type size_type;
+private:
+	vector <unsigned> offs;		// Sorted offsets (files are < 4GB)
+	vector <Eclass *> ecs;		// Corresponding ECs or NULL for holes
+	size_type nholes;		// Number of NULL elements in ecs
+	// Remove the holes from the index
+	void compact();
+public:
+	FileEcIndex() : nholes(0) {}
+	// Return the address of the EC slot for offset o or NULL
+	inline Eclass **find(cs_offset_t o);
+	// Set the EC of offset o to ec
+	inline void set(cs_offset_t o, Eclass *ec);
+	// Remove the EC held in the specified slot
+	inline void erase(Eclass **slot);
+	// Number of slots (including holes) and their contents
+	size_type slots() const { return offs.size(); }
+	cs_offset_t offset(size_type i) const { return offs[i]; }
+	Eclass *ec(size_type i) const { return ecs[i]; }
+	Eclass **ec_slot(size_type i) { return &ecs[i]; }
+	// Return the first slot whose offset is not less than o
+	size_type position(cs_offset_t o) const {
+		return lower_bound(offs.begin(), offs.end(), (unsigned)o) - offs.begin();
+	}
+	// Number of ECs stored
+	size_type size() const { return offs.size() - nholes; }
+};
+
+/*
+ * Map from Tokids to their equivalence classes.
+ * Organized as a per-Fileid (dense integer) vector of offset indices.
+ */
+typedef vector <FileEcIndex> mapTokidEclass;
 
 class Tokid {
+	friend class Snapshot;
+	friend class FileScan;
+	friend class MemStat;
 #ifdef PICO_QL
 public:
 #else
@@ -66,6 +114,12 @@ private:
 					// classes
 	Fileid fi;			// File
 	cs_offset_t offs;		// Offset
+	// Merged classes that map entries may still refer to
+	static unsigned long nmerged;
+	// Return the root of the class a map slot refers to, pointing the slot to it
+	static Eclass *resolve(Eclass **slot);
+	friend Eclass *merge(Eclass *a, Eclass *b);
+	friend class Eclass;
 public:
 	// Construct it, based on the fileid and offset in that file
 	Tokid(Fileid i, streampos l) : fi(i), offs((cs_offset_t)l) {};
@@ -95,12 +149,13 @@ public:
 	// Set its equivalence class to ec (done when adding it to an Eclass)
 	// use Eclass:add_tokid, not this method in all other contexts
 	inline void set_ec(Eclass *ec) const;
-	// Return an iterator for accessing the map or the end_ec() value
-	inline mapTokidEclass::iterator find_ec() const;
+	// Return the map slot holding the tokid's EC or the end_ec() value
+	typedef Eclass **ec_iterator;
+	inline ec_iterator find_ec() const;
 	// The not-found value
-	inline mapTokidEclass::iterator end_ec();
+	static ec_iterator end_ec() { return NULL; }
 	// Erase the tokid's EC from the map
-	inline void erase_ec(mapTokidEclass::iterator i) const;
+	inline void erase_ec(ec_iterator i) const;
 	inline void erase_ec(Eclass *e) const;
 	// Returns the Tokids participating in all ECs for a token of length l
 	dequeTpart constituents(int l);
@@ -110,15 +165,25 @@ public:
 	bool has_ec_attribute(enum e_attribute a, int l) const;
 	// Clear the map of tokid equivalence classes
 	static void clear();
+	/*
+	 * Point all map entries to the roots of their classes, and move
+	 * the members of merged classes into them.
+	 * Must be called before accessing the map from multiple threads.
+	 */
+	static void resolve_all();
 	// Print the contents of the class map
-	friend ostream& operator<<(ostream& o,const map <Tokid, Eclass *>& dummy);
+	friend ostream& operator<<(ostream& o,const mapTokidEclass& dummy);
+#ifdef PICO_QL
+	// Copy the contents of the class map into an ordered map
+	static void copy_map(map <Tokid, Eclass *> &m);
+#endif
 	// Return true if the underlying file is read-only
 	bool get_readonly() const { return fi.get_readonly(); }
 	// Accessor functions
 	inline const string& get_path() const { return fi.get_path(); }
 	inline Fileid get_fileid() const { return fi; }
 	inline streampos get_streampos() const { return (streampos)offs; }
-	static map <Tokid, Eclass *>::size_type map_size() { return tm.size(); }
+	static FileEcIndex::size_type map_size();
 };
 
 // Print dequeTokid sequences
@@ -188,60 +253,98 @@ operator >=(const class Tokid a, const class Tokid b)
 	return b < a || a == b;
 }
 
+inline Eclass **
+FileEcIndex::find(cs_offset_t o)
+{
+	// Common case: beyond the last identifier seen so far
+	if (offs.empty() || (unsigned)o > offs.back())
+		return NULL;
+	vector <unsigned>::iterator i = lower_bound(offs.begin(), offs.end(), (unsigned)o);
+	if (*i != (unsigned)o)
+		return NULL;
+	Eclass **slot = &ecs[i - offs.begin()];
+	return *slot ? slot : NULL;
+}
+
+inline void
+FileEcIndex::set(cs_offset_t o, Eclass *ec)
+{
+	// Offsets are stored in 32 bits
+	csassert(o >= 0 && (unsigned long)o <= UINT_MAX);
+	// Common case: tokids are added while reading a file sequentially
+	if (offs.empty() || (unsigned)o > offs.back()) {
+		offs.push_back((unsigned)o);
+		ecs.push_back(ec);
+		return;
+	}
+	vector <unsigned>::iterator i = lower_bound(offs.begin(), offs.end(), (unsigned)o);
+	size_type pos = i - offs.begin();
+	if (*i == (unsigned)o) {
+		if (ecs[pos] == NULL)
+			nholes--;
+		ecs[pos] = ec;
+	} else {
+		offs.insert(i, (unsigned)o);
+		ecs.insert(ecs.begin() + pos, ec);
+	}
+}
+
+inline void
+FileEcIndex::erase(Eclass **slot)
+{
+	*slot = NULL;
+	if (++nholes > 64 && nholes > offs.size() / 2)
+		compact();
+}
+
 inline Eclass *
 Tokid::get_ec() const
 {
-	return tm[*this];
+	return check_ec();
 }
 
 inline Eclass *
 Tokid::check_ec() const
 {
-	mapTokidEclass::const_iterator i = tm.find(*this);
-	if (i == tm.end())
+	if (fi.get_id() >= (int)tm.size())
 		return NULL;
-	else
-		return ((*i).second);
+	Eclass **slot = tm[fi.get_id()].find(offs);
+	if (slot == NULL)
+		return NULL;
+	return nmerged ? resolve(slot) : *slot;
 }
 
 inline void
 Tokid::set_ec(Eclass *ec) const
 {
-	/*
-	 * tm[*this] = ec;
-	 * Efficiently implement the functionality we need.
-	 * See Meyers Effective STL, Item 24.
-	 */
-	mapTokidEclass::iterator i = tm.lower_bound(*this);
-	if (i != tm.end() && i->first == *this)
-		i->second = ec;
-	else
-		tm.insert(i, mapTokidEclass::value_type(*this, ec));
+	if (fi.get_id() >= (int)tm.size())
+		tm.resize(fi.get_id() + 1);
+	tm[fi.get_id()].set(offs, ec);
 }
 
 inline void
-Tokid::erase_ec(mapTokidEclass::iterator i) const
+Tokid::erase_ec(ec_iterator i) const
 {
-	tm.erase(i);
+	tm[fi.get_id()].erase(i);
 }
 
 inline void
 Tokid::erase_ec(Eclass *e) const
 {
-	mapTokidEclass::iterator i = tm.find(*this);
-	csassert(i != tm.end());
-	tm.erase(i);
+	ec_iterator i = find_ec();
+	csassert(i != end_ec());
+	erase_ec(i);
 }
 
-inline mapTokidEclass::iterator
+inline Tokid::ec_iterator
 Tokid::find_ec() const
 {
-	return tm.find(*this);
+	if (fi.get_id() >= (int)tm.size())
+		return end_ec();
+	ec_iterator i = tm[fi.get_id()].find(offs);
+	if (i && nmerged)
+		resolve(i);
+	return i;
 }
 
-inline mapTokidEclass::iterator
-Tokid::end_ec()
-{
-	return tm.end();
-}
 #endif /* TOKID_ */
@@ -0,0 +1,476 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * For documentation read the corresponding .h file
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <stack>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>		// getcwd, chdir
+
+#include "cpp.h"
+#include "debug.h"
+#include "error.h"
+#include "attr.h"
+#include "metrics.h"
+#include "fileid.h"
+#include "tokid.h"
+#include "token.h"
+#include "parse.tab.h"
+#include "ptoken.h"
+#include "fchar.h"
+#include "macro.h"
+#include "pdtoken.h"
+#include "eclass.h"
+#include "type.h"
+#include "stab.h"
+#include "fdep.h"
+#include "dircache.h"
+#include "unitcache.h"
+
+// An extern identifier a unit entered into the linkage unit
+struct UnitLink {
+	Id id;			// The identifier
+	bool found;		// True if it was unified with an existing one
+	Tokid prev;		// The first token of the existing one
+};
+
+// The recorded effects of processing a compilation unit
+class CachedUnit {
+public:
+	Fileid unit;			// The unit's file
+	string context;			// Preprocessor context before processing it
+	string cwd;			// Current directory
+	vectorstring include_path;	// Include file path
+	vector <Tpart> tokens;		// Token parts whose class got the project attribute
+	vector <Tpart>::size_type nsorted;	// Number of sorted unique elements in tokens
+	set <Fileid> files;		// Files that got the project attribute
+	vector <UnitLink> links;	// Linkage unit entries, in order
+	Fdep::State deps;		// File dependencies
+	bool defines_macros;		// True if it changed the preprocessor context
+	bool defines_scope;		// True if it left file scope definitions
+	bool prefix;			// True if it started without any macros
+	// Snapshot of the macros a prefix unit defined
+	bool has_macros;
+	mapMacro macros;
+	mapMacroBody macro_body_tokens;
+	set <Fileid> once_files;
+
+	CachedUnit(Fileid u, const string &c) : unit(u), context(c), nsorted(0),
+		defines_macros(false), defines_scope(false), prefix(false),
+		has_macros(false) {}
+	// Remove the duplicate elements of tokens
+	void compact();
+	// Return true if the links would resolve in the same way as recorded
+	bool links_valid() const;
+	// Apply the recorded effects to the current project and linkage unit
+	void replay();
+};
+
+bool UnitCache::enabled;
+CachedUnit *UnitCache::recording;
+CachedUnit *UnitCache::pending;
+bool UnitCache::pending_parse;
+
+// The results recorded for each unit
+static map <Fileid, list <CachedUnit> > units;
+// The results recorded for each prefix header
+static map <Fileid, list <CachedUnit> > headers;
+// The dependencies gathered before the unit being recorded
+static Fdep::State outer_deps;
+// Names of the units the workspace processes more than once
+static set <string> repeated;
+
+// Return the first tokid of t
+static Tokid
+first_tokid(const Token &t)
+{
+	return t.get_parts_size() ? t.get_parts_begin()->get_tokid() : Tokid();
+}
+
+void
+CachedUnit::compact()
+{
+	sort(tokens.begin(), tokens.end());
+	tokens.erase(unique(tokens.begin(), tokens.end()), tokens.end());
+	nsorted = tokens.size();
+}
+
+bool
+CachedUnit::links_valid() const
+{
+	map <string, Tokid> own;	// Entries made by the unit itself
+
+	for (vector <UnitLink>::const_iterator i = links.begin(); i != links.end(); i++) {
+		const string name(i->id.get_name());
+		bool found;
+		Tokid prev;
+		map <string, Tokid>::const_iterator oi = own.find(name);
+		if (oi != own.end()) {
+			found = true;
+			prev = oi->second;
+		} else {
+			Id const *id = Block::lu_lookup(name);
+			found = (id != NULL);
+			if (found)
+				prev = first_tokid(id->get_token());
+		}
+		if (found != i->found || (found && prev != i->prev))
+			return false;
+		if (!found)
+			own[name] = first_tokid(i->id.get_token());
+	}
+	return true;
+}
+
+void
+CachedUnit::replay()
+{
+	int projid = Project::get_current_projid();
+
+	for (set <Fileid>::iterator i = files.begin(); i != files.end(); i++) {
+		Fileid f(*i);
+		f.set_attribute(projid);
+	}
+	// The classes may have been split or merged since the recording
+	for (vector <Tpart>::const_iterator i = tokens.begin(); i != tokens.end(); i++) {
+		Tokid t(i->get_tokid());
+		for (int covered = 0; covered < i->get_len(); ) {
+			Eclass *e = (t + covered).check_ec();
+			if (e == NULL)		// Removed by monitoring
+				break;
+			e->set_attribute(projid);
+			covered += e->get_len();
+		}
+	}
+	for (vector <UnitLink>::const_iterator i = links.begin(); i != links.end(); i++)
+		Block::link(i->id);
+	Fdep::add(deps);
+}
+
+void
+UnitCache::save_macros(CachedUnit *u)
+{
+	u->macros = Pdtoken::macros;
+	u->macro_body_tokens = Pdtoken::macro_body_tokens;
+	u->once_files = Pdtoken::once_files;
+	u->has_macros = true;
+}
+
+void
+UnitCache::restore_macros(const CachedUnit *u)
+{
+	Pdtoken::macros = u->macros;
+	Pdtoken::macro_body_tokens = u->macro_body_tokens;
+	Pdtoken::once_files = u->once_files;
+}
+
+void
+UnitCache::enable(const char *fname)
+{
+	ifstream in(fname);
+	map <string, int> count;
+	string line;
+
+	// Find the #pragma process lines of the workspace
+	while (getline(in, line)) {
+		string::size_type p = line.find_first_not_of(" \t");
+		if (p == string::npos || line[p] != '#')
+			continue;
+		istringstream is(line.substr(p + 1));
+		string pragma, process;
+		if (!(is >> pragma >> process) || pragma != "pragma" || process != "process")
+			continue;
+		string::size_type begin = line.find('"');
+		string::size_type end = line.rfind('"');
+		if (begin == string::npos || end == begin)
+			continue;
+		string name(line.substr(begin + 1, end - begin - 1));
+		if (++count[name] == 2)
+			repeated.insert(name);
+	}
+	enabled = true;
+}
+
+// Serialize token t into o
+static void
+put_token(ostream &o, const Token &t)
+{
+	o << ' ' << t.get_code() << ' ' << t.get_val().length() << ':' << t.get_val();
+	for (dequeTpart::const_iterator i = t.get_parts_begin(); i != t.get_parts_end(); i++)
+		o << ' ' << i->get_tokid().get_fileid().get_id() << '.' <<
+		    (long)i->get_tokid().get_streampos() << '.' << i->get_len();
+}
+
+string
+UnitCache::context()
+{
+	ostringstream o;
+	char buff[4096];
+
+	if (getcwd(buff, sizeof(buff)) != NULL)
+		o << buff;
+	o << '\n';
+	for (vectorstring::const_iterator i = Pdtoken::include_path.begin(); i != Pdtoken::include_path.end(); i++)
+		o << *i << '\n';
+	o << '\n';
+	for (set <Fileid>::const_iterator i = Pdtoken::once_files.begin(); i != Pdtoken::once_files.end(); i++)
+		o << i->get_id() << ' ';
+	o << '\n';
+	// The macro tokens determine the unifications performed
+	for (mapMacro::const_iterator i = Pdtoken::macros.begin(); i != Pdtoken::macros.end(); i++) {
+		const Macro &m = i->second;
+		o << m.is_function << m.is_vararg << m.is_defined;
+		put_token(o, m.name_token);
+		for (dequePtoken::const_iterator j = m.formal_args.begin(); j != m.formal_args.end(); j++)
+			put_token(o, *j);
+		o << " |";
+		for (dequePtoken::const_iterator j = m.value.begin(); j != m.value.end(); j++)
+			put_token(o, *j);
+		o << '\n';
+	}
+	return o.str();
+}
+
+bool
+UnitCache::replay(const string &name, Fileid unit)
+{
+	if (!enabled || repeated.find(name) == repeated.end())
+		return false;
+	establish_macros();
+	if (!Block::cu_scope_clean())
+		return false;
+
+	string ctx(context());
+	list <CachedUnit> &cached = units[unit];
+	for (list <CachedUnit>::iterator i = cached.begin(); i != cached.end(); i++)
+		if (i->context == ctx && i->links_valid()) {
+			if (DP())
+				cout << "Replay unit " << unit.get_path() << endl;
+			i->replay();
+			if (i->defines_macros || i->defines_scope) {
+				pending = &*i;
+				pending_parse = i->defines_scope;
+			}
+			return true;
+		}
+
+	if (DP())
+		cout << "Record unit " << unit.get_path() << endl;
+	cached.push_back(CachedUnit(unit, ctx));
+	start_recording(&cached.back());
+	return false;
+}
+
+void
+UnitCache::end_unit()
+{
+	if (!recording)
+		return;
+	bool defines_scope = !Block::cu_scope_clean();
+	CachedUnit *u = recording;
+	stop_recording();
+	u->defines_scope = defines_scope;
+}
+
+bool
+UnitCache::include(const string &fname, int ipath_offset)
+{
+	if (!enabled || recording || !Fchar::at_top() ||
+	    !Pdtoken::macros.empty() || !Pdtoken::once_files.empty())
+		return false;
+
+	Fileid f(fname);
+	string ctx(context());
+	list <CachedUnit> &cached = headers[f];
+	for (list <CachedUnit>::iterator i = cached.begin(); i != cached.end(); i++)
+		if (i->context == ctx) {
+			if (DP())
+				cout << "Restore the macros of " << fname << endl;
+			i->replay();
+			restore_macros(&*i);
+			return true;
+		}
+
+	if (DP())
+		cout << "Record the macros of " << fname << endl;
+	cached.push_back(CachedUnit(f, ctx));
+	start_recording(&cached.back());
+	Pdtoken::include_file(fname, ipath_offset);
+	Fchar::lock_stack();
+	Pdtoken t;
+	do
+		t.getnext();
+	while (t.get_code() != EOF);
+	Fchar::unlock_stack();
+	stop_recording();
+	return true;
+}
+
+void
+UnitCache::start_recording(CachedUnit *u)
+{
+	char buff[4096];
+
+	recording = u;
+	if (getcwd(buff, sizeof(buff)) != NULL)
+		u->cwd = buff;
+	u->include_path = Pdtoken::include_path;
+	u->prefix = Pdtoken::macros.empty();
+	// Keep apart the unit's dependencies
+	Fdep::save(outer_deps);
+	Fdep::reset();
+}
+
+void
+UnitCache::stop_recording()
+{
+	CachedUnit *u = recording;
+	recording = NULL;
+	u->compact();
+	Fdep::save(u->deps);
+	Fdep::restore(outer_deps);
+	Fdep::add(u->deps);
+	outer_deps = Fdep::State();
+	u->defines_macros = (context() != u->context);
+	if (u->prefix && u->defines_macros)
+		save_macros(u);
+}
+
+void
+UnitCache::add_token(Tokid t, int len)
+{
+	vector <Tpart> &tokens = recording->tokens;
+
+	tokens.push_back(Tpart(t, len));
+	// Most tokens are seen many times through the included files
+	if (tokens.size() > 2 * recording->nsorted + 4096)
+		recording->compact();
+}
+
+void
+UnitCache::add_file(Fileid f)
+{
+	recording->files.insert(f);
+}
+
+void
+UnitCache::add_link(const Token *tok, const Id *prev, const Id *defined)
+{
+	UnitLink l;
+
+	if (defined) {
+		l.id = *defined;
+		l.found = false;
+	} else {
+		l.id = Id(*tok, prev->get_type());
+		l.found = true;
+		l.prev = first_tokid(prev->get_token());
+	}
+	recording->links.push_back(l);
+}
+
+// Change the current directory to dir
+static void
+change_directory(const string &dir)
+{
+	if (chdir(dir.c_str()) != 0)
+		Error::error(E_FATAL, "chdir " + dir + ": " + string(strerror(errno)), false);
+	DirCache::directory_changed();
+}
+
+void
+UnitCache::establish_macros()
+{
+	extern int parse_parse();
+
+	if (!pending)
+		return;
+	CachedUnit *u = pending;
+	bool parse = pending_parse;
+	pending = NULL;
+	pending_parse = false;
+	if (DP())
+		cout << "Establish unit " << u->unit.get_path() << endl;
+	if (!parse && u->has_macros) {
+		restore_macros(u);
+		return;
+	}
+
+	// Save the state of the workspace being read
+	char buff[4096];
+	if (getcwd(buff, sizeof(buff)) == NULL)
+		/*
+		 * @error
+		 * The call to <code>getcwd</code> failed while
+		 * processing again a unit whose results were
+		 * replayed from the cache
+		 */
+		Error::error(E_FATAL, "unable to get current directory: " + string(strerror(errno)), false);
+	string cwd(buff);
+	vectorstring include_path(Pdtoken::include_path);
+	stackFchar putback;
+	Fchar::swap_putback(putback);
+	PtokenSequence expand;
+	Pdtoken::expand.swap(expand);
+	stackbool iftaken;
+	swap(Pdtoken::iftaken, iftaken);
+	int skiplevel = Pdtoken::skiplevel;
+	Pdtoken::skiplevel = 0;
+	Fdep::State deps;
+	Fdep::save(deps);
+	Fdep::reset();
+
+	change_directory(u->cwd);
+	Pdtoken::include_path = u->include_path;
+	Fchar::push_input(u->unit.get_path());
+	Fchar::lock_stack();
+	if (parse) {
+		if (parse_parse() != 0)
+			exit(1);
+	} else {
+		Pdtoken t;
+		do
+			t.getnext();
+		while (t.get_code() != EOF);
+	}
+	Fchar::unlock_stack();
+
+	Fdep::restore(deps);
+	Pdtoken::skiplevel = skiplevel;
+	swap(Pdtoken::iftaken, iftaken);
+	Pdtoken::expand.swap(expand);
+	Fchar::swap_putback(putback);
+	Pdtoken::include_path = include_path;
+	change_directory(cwd);
+}
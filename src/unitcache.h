@@ -0,0 +1,131 @@
+/*
+ * (C) Copyright 2016 Diomidis Spinellis
+ *
+ * This file is part of CScout.
+ *
+ * CScout is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CScout is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CScout.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ * A cache of the results of processing compilation units.
+ * Workspaces often process the same file in several projects,
+ * with the same include path and macro definitions.
+ * The effects of processing such a unit on the equivalence classes,
+ * the functions, and the global objects are then the same,
+ * apart from those that depend on its project and its linkage unit.
+ * The cache records these for the files the workspace processes more
+ * than once, and when a file is processed again in the same context,
+ * it replays them instead of reading and parsing the file:
+ * - the tokens and files whose project attribute was set,
+ * - the identifiers entered into the linkage unit, and
+ * - the file dependencies dumped into the SQL output.
+ * The context comprises the current directory, the include path,
+ * the macro definitions, the files read with #pragma once, and the
+ * linkage unit identifiers the unit referred to.
+ * Units are only cached when processed in an empty file scope.
+ *
+ * Prefix headers, included by the workspace after clearing the macros,
+ * are treated in the same way, but they are read in one step, so that
+ * the macros they define can be restored from a snapshot
+ * rather than by reading them again.
+ * The same holds for the macros defined by units processed without any
+ * macros defined.
+ *
+ * The macros a replayed unit defines are not established immediately,
+ * because workspaces normally clear them before processing the next
+ * unit.  If the workspace uses the preprocessor before clearing them,
+ * the unit is preprocessed again to establish them.
+ * Likewise, a unit that left definitions in its file scope is parsed
+ * again if the workspace continues to use that scope.
+ * Diagnostics are not repeated for replayed units.
+ *
+ */
+
+#ifndef UNITCACHE_
+#define UNITCACHE_
+
+#include <string>
+
+using namespace std;
+
+#include "tokid.h"
+
+class Id;
+class Token;
+class CachedUnit;
+
+class UnitCache {
+private:
+	static bool enabled;		// True when the cache is in use
+	static CachedUnit *recording;	// Unit being recorded, or NULL
+	static CachedUnit *pending;	// Replayed unit whose macros are not established
+	static bool pending_parse;	// True if the pending unit must also be parsed
+
+	static void add_token(Tokid t, int len);
+	static void add_file(Fileid f);
+	static void add_link(const Token *tok, const Id *prev, const Id *defined);
+	// Record the effects of processing u
+	static void start_recording(CachedUnit *u);
+	static void stop_recording();
+	// Take and restore a snapshot of the macros
+	static void save_macros(CachedUnit *u);
+	static void restore_macros(const CachedUnit *u);
+	// Return the preprocessor context of the unit about to be processed
+	static string context();
+public:
+	/*
+	 * Enable the cache for the files processed more than once
+	 * in the workspace fname.
+	 */
+	static void enable(const char *fname);
+	/*
+	 * Return true if the results of processing unit, specified as name
+	 * in the workspace, were replayed from the cache.
+	 * Otherwise start recording them, if needed.
+	 */
+	static bool replay(const string &name, Fileid unit);
+	// Called after a unit passed to replay() has been processed
+	static void end_unit();
+	/*
+	 * Read the file fname included by the workspace, found at the
+	 * specified include path offset, and return true, if it is a
+	 * prefix header: one included without any macros defined.
+	 * Restore its macros from a snapshot, if one was taken in the
+	 * same context; otherwise take a snapshot.
+	 */
+	static bool include(const string &fname, int ipath_offset);
+	// Establish the macros of a replayed unit; called before using the preprocessor
+	static void establish_macros();
+	// Called before the macros are cleared
+	static void clear_macros() {
+		if (pending && pending_parse)
+			establish_macros();
+		pending = NULL;
+	}
+	// Called when entering a block; a pending unit's definitions must then exist
+	static void enter_block() { if (pending && pending_parse) establish_macros(); }
+	// Called when exiting a block, which discards the unit's definitions
+	static void exit_block() { pending_parse = false; }
+
+	// Record the effects of the unit being processed
+	// The class of the len characters at t got the current project attribute
+	static void touch(Tokid t, int len) { if (recording) add_token(t, len); }
+	// The file f was read and got the current project attribute
+	static void touch(Fileid f) { if (recording) add_file(f); }
+	// The extern identifier tok was unified with the linkage unit's prev
+	static void link(const Token &tok, const Id *prev) { if (recording) add_link(&tok, prev, NULL); }
+	// The extern identifier defined was entered into the linkage unit
+	static void link(const Id *defined) { if (recording) add_link(NULL, NULL, defined); }
+};
+
+#endif /* UNITCACHE_ */
@@ -58,6 +58,7 @@
 #include "stab.h"
 #include "sql.h"
 #include "workdb.h"
+#include "filescan.h"
 
 // Our identifiers to store as a set
 class Identifier {
@@ -93,56 +94,57 @@ insert_eclass(Sql *db, ostream &of, Eclass *e, const string &name)
 	// Update metrics
 	id_msum.add_unique_id(e);
 
-	of << "INSERT INTO IDS VALUES(" <<
-	ptr_offset(e) << ",'" <<
-	name << "'," <<
-	db->boolval(e->get_attribute(is_readonly)) << ',' <<
-	db->boolval(e->get_attribute(is_undefined_macro)) << ',' <<
-	db->boolval(e->get_attribute(is_macro)) << ',' <<
-	db->boolval(e->get_attribute(is_macro_arg)) << ',' <<
-	db->boolval(e->get_attribute(is_ordinary)) << ',' <<
-	db->boolval(e->get_attribute(is_suetag)) << ',' <<
-	db->boolval(e->get_attribute(is_sumember)) << ',' <<
-	db->boolval(e->get_attribute(is_label)) << ',' <<
-	db->boolval(e->get_attribute(is_typedef)) << ',' <<
-	db->boolval(e->get_attribute(is_enumeration)) << ',' <<
-	db->boolval(e->get_attribute(is_yacc)) << ',' <<
-	db->boolval(e->get_attribute(is_cfunction)) << ',' <<
-	db->boolval(e->get_attribute(is_cscope)) << ',' <<
-	db->boolval(e->get_attribute(is_lscope)) << ',' <<
-	db->boolval(e->is_unused()) <<
-	");\n";
+	SqlTable &ids = db->table(of, "IDS");
+	ids << ptr_offset(e) << name <<
+	e->get_attribute(is_readonly) <<
+	e->get_attribute(is_undefined_macro) <<
+	e->get_attribute(is_macro) <<
+	e->get_attribute(is_macro_arg) <<
+	e->get_attribute(is_ordinary) <<
+	e->get_attribute(is_suetag) <<
+	e->get_attribute(is_sumember) <<
+	e->get_attribute(is_label) <<
+	e->get_attribute(is_typedef) <<
+	e->get_attribute(is_enumeration) <<
+	e->get_attribute(is_yacc) <<
+	e->get_attribute(is_cfunction) <<
+	e->get_attribute(is_cscope) <<
+	e->get_attribute(is_lscope) <<
+	e->is_unused();
+	ids.end_row();
 	// The projects each EC belongs to
+	SqlTable &idproj = db->table(of, "IDPROJ");
 	for (unsigned j = attr_end; j < Attributes::get_num_attributes(); j++)
-		if (e->get_attribute(j))
-			of << "INSERT INTO IDPROJ VALUES(" <<
-			ptr_offset(e) << ',' << j << ");\n";
+		if (e->get_attribute(j)) {
+			idproj << ptr_offset(e) << j;
+			idproj.end_row();
+		}
 }
 
 // Chunk the input into tables
 class Chunker {
 private:
-	fifstream &in;		// Stream we are reading from
+	const FileScan &scan;	// Scan of the file we are reading
 	string table;		// Table we are chunking into
 	Sql *db;		// Database interface
-	ostream &of;		// Stream for writing SQL statements
+	ostream &of;		// Stream for writing SQL rows
 	Fileid fid;		// File we are chunking
 	streampos startpos;	// Starting position of current chunk
 	string chunk;		// Characters accumulated in the current chunk
 public:
-	Chunker(fifstream &i, Sql *d, ostream &o, Fileid f) : in(i), table("REST"), db(d), of(o), fid(f), startpos(0) {}
+	Chunker(const FileScan &s, Sql *d, ostream &o, Fileid f) : scan(s), table("REST"), db(d), of(o), fid(f), startpos(0) {}
 
 	// Flush the currently collected input into the database
 	// Should be called at the point where new input is expected
 	void flush() {
 		if (chunk.length() > 0) {
-			of << "INSERT INTO " << table << " VALUES(" <<
-			fid.get_id() <<
-			"," << (unsigned)startpos <<
-			",'" << chunk << "');\n";
+			SqlTable &t = db->table(of, table.c_str());
+			t << fid.get_id() << (unsigned)startpos << chunk;
+			t.end_row();
 			chunk.erase();
 		}
-		startpos = in.tellg();
+		// Past the character just read
+		startpos = scan.get_offset() + 1;
 	}
 
 	// Start collecting input for a (possibly) new table
@@ -152,7 +154,7 @@ public:
 		flush();
 		table = string(t);
 		startpos -= s.length();
-		chunk = db->escape(s);
+		chunk = s;
 	}
 
 	void start(const char *t, char c) {
@@ -160,139 +162,98 @@ public:
 	}
 
 	inline void add(char c) {
-		chunk += db->escape(c);
+		chunk += c;
 	}
 };
 
 // Add the contents of a file to the Tokens, Comments, Strings, and Rest tables
 // As a side-effect insert corresponding identifiers in the database
 // and populate the LineOffset table
+// This is a second scan of the file, after the post-processing one:
+// the rows of the identifiers depend on all files having been post-processed
 static void
 file_dump(Sql *db, ostream &of, Fileid fid)
 {
 	streampos bol(0);			// Beginning of line
 	bool at_bol = true;
 	int line_number = 1;
-	enum e_cfile_state cstate = s_normal;	// C file state machine
 
-	fifstream in;
-	in.open(fid.get_path().c_str(), ios::binary);
-	if (in.fail()) {
-		perror(fid.get_path().c_str());
-		exit(1);
-	}
-	Chunker chunker(in, db, of, fid);
+	FileScan scan(fid);
+	Chunker chunker(scan, db, of, fid);
+	SqlTable &tokens = db->table(of, "TOKENS");
+	SqlTable &linepos = db->table(of, "LINEPOS");
 	// Go through the file character by character
-	for (;;) {
-		Tokid ti;
-		int val;
-
-		ti = Tokid(fid, in.tellg());
-		if ((val = in.get()) == EOF)
-			break;
-		char c = (char)val;
+	while (scan.next()) {
+		char c = scan.get_char();
+		// C file state machine
+		enum e_cfile_state cstate = scan.get_state();
 		Eclass *ec;
 		if (cstate != s_block_comment &&
 		    cstate != s_string &&
 		    cstate != s_cpp_comment &&
 		    (isalnum(c) || c == '_') &&
-		    (ec = ti.check_ec()) &&
+		    (ec = scan.get_ec()) &&
 		    ec->is_identifier()) {
 			id_msum.add_id(ec);
-			string s;
-			s = (char)val;
-			int len = ec->get_len();
-			for (int j = 1; j < len; j++)
-				s += (char)in.get();
+			cs_offset_t offset = scan.get_offset();
+			string s(scan.get_token(ec->get_len()));
 			insert_eclass(db, of, ec, s);
 			fid.metrics().process_id(s, ec);
 			chunker.flush();
-			of << "INSERT INTO TOKENS VALUES(" << fid.get_id() <<
-			"," << (unsigned)ti.get_streampos() << "," <<
-			ptr_offset(ec) << ");\n";
+			tokens << fid.get_id() << (unsigned)offset << ptr_offset(ec);
+			tokens.end_row();
 		} else {
 			fid.metrics().process_char(c);
 			if (c == '\n') {
 				at_bol = true;
-				bol = in.tellg();
+				bol = scan.get_offset() + 1;
 				line_number++;
 			} else {
 				if (at_bol) {
-					of << "INSERT INTO LINEPOS VALUES(" <<
-					fid.get_id() <<
-					"," << (unsigned)bol <<
-					"," << line_number << ");\n";
+					linepos << fid.get_id() << (unsigned)bol <<
+					line_number;
+					linepos.end_row();
 					at_bol = false;
 				}
 			}
+			// The scan performs the state transitions
 			switch (cstate) {
 			case s_normal:
-				if (c == '/')
-					cstate = s_saw_slash;
-				else if (c == '"') {
-					cstate = s_string;
+				if (c == '"')
 					chunker.start("STRINGS", c);
-				} else if (c == '\'') {
-					cstate = s_char;
-					chunker.add(c);
-				} else
+				else if (c != '/')	// Added with the next one
 					chunker.add(c);
 				break;
 			case s_char:
+			case s_saw_chr_backslash:
+			case s_saw_str_backslash:
+			case s_block_comment:		// Inside C block comment
 				chunker.add(c);
-				if (c == '\'')
-					cstate = s_normal;
-				else if (c == '\\')
-					cstate = s_saw_chr_backslash;
 				break;
 			case s_string:
 				chunker.add(c);
-				if (c == '"') {
-					cstate = s_normal;
+				if (c == '"')
 					chunker.start("REST");
-				} else if (c == '\\')
-					cstate = s_saw_str_backslash;
-				break;
-			case s_saw_chr_backslash:
-				chunker.add(c);
-				cstate = s_char;
-				break;
-			case s_saw_str_backslash:
-				chunker.add(c);
-				cstate = s_string;
 				break;
 			case s_saw_slash:		// After a / character
-				if (c == '/') {
-					cstate = s_cpp_comment;
+				if (c == '/')
 					chunker.start("COMMENTS", "//");
-				} else if (c == '*') {
-					cstate = s_block_comment;
+				else if (c == '*')
 					chunker.start("COMMENTS", "/*");
-				} else {
+				else {
 					chunker.add('/');
 					chunker.add(c);
-					cstate = s_normal;
 				}
 				break;
 			case s_cpp_comment:		// Inside C++ comment
 				chunker.add(c);
-				if (c == '\n') {
-					cstate = s_normal;
+				if (c == '\n')
 					chunker.start("REST");
-				}
-				break;
-			case s_block_comment:		// Inside C block comment
-				chunker.add(c);
-				if (c == '*')
-					cstate = s_block_star;
 				break;
 			case s_block_star:		// Found a * in a block comment
 				chunker.add(c);
-				if (c == '/') {
-					cstate = s_normal;
+				if (c == '/')
 					chunker.start("REST");
-				} else if (c != '*')
-					cstate = s_block_comment;
 				break;
 			default:
 				csassert(0);
@@ -306,7 +267,7 @@ file_dump(Sql *db, ostream &of, Fileid fid)
 void
 workdb_schema(Sql *db, ostream &of)
 {
-	cout <<
+	of <<
 		// BEGIN AUTOSCHEMA
 		"CREATE TABLE IDS("			// Details of interdependant identifiers appearing in the workspace
 		"EID " << db->ptrtype() << " PRIMARY KEY,"	// Unique identifier key
@@ -336,8 +297,8 @@ workdb_schema(Sql *db, ostream &of)
 		// AUTOSCHEMA INCLUDE filemetrics.cpp FileMetrics
 		for (int i = 0; i < FileMetrics::metric_max; i++)
 			if (!Metrics::is_internal<FileMetrics>(i))
-				cout << ",\n" << Metrics::get_dbfield<FileMetrics>(i) << " INTEGER";
-		cout << ");\n"
+				of << ",\n" << Metrics::get_dbfield<FileMetrics>(i) << " INTEGER";
+		of << ");\n"
 
 		"CREATE TABLE TOKENS("			// Instances of identifier tokens within the source code
 		"FID INTEGER,"				// File key (references FILES)
@@ -471,10 +432,10 @@ workdb_schema(Sql *db, ostream &of)
 		// AUTOSCHEMA INCLUDE funmetrics.cpp FunMetrics
 		for (int i = 0; i < FunMetrics::metric_max; i++)
 			if (!Metrics::is_internal<FunMetrics>(i))
-				cout << Metrics::get_dbfield<FunMetrics>(i) <<
+				of << Metrics::get_dbfield<FunMetrics>(i) <<
 				    (i >= FunMetrics::em_real_start ? " REAL" : " INTEGER") <<
 				    ",\n";
-		cout <<
+		of <<
 		"FIDBEGIN INTEGER,\n"			// File key of the function's definition begin (references FILES)
 		"FOFFSETBEGIN INTEGER,\n"		// Offset of definition begin within the file
 		"FIDEND INTEGER,\n"			// File key of the function's definition end (references FILES)
@@ -515,40 +476,45 @@ workdb_rest(Sql *db, ostream &of)
 	// Project names
 	const Project::proj_map_type &m = Project::get_project_map();
 	Project::proj_map_type::const_iterator pm;
-	for (pm = m.begin(); pm != m.end(); pm++)
-		cout << "INSERT INTO PROJECTS VALUES(" <<
-		(*pm).second << ",'" << (*pm).first << "');\n";
+	SqlTable &projects = db->table(of, "PROJECTS");
+	for (pm = m.begin(); pm != m.end(); pm++) {
+		projects << (*pm).second << (*pm).first;
+		projects.end_row();
+	}
 
 	vector <Fileid> files = Fileid::files(true);
 
 	int groupnum = 0;
+	SqlTable &ftable = db->table(of, "FILES");
+	SqlTable &fileproj = db->table(of, "FILEPROJ");
+	SqlTable &filecopies = db->table(of, "FILECOPIES");
 
 	// Details and contents of each file
 	// As a side effect populate the EC identifier member
 	for (vector <Fileid>::iterator i = files.begin(); i != files.end(); i++) {
-		cout << "INSERT INTO FILES VALUES(" <<
-		(*i).get_id() << ",'" <<
-		(*i).get_path() << "'," <<
-		db->boolval((*i).get_readonly());
+		ftable << (*i).get_id() << (*i).get_path() << (*i).get_readonly();
 		for (int j = 0; j < FileMetrics::metric_max; j++)
 			if (!Metrics::is_internal<FileMetrics>(j))
-				cout << ',' << i->metrics().get_metric(j);
-		cout << ");\n";
+				ftable << i->metrics().get_metric(j);
+		ftable.end_row();
 		// This invalidates the file's metrics
-		file_dump(db, cout, (*i));
+		file_dump(db, of, (*i));
 		// The projects this file belongs to
 		for (unsigned j = attr_end; j < Attributes::get_num_attributes(); j++)
-			if ((*i).get_attribute(j))
-				cout << "INSERT INTO FILEPROJ VALUES(" <<
-				(*i).get_id() << ',' << j << ");\n";
+			if ((*i).get_attribute(j)) {
+				fileproj << (*i).get_id() << j;
+				fileproj.end_row();
+			}
 
 		// Copies of the file
 		const set <Fileid> &copies(i->get_identical_files());
 		if (copies.size() > 1 && copies.begin()->get_id() == i->get_id()) {
-			for (set <Fileid>::const_iterator j = copies.begin(); j != copies.end(); j++)
-				cout << "INSERT INTO FILECOPIES VALUES(" <<
-					 groupnum << ',' << j->get_id() << ");\n";
+			for (set <Fileid>::const_iterator j = copies.begin(); j != copies.end(); j++) {
+				filecopies << groupnum << j->get_id();
+				filecopies.end_row();
+			}
 			groupnum++;
 		}
+		db->commit();
 	}
 }